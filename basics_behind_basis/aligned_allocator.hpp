@@ -0,0 +1,55 @@
+//
+//  aligned_allocator.hpp
+//
+//  std::allocator replacement returning storage aligned to a cache line
+//  (or any power of two), for containers fed to vectorized kernels.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <limits>
+
+namespace bbb {
+    constexpr std::size_t cache_line_size = 64;
+
+    template <typename value_t, std::size_t alignment = cache_line_size>
+    struct aligned_allocator {
+        static_assert((alignment & (alignment - 1)) == 0, "required: alignment is power of two");
+        static_assert(alignof(void *) <= alignment, "required: alignment is at least pointer alignment");
+
+        using value_type = value_t;
+        using pointer = value_t *;
+        using const_pointer = const value_t *;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+
+        template <typename other_t>
+        struct rebind { using other = aligned_allocator<other_t, alignment>; };
+
+        aligned_allocator() = default;
+        template <typename other_t>
+        aligned_allocator(const aligned_allocator<other_t, alignment> &) {}
+
+        value_t *allocate(std::size_t n) {
+            if((std::numeric_limits<std::size_t>::max() - alignment - sizeof(void *)) / sizeof(value_t) < n) throw std::bad_alloc();
+            // the raw pointer is stashed right before the aligned block.
+            void *raw = ::operator new(n * sizeof(value_t) + alignment + sizeof(void *));
+            std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *);
+            address = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+            reinterpret_cast<void **>(address)[-1] = raw;
+            return reinterpret_cast<value_t *>(address);
+        }
+
+        void deallocate(value_t *p, std::size_t) {
+            if(p) ::operator delete(reinterpret_cast<void **>(p)[-1]);
+        }
+
+        template <typename other_t>
+        constexpr bool operator==(const aligned_allocator<other_t, alignment> &) const { return true; }
+        template <typename other_t>
+        constexpr bool operator!=(const aligned_allocator<other_t, alignment> &) const { return false; }
+    };
+};
@@ -0,0 +1,406 @@
+//
+//  batched_lu.hpp
+//
+//  factor and solve many independent n x n systems at once. matrix_batch and
+//  vec_batch interleave `width` systems element by element: entry (i, j) of
+//  the systems in one block is a contiguous run of width values, so every
+//  step of the elimination is a loop over the lanes that the compiler turns
+//  into vector instructions. width defaults to one cache line of values
+//  (8 doubles, 16 floats). pivoting is partial, per system, done with
+//  selects instead of branches so the lanes never diverge.
+//
+//  float / double blocks run on vector registers of the widest instruction
+//  set found by simd::detected() (SSE2, AVX2, AVX-512); other value types
+//  and BBB_DISABLE_SIMD use plain lane loops.
+//
+//  unused lanes of the last block hold identity systems.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <cassert>
+
+#include "matrix.hpp"
+#include "vec.hpp"
+#include "simd.hpp"
+#include "aligned_allocator.hpp"
+#include "thread_pool.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace batch {
+            template <typename value_t>
+            struct default_width : std::integral_constant<std::size_t, cache_line_size / sizeof(value_t)> {};
+
+            // blocks handed to one task when a batch is split over threads.
+            constexpr std::size_t chunk = 64;
+
+            template <typename function>
+            void for_each_block(thread_pool *pool, std::size_t blocks, function f) {
+                const std::size_t chunk_num = (blocks + chunk - 1) / chunk;
+                const auto run = [&](std::size_t c) {
+                    for(std::size_t b = c * chunk, end = std::min(blocks, (c + 1) * chunk); b < end; b++) f(b);
+                };
+                if(pool && 1 < pool->size() && 1 < chunk_num) pool->parallel_for(chunk_num, run);
+                else for(std::size_t c = 0; c < chunk_num; c++) run(c);
+            }
+        };
+    };
+
+    // count matrices of size rows x cols; block b holds systems [b * width, (b + 1) * width).
+    template <std::size_t rows, std::size_t cols, typename value_t, std::size_t width>
+    struct interleaved_batch {
+        static constexpr std::size_t lanes = width;
+        static constexpr std::size_t block_size = rows * cols * width;
+
+        interleaved_batch() = default;
+        explicit interleaved_batch(std::size_t count) { resize(count); }
+
+        // new systems are identity (square) or zero.
+        void resize(std::size_t count) {
+            const std::size_t kept = std::min(this->count, count);
+            this->count = count;
+            storage.resize(block_count() * block_size);
+            for(std::size_t system = kept; system < block_count() * width; system++) clear(system);
+        }
+
+        std::size_t size() const { return count; }
+        std::size_t block_count() const { return (count + width - 1) / width; }
+
+        value_t *block(std::size_t b) { return storage.data() + b * block_size; }
+        const value_t *block(std::size_t b) const { return storage.data() + b * block_size; }
+
+        value_t &operator()(std::size_t system, std::size_t i, std::size_t j) {
+            return storage[system / width * block_size + (i * cols + j) * width + system % width];
+        }
+        const value_t &operator()(std::size_t system, std::size_t i, std::size_t j) const {
+            return storage[system / width * block_size + (i * cols + j) * width + system % width];
+        }
+
+    protected:
+        void clear(std::size_t system) {
+            for(std::size_t i = 0; i < rows; i++) for(std::size_t j = 0; j < cols; j++) (*this)(system, i, j) = value_t(i == j && rows == cols);
+        }
+
+        std::vector<value_t, aligned_allocator<value_t>> storage;
+        std::size_t count{0};
+    };
+
+    template <std::size_t n, typename value_t = double, std::size_t width = detail::batch::default_width<value_t>::value>
+    struct matrix_batch : interleaved_batch<n, n, value_t, width> {
+        using interleaved_batch<n, n, value_t, width>::interleaved_batch;
+        matrix_batch() = default;
+
+        void set(std::size_t system, const matrix<n, n, value_t> &m) {
+            for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) (*this)(system, i, j) = m(i, j);
+        }
+
+        matrix<n, n, value_t> get(std::size_t system) const {
+            matrix<n, n, value_t> m;
+            for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) m(i, j) = (*this)(system, i, j);
+            return m;
+        }
+    };
+
+    template <std::size_t n, typename value_t = double, std::size_t width = detail::batch::default_width<value_t>::value>
+    struct vec_batch : interleaved_batch<n, 1, value_t, width> {
+        using interleaved_batch<n, 1, value_t, width>::interleaved_batch;
+        vec_batch() = default;
+
+        value_t &operator()(std::size_t system, std::size_t i) { return interleaved_batch<n, 1, value_t, width>::operator()(system, i, 0); }
+        const value_t &operator()(std::size_t system, std::size_t i) const { return interleaved_batch<n, 1, value_t, width>::operator()(system, i, 0); }
+
+        void set(std::size_t system, const base_vec<n, value_t> &v) {
+            for(std::size_t i = 0; i < n; i++) (*this)(system, i) = v[i];
+        }
+
+        vec<n, value_t> get(std::size_t system) const {
+            vec<n, value_t> v;
+            for(std::size_t i = 0; i < n; i++) v[i] = (*this)(system, i);
+            return v;
+        }
+    };
+
+    namespace detail {
+        namespace batch {
+            namespace scalar {
+                // in place PA = LU of one block; pivot[k * width + l] is the row swapped with k in lane l.
+                // lanes with a zero pivot are flagged in singular and keep going on their own.
+                // the block is worked on in a local copy, so the lane loops vectorize without alias checks;
+                // pivot rows are tracked as value_t to keep every lane loop in one element width.
+                template <std::size_t n, std::size_t width, typename value_t>
+                void factor(value_t *block, std::uint8_t *pivot, std::uint8_t *singular) {
+                    value_t a[n][n][width];
+                    std::copy(block, block + n * n * width, &a[0][0][0]);
+                    for(std::size_t l = 0; l < width; l++) singular[l] = 0;
+                    for(std::size_t k = 0; k < n; k++) {
+                        value_t max[width], p[width];
+                        for(std::size_t l = 0; l < width; l++) max[l] = std::abs(a[k][k][l]), p[l] = value_t(k);
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            for(std::size_t l = 0; l < width; l++) {
+                                const value_t candidate = std::abs(a[i][k][l]);
+                                const bool larger = max[l] < candidate;
+                                max[l] = larger ? candidate : max[l];
+                                p[l] = larger ? value_t(i) : p[l];
+                            }
+                        }
+                        for(std::size_t l = 0; l < width; l++) {
+                            pivot[k * width + l] = static_cast<std::uint8_t>(p[l]);
+                            singular[l] |= max[l] == value_t(0);
+                        }
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            for(std::size_t j = 0; j < n; j++) {
+                                for(std::size_t l = 0; l < width; l++) {
+                                    const bool swap = p[l] == value_t(i);
+                                    const value_t x = a[k][j][l], y = a[i][j][l];
+                                    a[k][j][l] = swap ? y : x;
+                                    a[i][j][l] = swap ? x : y;
+                                }
+                            }
+                        }
+                        value_t inverse[width];
+                        for(std::size_t l = 0; l < width; l++) inverse[l] = value_t(1) / a[k][k][l];
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            for(std::size_t l = 0; l < width; l++) a[i][k][l] *= inverse[l];
+                            for(std::size_t j = k + 1; j < n; j++) {
+                                for(std::size_t l = 0; l < width; l++) a[i][j][l] -= a[i][k][l] * a[k][j][l];
+                            }
+                        }
+                    }
+                    std::copy(&a[0][0][0], &a[0][0][0] + n * n * width, block);
+                }
+
+                // b of one block is overwritten by the solution of LU x = P b.
+                template <std::size_t n, std::size_t width, typename value_t>
+                void solve(const value_t *block, const std::uint8_t *pivot, value_t *rhs) {
+                    value_t a[n][n][width], b[n][width];
+                    std::copy(block, block + n * n * width, &a[0][0][0]);
+                    std::copy(rhs, rhs + n * width, &b[0][0]);
+                    for(std::size_t k = 0; k < n; k++) {
+                        value_t p[width];
+                        for(std::size_t l = 0; l < width; l++) p[l] = value_t(pivot[k * width + l]);
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            for(std::size_t l = 0; l < width; l++) {
+                                const bool swap = p[l] == value_t(i);
+                                const value_t x = b[k][l], y = b[i][l];
+                                b[k][l] = swap ? y : x;
+                                b[i][l] = swap ? x : y;
+                            }
+                        }
+                    }
+                    for(std::size_t i = 1; i < n; i++) {
+                        for(std::size_t k = 0; k < i; k++) {
+                            for(std::size_t l = 0; l < width; l++) b[i][l] -= a[i][k][l] * b[k][l];
+                        }
+                    }
+                    for(std::size_t i = n; i-- > 0;) {
+                        for(std::size_t k = i + 1; k < n; k++) {
+                            for(std::size_t l = 0; l < width; l++) b[i][l] -= a[i][k][l] * b[k][l];
+                        }
+                        for(std::size_t l = 0; l < width; l++) b[i][l] /= a[i][i][l];
+                    }
+                    std::copy(&b[0][0], &b[0][0] + n * width, rhs);
+                }
+            };
+
+
+#if BBB_SIMD_X86
+            template <typename value_t, std::size_t lanes>
+            struct pack {
+                typedef value_t type __attribute__((vector_size(lanes * sizeof(value_t))));
+            };
+
+            // the scalar kernels with one vector register per entry; the width lanes of the
+            // block are taken bytes / sizeof(value_t) at a time.
+            template <std::size_t n, std::size_t width, std::size_t bytes, typename value_t>
+            __attribute__((always_inline)) inline void factor_packed(value_t *block, std::uint8_t *pivot, std::uint8_t *singular) {
+                constexpr std::size_t lanes = bytes / sizeof(value_t) < width ? bytes / sizeof(value_t) : width;
+                using pack_t = typename pack<value_t, lanes>::type;
+                for(std::size_t g = 0; g < width; g += lanes) {
+                    pack_t a[n][n];
+                    for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) std::memcpy(&a[i][j], block + (i * n + j) * width + g, sizeof(pack_t));
+                    const pack_t zero = pack_t{}, one = zero + value_t(1);
+                    pack_t flag = zero;
+                    for(std::size_t k = 0; k < n; k++) {
+                        pack_t max = a[k][k] < zero ? -a[k][k] : a[k][k], p = zero + value_t(k);
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            const pack_t candidate = a[i][k] < zero ? -a[i][k] : a[i][k];
+                            const auto larger = max < candidate;
+                            max = larger ? candidate : max;
+                            p = larger ? zero + value_t(i) : p;
+                        }
+                        for(std::size_t l = 0; l < lanes; l++) pivot[k * width + g + l] = static_cast<std::uint8_t>(p[l]);
+                        flag = max == zero ? one : flag;
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            const auto swap = p == zero + value_t(i);
+                            for(std::size_t j = 0; j < n; j++) {
+                                const pack_t x = a[k][j], y = a[i][j];
+                                a[k][j] = swap ? y : x;
+                                a[i][j] = swap ? x : y;
+                            }
+                        }
+                        const pack_t inverse = one / a[k][k];
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            a[i][k] *= inverse;
+                            for(std::size_t j = k + 1; j < n; j++) a[i][j] -= a[i][k] * a[k][j];
+                        }
+                    }
+                    for(std::size_t l = 0; l < lanes; l++) singular[g + l] = flag[l] != value_t(0);
+                    for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) std::memcpy(block + (i * n + j) * width + g, &a[i][j], sizeof(pack_t));
+                }
+            }
+
+            template <std::size_t n, std::size_t width, std::size_t bytes, typename value_t>
+            __attribute__((always_inline)) inline void solve_packed(const value_t *block, const std::uint8_t *pivot, value_t *rhs) {
+                constexpr std::size_t lanes = bytes / sizeof(value_t) < width ? bytes / sizeof(value_t) : width;
+                using pack_t = typename pack<value_t, lanes>::type;
+                for(std::size_t g = 0; g < width; g += lanes) {
+                    pack_t b[n];
+                    for(std::size_t i = 0; i < n; i++) std::memcpy(&b[i], rhs + i * width + g, sizeof(pack_t));
+                    const pack_t zero = pack_t{};
+                    for(std::size_t k = 0; k < n; k++) {
+                        pack_t p;
+                        for(std::size_t l = 0; l < lanes; l++) p[l] = value_t(pivot[k * width + g + l]);
+                        for(std::size_t i = k + 1; i < n; i++) {
+                            const auto swap = p == zero + value_t(i);
+                            const pack_t x = b[k], y = b[i];
+                            b[k] = swap ? y : x;
+                            b[i] = swap ? x : y;
+                        }
+                    }
+                    pack_t a[n][n];
+                    for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) std::memcpy(&a[i][j], block + (i * n + j) * width + g, sizeof(pack_t));
+                    for(std::size_t i = 1; i < n; i++) {
+                        for(std::size_t k = 0; k < i; k++) b[i] -= a[i][k] * b[k];
+                    }
+                    for(std::size_t i = n; i-- > 0;) {
+                        for(std::size_t k = i + 1; k < n; k++) b[i] -= a[i][k] * b[k];
+                        b[i] /= a[i][i];
+                    }
+                    for(std::size_t i = 0; i < n; i++) std::memcpy(rhs + i * width + g, &b[i], sizeof(pack_t));
+                }
+            }
+
+#define BBB_BATCH_DEFINE_KERNELS(isa_name, target_name, bytes) \
+            namespace isa_name { \
+                template <std::size_t n, std::size_t width, typename value_t> \
+                __attribute__((target(target_name))) void factor(value_t *block, std::uint8_t *pivot, std::uint8_t *singular) { \
+                    factor_packed<n, width, bytes>(block, pivot, singular); \
+                } \
+                template <std::size_t n, std::size_t width, typename value_t> \
+                __attribute__((target(target_name))) void solve(const value_t *block, const std::uint8_t *pivot, value_t *rhs) { \
+                    solve_packed<n, width, bytes>(block, pivot, rhs); \
+                } \
+            };
+
+            BBB_BATCH_DEFINE_KERNELS(sse2, "sse2", 16)
+            BBB_BATCH_DEFINE_KERNELS(avx2, "avx2,fma", 32)
+            BBB_BATCH_DEFINE_KERNELS(avx512, "avx512f", 64)
+#undef BBB_BATCH_DEFINE_KERNELS
+#endif
+
+            template <std::size_t n, std::size_t width, typename value_t>
+            struct kernel_table {
+                void (*factor)(value_t *, std::uint8_t *, std::uint8_t *);
+                void (*solve)(const value_t *, const std::uint8_t *, value_t *);
+
+                static kernel_table select(std::false_type) {
+                    return {scalar::factor<n, width, value_t>, scalar::solve<n, width, value_t>};
+                }
+
+                static kernel_table select(std::true_type) {
+#if BBB_SIMD_X86
+                    switch(simd::detected()) {
+                        case simd::instruction_set::avx512: return {avx512::factor<n, width, value_t>, avx512::solve<n, width, value_t>};
+                        case simd::instruction_set::avx2: return {avx2::factor<n, width, value_t>, avx2::solve<n, width, value_t>};
+                        case simd::instruction_set::sse2: return {sse2::factor<n, width, value_t>, sse2::solve<n, width, value_t>};
+                        default: break;
+                    }
+#endif
+                    return select(std::false_type{});
+                }
+
+                static const kernel_table &get() {
+                    static const kernel_table table = select(simd::is_dispatchable<value_t>{});
+                    return table;
+                }
+            };
+        };
+    };
+
+    // LU factorizations of every system of a matrix_batch, vectorized across the systems.
+    template <std::size_t n, typename value_t = double, std::size_t width = detail::batch::default_width<value_t>::value>
+    struct batched_lu {
+        static_assert(0 < n && n < 256, "required: pivots fit in 8 bits");
+        static_assert(width && (width & (width - 1)) == 0, "required: width is a power of two");
+        using batch_type = matrix_batch<n, value_t, width>;
+        using rhs_type = vec_batch<n, value_t, width>;
+
+        batched_lu() = default;
+        explicit batched_lu(const batch_type &a) { factorize(a); }
+        template <typename policy, typename std::enable_if<execution::is_execution_policy<policy>::value>::type * = nullptr>
+        batched_lu(const policy &p, const batch_type &a) { factorize(p, a); }
+
+        batched_lu &factorize(const batch_type &a) {
+            return factorize(execution::seq, a);
+        }
+
+        template <typename policy>
+        auto factorize(const policy &p, const batch_type &a)
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, batched_lu &>::type
+        {
+            lu = a;
+            const std::size_t blocks = lu.block_count();
+            pivots.resize(blocks * n * width);
+            singular.resize(blocks * width);
+            const auto factor = detail::batch::kernel_table<n, width, value_t>::get().factor;
+            detail::batch::for_each_block(execution::pool_of(p), blocks, [this, factor](std::size_t b) {
+                factor(lu.block(b), pivots.data() + b * n * width, singular.data() + b * width);
+            });
+            return *this;
+        }
+
+        std::size_t size() const { return lu.size(); }
+        bool is_singular(std::size_t system) const { return singular[system] != 0; }
+        std::size_t singular_count() const {
+            return static_cast<std::size_t>(std::count(singular.begin(), singular.begin() + size(), std::uint8_t(1)));
+        }
+
+        // L and U of every system, packed like lu_factorization::packed().
+        const batch_type &packed() const { return lu; }
+
+        // solutions of singular systems are not finite; the other lanes are unaffected.
+        void solve_in_place(rhs_type &b) const {
+            solve_in_place(execution::seq, b);
+        }
+
+        template <typename policy>
+        auto solve_in_place(const policy &p, rhs_type &b) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+        {
+            assert(b.size() == size());
+            const auto solve = detail::batch::kernel_table<n, width, value_t>::get().solve;
+            detail::batch::for_each_block(execution::pool_of(p), lu.block_count(), [this, &b, solve](std::size_t k) {
+                solve(lu.block(k), pivots.data() + k * n * width, b.block(k));
+            });
+        }
+
+        rhs_type solve(const rhs_type &b) const {
+            rhs_type x = b;
+            solve_in_place(x);
+            return x;
+        }
+
+    private:
+        batch_type lu;
+        std::vector<std::uint8_t> pivots;
+        std::vector<std::uint8_t> singular;
+    };
+};
@@ -0,0 +1,368 @@
+//
+//  binary_io.hpp
+//
+//  versioned binary files for matrices and vec_arrays, and read-only views
+//  over memory mapped files. the 64 byte header records kind, value type,
+//  byte order, extents and where the payload starts; the payload is cache
+//  line aligned, so a mapped file is used in place without copy or parse.
+//
+//  matrix payload: rows x cols row major, row stride = leading dimension.
+//  vec_array payload: s component arrays of size elements, component
+//  stride = leading dimension (padded to a cache line).
+//
+//  errors are reported as io_status values. mapping needs a POSIX system.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "matrix.hpp"
+#include "dynamic_matrix.hpp"
+#include "vec_array.hpp"
+#include "aligned_allocator.hpp"
+
+namespace bbb {
+    enum class io_status {
+        ok,
+        open_failed,
+        write_failed,
+        map_failed,
+        bad_magic,
+        unsupported_version,
+        byte_order_mismatch,
+        kind_mismatch,
+        type_mismatch,
+        size_mismatch,
+        bad_layout,
+        truncated
+    };
+
+    namespace binary {
+        constexpr std::uint32_t version = 1;
+        constexpr std::uint32_t byte_order_mark = 0x01020304u;
+
+        enum class kind : std::uint16_t { matrix = 1, vec_array = 2 };
+
+        template <typename value_t> struct type_code;
+        template <> struct type_code<float> : std::integral_constant<std::uint16_t, 1> {};
+        template <> struct type_code<double> : std::integral_constant<std::uint16_t, 2> {};
+        template <> struct type_code<std::int32_t> : std::integral_constant<std::uint16_t, 3> {};
+        template <> struct type_code<std::int64_t> : std::integral_constant<std::uint16_t, 4> {};
+
+        struct header {
+            char magic[4];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint16_t kind;
+            std::uint16_t value_type;
+            std::uint32_t value_size;
+            std::uint32_t alignment;
+            std::uint64_t rows;
+            std::uint64_t cols;
+            std::uint64_t leading_dimension;
+            std::uint64_t payload_offset;
+            std::uint8_t reserved[8];
+        };
+        static_assert(sizeof(header) == 64, "required: header is one cache line");
+
+        constexpr char magic[4] = {'B', 'B', 'B', '1'};
+
+        template <typename value_t>
+        header make_header(kind k, std::uint64_t rows, std::uint64_t cols, std::uint64_t ld) {
+            header h;
+            std::memset(&h, 0, sizeof(h));
+            std::memcpy(h.magic, magic, sizeof(h.magic));
+            h.version = version;
+            h.byte_order = byte_order_mark;
+            h.kind = static_cast<std::uint16_t>(k);
+            h.value_type = type_code<value_t>::value;
+            h.value_size = sizeof(value_t);
+            h.alignment = cache_line_size;
+            h.rows = rows;
+            h.cols = cols;
+            h.leading_dimension = ld;
+            h.payload_offset = sizeof(header);
+            return h;
+        }
+
+        template <typename value_t>
+        io_status check(const header &h, std::size_t file_size, kind k) {
+            if(file_size < sizeof(header) || std::memcmp(h.magic, magic, sizeof(h.magic))) return io_status::bad_magic;
+            if(h.byte_order != byte_order_mark) return io_status::byte_order_mismatch;
+            if(h.version != version) return io_status::unsupported_version;
+            if(h.kind != static_cast<std::uint16_t>(k)) return io_status::kind_mismatch;
+            if(h.value_type != type_code<value_t>::value || h.value_size != sizeof(value_t)) return io_status::type_mismatch;
+            const std::uint64_t count = k == kind::matrix ? h.rows : h.cols;
+            const std::uint64_t extent = k == kind::matrix ? h.cols : h.rows;
+            if(h.payload_offset < sizeof(header) || h.payload_offset % cache_line_size || h.leading_dimension < extent) return io_status::bad_layout;
+            // the extents are untrusted: compare by division so no product can wrap.
+            if(file_size < h.payload_offset) return io_status::truncated;
+            const std::uint64_t available = (file_size - h.payload_offset) / sizeof(value_t);
+            if(h.leading_dimension != 0 && available / h.leading_dimension < count) return io_status::truncated;
+            return io_status::ok;
+        }
+
+        // elements per vec_array component, padded to whole cache lines
+        template <typename value_t>
+        std::size_t padded(std::size_t size) {
+            const std::size_t lane = cache_line_size / sizeof(value_t) ? cache_line_size / sizeof(value_t) : 1;
+            return (size + lane - 1) / lane * lane;
+        }
+
+        template <typename value_t>
+        io_status write_matrix(const std::string &path, const value_t *data, std::size_t rows, std::size_t cols, std::size_t ld) {
+            std::ofstream os(path, std::ios::binary | std::ios::trunc);
+            if(!os) return io_status::open_failed;
+            const header h = make_header<value_t>(kind::matrix, rows, cols, cols);
+            os.write(reinterpret_cast<const char *>(&h), sizeof(h));
+            for(std::size_t i = 0; i < rows; i++) os.write(reinterpret_cast<const char *>(data + i * ld), cols * sizeof(value_t));
+            return os ? io_status::ok : io_status::write_failed;
+        }
+    };
+
+    // read-only row major view; takes part in matrix expressions.
+    template <typename value_t>
+    struct matrix_view : matrix_expression_tag {
+        using value_type = value_t;
+        static constexpr std::size_t row_extent = dynamic_extent;
+        static constexpr std::size_t column_extent = dynamic_extent;
+
+        matrix_view()
+        : ptr(nullptr), rows(0), cols(0), ld(0) {}
+        matrix_view(const value_t *data, std::size_t rows, std::size_t cols, std::size_t ld)
+        : ptr(data), rows(rows), cols(cols), ld(ld) {}
+
+        std::size_t row_size() const { return rows; }
+        std::size_t column_size() const { return cols; }
+        std::size_t leading_dimension() const { return ld; }
+        bool empty() const { return rows == 0 || cols == 0; }
+
+        const value_t *data() const { return ptr; }
+        const value_t *row(std::size_t i) const { return ptr + i * ld; }
+        const value_t *operator[](std::size_t i) const { return row(i); }
+        const value_t &operator()(std::size_t i, std::size_t j) const { return ptr[i * ld + j]; }
+
+        dynamic_matrix<value_t> eval() const { return dynamic_matrix<value_t>(*this); }
+
+    private:
+        const value_t *ptr;
+        std::size_t rows, cols, ld;
+    };
+
+    namespace detail {
+        template <typename value_t>
+        inline dense_operand<value_t> make_dense_operand(const matrix_view<value_t> &m) {
+            return {m.data(), m.row_size(), m.column_size(), m.leading_dimension(), 1};
+        }
+    };
+
+    template <typename value_t>
+    dynamic_matrix<value_t> operator*(const matrix_view<value_t> &lhs, const matrix_view<value_t> &rhs) {
+        dynamic_matrix<value_t> res;
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    template <typename value_t, typename allocator>
+    dynamic_matrix<value_t, allocator> operator*(const matrix_view<value_t> &lhs, const dynamic_matrix<value_t, allocator> &rhs) {
+        dynamic_matrix<value_t, allocator> res(rhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    template <typename value_t, typename allocator>
+    dynamic_matrix<value_t, allocator> operator*(const dynamic_matrix<value_t, allocator> &lhs, const matrix_view<value_t> &rhs) {
+        dynamic_matrix<value_t, allocator> res(lhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    // read-only structure-of-arrays view, laid out like vec_array.
+    template <std::size_t s, typename value_t>
+    struct vec_array_view {
+        using value_type = vec<s, value_t>;
+        using component_type = value_t;
+
+        vec_array_view()
+        : base(nullptr), count(0), stride(0) {}
+        vec_array_view(const value_t *data, std::size_t size, std::size_t stride)
+        : base(data), count(size), stride(stride) {}
+
+        constexpr std::size_t dimension() const { return s; }
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        const value_t *component(std::size_t k) const { return base + k * stride; }
+
+        vec<s, value_t> operator[](std::size_t index) const {
+            vec<s, value_t> v;
+            for(std::size_t k = 0; k < s; k++) v[k] = component(k)[index];
+            return v;
+        }
+
+        vec_array<s, value_t> to_vec_array() const {
+            vec_array<s, value_t> res(count);
+            for(std::size_t k = 0; k < s; k++) std::copy(component(k), component(k) + count, res.component(k));
+            return res;
+        }
+
+    private:
+        const value_t *base;
+        std::size_t count, stride;
+    };
+
+    // read-only memory mapping of a whole file; unmapped on destruction.
+    struct mapped_file {
+        mapped_file() = default;
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+        mapped_file(mapped_file &&f) noexcept
+        : address(f.address), length(f.length) { f.address = nullptr; f.length = 0; }
+        mapped_file &operator=(mapped_file &&f) noexcept {
+            if(this != &f) {
+                close();
+                address = f.address;
+                length = f.length;
+                f.address = nullptr;
+                f.length = 0;
+            }
+            return *this;
+        }
+        ~mapped_file() { close(); }
+
+        io_status open(const std::string &path) {
+            close();
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0) return io_status::open_failed;
+            struct stat st;
+            if(::fstat(fd, &st) != 0) {
+                ::close(fd);
+                return io_status::open_failed;
+            }
+            length = static_cast<std::size_t>(st.st_size);
+            if(length) {
+                void *p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p == MAP_FAILED) {
+                    ::close(fd);
+                    length = 0;
+                    return io_status::map_failed;
+                }
+                address = p;
+            }
+            ::close(fd);
+            return io_status::ok;
+        }
+
+        void close() {
+            if(address) ::munmap(address, length);
+            address = nullptr;
+            length = 0;
+        }
+
+        bool is_open() const { return address != nullptr; }
+        const unsigned char *data() const { return static_cast<const unsigned char *>(address); }
+        std::size_t size() const { return length; }
+
+    private:
+        void *address{nullptr};
+        std::size_t length{0};
+    };
+
+    template <typename value_t>
+    struct mapped_matrix {
+        io_status open(const std::string &path) {
+            mat = matrix_view<value_t>();
+            const io_status status = file.open(path);
+            if(status != io_status::ok) return status;
+            binary::header h;
+            if(file.size() < sizeof(h)) return io_status::bad_magic;
+            std::memcpy(&h, file.data(), sizeof(h));
+            const io_status checked = binary::check<value_t>(h, file.size(), binary::kind::matrix);
+            if(checked != io_status::ok) return checked;
+            mat = matrix_view<value_t>(reinterpret_cast<const value_t *>(file.data() + h.payload_offset), h.rows, h.cols, h.leading_dimension);
+            return io_status::ok;
+        }
+
+        const matrix_view<value_t> &view() const { return mat; }
+
+    private:
+        mapped_file file;
+        matrix_view<value_t> mat;
+    };
+
+    template <std::size_t s, typename value_t>
+    struct mapped_vec_array {
+        io_status open(const std::string &path) {
+            arr = vec_array_view<s, value_t>();
+            const io_status status = file.open(path);
+            if(status != io_status::ok) return status;
+            binary::header h;
+            if(file.size() < sizeof(h)) return io_status::bad_magic;
+            std::memcpy(&h, file.data(), sizeof(h));
+            const io_status checked = binary::check<value_t>(h, file.size(), binary::kind::vec_array);
+            if(checked != io_status::ok) return checked;
+            if(h.cols != s) return io_status::size_mismatch;
+            arr = vec_array_view<s, value_t>(reinterpret_cast<const value_t *>(file.data() + h.payload_offset), h.rows, h.leading_dimension);
+            return io_status::ok;
+        }
+
+        const vec_array_view<s, value_t> &view() const { return arr; }
+
+    private:
+        mapped_file file;
+        vec_array_view<s, value_t> arr;
+    };
+
+    template <std::size_t row_num, std::size_t col_num, typename value_t>
+    io_status write(const std::string &path, const matrix<row_num, col_num, value_t> &m) {
+        return binary::write_matrix(path, m.raw_data(), row_num, col_num, col_num);
+    }
+
+    template <typename value_t, typename allocator>
+    io_status write(const std::string &path, const dynamic_matrix<value_t, allocator> &m) {
+        return binary::write_matrix(path, m.data(), m.row_size(), m.column_size(), m.leading_dimension());
+    }
+
+    template <typename value_t>
+    io_status write(const std::string &path, const matrix_view<value_t> &m) {
+        return binary::write_matrix(path, m.data(), m.row_size(), m.column_size(), m.leading_dimension());
+    }
+
+    template <std::size_t s, typename value_t>
+    io_status write(const std::string &path, const vec_array<s, value_t> &a) {
+        std::ofstream os(path, std::ios::binary | std::ios::trunc);
+        if(!os) return io_status::open_failed;
+        const std::size_t stride = binary::padded<value_t>(a.size());
+        const binary::header h = binary::make_header<value_t>(binary::kind::vec_array, a.size(), s, stride);
+        os.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        const std::vector<value_t> padding(stride - a.size(), value_t(0));
+        for(std::size_t k = 0; k < s; k++) {
+            os.write(reinterpret_cast<const char *>(a.component(k)), a.size() * sizeof(value_t));
+            os.write(reinterpret_cast<const char *>(padding.data()), padding.size() * sizeof(value_t));
+        }
+        return os ? io_status::ok : io_status::write_failed;
+    }
+
+    // copies a stored matrix of exactly row_num x col_num into m.
+    template <std::size_t row_num, std::size_t col_num, typename value_t>
+    io_status read(const std::string &path, matrix<row_num, col_num, value_t> &m) {
+        mapped_matrix<value_t> mapped;
+        const io_status status = mapped.open(path);
+        if(status != io_status::ok) return status;
+        if(mapped.view().row_size() != row_num || mapped.view().column_size() != col_num) return io_status::size_mismatch;
+        m = mapped.view();
+        return io_status::ok;
+    }
+};
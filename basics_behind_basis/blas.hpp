@@ -0,0 +1,222 @@
+//
+//  blas.hpp
+//
+//  fused level 1-3 updates that write into storage the caller owns:
+//
+//      axpy(alpha, x, y)                  y = alpha x + y
+//      gemv(alpha, A, x, beta, y)         y = alpha op(A) x + beta y
+//      gemm(alpha, A, B, beta, C)         C = alpha op(A) op(B) + beta C
+//
+//  op() is an optional blas::op::transpose in front of the operands.
+//  matrices are matrix, dynamic_matrix or any strided_view (so blocks and
+//  slices can be updated in place); vectors are vec, std::vector, n x 1 /
+//  1 x n matrices or single row / column views. nothing is allocated and
+//  no temporary of the result is formed. as in BLAS, beta == 0 overwrites
+//  the output without reading it, and alpha == 0 does not read A, B or x.
+//  the output must not overlap the inputs.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "matrix.hpp"
+#include "vec.hpp"
+#include "dynamic_matrix.hpp"
+#include "strided_view.hpp"
+#include "gemm.hpp"
+#include "simd.hpp"
+#include "reduction.hpp"
+#include "thread_pool.hpp"
+#include "instrumentation.hpp"
+
+namespace bbb {
+    namespace blas {
+        enum class op {
+            none,
+            transpose
+        };
+
+        namespace detail {
+            template <typename value_t>
+            struct vector_ref {
+                value_t *data;
+                std::size_t size;
+                std::ptrdiff_t inc;
+
+                value_t &operator[](std::size_t i) const { return data[static_cast<std::ptrdiff_t>(i) * inc]; }
+            };
+
+            template <typename value_t>
+            vector_ref<const value_t> read_only(const vector_ref<value_t> &v) { return {v.data, v.size, v.inc}; }
+
+            template <std::size_t s, typename value_t>
+            vector_ref<value_t> vector_of(base_vec<s, value_t> &v) { return {&v[0], s, 1}; }
+            template <std::size_t s, typename value_t>
+            vector_ref<const value_t> vector_of(const base_vec<s, value_t> &v) { return {&v[0], s, 1}; }
+
+            template <typename value_t, typename allocator>
+            vector_ref<value_t> vector_of(std::vector<value_t, allocator> &v) { return {v.data(), v.size(), 1}; }
+            template <typename value_t, typename allocator>
+            vector_ref<const value_t> vector_of(const std::vector<value_t, allocator> &v) { return {v.data(), v.size(), 1}; }
+
+            template <std::size_t row_num, std::size_t col_num, typename value_t>
+            vector_ref<value_t> vector_of(matrix<row_num, col_num, value_t> &m) {
+                static_assert(row_num == 1 || col_num == 1, "required: a single row or column");
+                return {m.raw_data(), row_num * col_num, 1};
+            }
+            template <std::size_t row_num, std::size_t col_num, typename value_t>
+            vector_ref<const value_t> vector_of(const matrix<row_num, col_num, value_t> &m) {
+                static_assert(row_num == 1 || col_num == 1, "required: a single row or column");
+                return {m.raw_data(), row_num * col_num, 1};
+            }
+
+            template <typename value_t, std::size_t row_num, std::size_t col_num>
+            vector_ref<value_t> vector_of(const strided_view<value_t, row_num, col_num> &v) {
+                static_assert(row_num == dynamic_extent || col_num == dynamic_extent || row_num == 1 || col_num == 1, "required: a single row or column");
+                assert(v.row_size() == 1 || v.column_size() == 1);
+                if(v.row_size() == 1) return {v.data(), v.column_size(), v.column_stride()};
+                return {v.data(), v.row_size(), v.row_stride()};
+            }
+
+            template <std::size_t row_num, std::size_t col_num, typename value_t>
+            strided_view<value_t> matrix_of(matrix<row_num, col_num, value_t> &m) { return m.view(); }
+            template <std::size_t row_num, std::size_t col_num, typename value_t>
+            strided_view<const value_t> matrix_of(const matrix<row_num, col_num, value_t> &m) { return m.view(); }
+
+            template <typename value_t, typename allocator>
+            strided_view<value_t> matrix_of(dynamic_matrix<value_t, allocator> &m) { return m.view(); }
+            template <typename value_t, typename allocator>
+            strided_view<const value_t> matrix_of(const dynamic_matrix<value_t, allocator> &m) { return m.view(); }
+
+            template <typename value_t, std::size_t row_num, std::size_t col_num>
+            strided_view<value_t> matrix_of(const strided_view<value_t, row_num, col_num> &v) { return v; }
+
+            template <typename value_t>
+            strided_view<const value_t> apply(op o, const strided_view<const value_t> &m) {
+                return o == op::transpose ? m.t() : m;
+            }
+
+            template <typename value_t>
+            void axpy(value_t alpha, const vector_ref<const value_t> &x, const vector_ref<value_t> &y) {
+                assert(x.size == y.size);
+                if(alpha == value_t(0)) return;
+                if(x.inc == 1 && y.inc == 1) simd::axpy(y.data, alpha, x.data, x.size);
+                else for(std::size_t i = 0; i < x.size; i++) y[i] += alpha * x[i];
+            }
+
+            // y = beta y, with beta == 0 writing zeros.
+            template <typename value_t>
+            void scale(value_t beta, const vector_ref<value_t> &y) {
+                if(beta == value_t(1)) return;
+                if(beta == value_t(0)) for(std::size_t i = 0; i < y.size; i++) y[i] = value_t(0);
+                else if(y.inc == 1) simd::scale(y.data, beta, y.size);
+                else for(std::size_t i = 0; i < y.size; i++) y[i] *= beta;
+            }
+
+            template <typename value_t>
+            void scale(value_t beta, const strided_view<value_t> &c) {
+                if(beta == value_t(1)) return;
+                if(c.column_stride() == 1 || c.row_size() == 1) {
+                    for(std::size_t i = 0; i < c.row_size(); i++) scale(beta, vector_ref<value_t>{&c(i, 0), c.column_size(), c.column_stride()});
+                } else {
+                    for(std::size_t j = 0; j < c.column_size(); j++) scale(beta, vector_ref<value_t>{&c(0, j), c.row_size(), c.row_stride()});
+                }
+            }
+
+            template <typename value_t>
+            void gemv(value_t alpha, const strided_view<const value_t> &a, const vector_ref<const value_t> &x, value_t beta, const vector_ref<value_t> &y) {
+                const std::size_t m = a.row_size(), n = a.column_size();
+                assert(x.size == n && y.size == m);
+                BBB_INSTRUMENT_SPAN(multiply, m, 1, n, 2 * m * n, (m * n + n + 2 * m) * sizeof(value_t));
+                scale(beta, y);
+                if(alpha == value_t(0) || m == 0 || n == 0) return;
+                if(a.column_stride() == 1 && x.inc == 1) {
+                    // rows of A are contiguous: one dot per output.
+                    for(std::size_t i = 0; i < m; i++) {
+                        y[i] += value_t(alpha * reduction::detail::dot(&a(i, 0), x.data, n, simd::is_dispatchable<value_t>{}));
+                    }
+                } else if(a.row_stride() == 1 && y.inc == 1) {
+                    // columns of A are contiguous (a transposed row major matrix): one axpy per input.
+                    for(std::size_t j = 0; j < n; j++) axpy(value_t(alpha * x[j]), vector_ref<const value_t>{&a(0, j), m, 1}, y);
+                } else {
+                    using acc_t = accumulator_t<value_t>;
+                    for(std::size_t i = 0; i < m; i++) {
+                        acc_t sum{0};
+                        for(std::size_t j = 0; j < n; j++) sum += acc_t(a(i, j)) * acc_t(x[j]);
+                        y[i] += value_t(alpha * sum);
+                    }
+                }
+            }
+
+            template <typename value_t>
+            void gemm(thread_pool *pool, value_t alpha, const strided_view<const value_t> &a, const strided_view<const value_t> &b, value_t beta, const strided_view<value_t> &c) {
+                const std::size_t m = a.row_size(), k = a.column_size(), n = b.column_size();
+                assert(b.row_size() == k && c.row_size() == m && c.column_size() == n);
+                assert(0 <= a.row_stride() && 0 <= a.column_stride() && 0 <= b.row_stride() && 0 <= b.column_stride());
+                BBB_INSTRUMENT_SPAN(multiply, m, n, k, 2 * m * n * k, (m * k + k * n + 2 * m * n) * sizeof(value_t));
+                scale(beta, c);
+                if(alpha == value_t(0) || m == 0 || n == 0 || k == 0) return;
+                if(m * n * k < bbb::detail::gemm::threshold) {
+                    for(std::size_t i = 0; i < m; i++) {
+                        const vector_ref<value_t> c_i{&c(i, 0), n, c.column_stride()};
+                        for(std::size_t p = 0; p < k; p++) axpy(value_t(alpha * a(i, p)), vector_ref<const value_t>{&b(p, 0), n, b.column_stride()}, c_i);
+                    }
+                    return;
+                }
+                bbb::detail::gemm::multiply(pool, m, n, k,
+                                            a.data(), a.row_stride(), a.column_stride(),
+                                            b.data(), b.row_stride(), b.column_stride(),
+                                            c.data(), c.row_stride(), c.column_stride(),
+                                            alpha);
+            }
+        };
+
+        // y = alpha x + y
+        template <typename value_t, typename x_type, typename y_type>
+        void axpy(value_t alpha, const x_type &x, y_type &&y) {
+            const auto out = detail::vector_of(y);
+            using out_t = typename std::remove_reference<decltype(*out.data)>::type;
+            detail::axpy<out_t>(out_t(alpha), detail::read_only(detail::vector_of(x)), out);
+        }
+
+        // y = alpha op(A) x + beta y
+        template <typename value_t, typename a_type, typename x_type, typename y_type>
+        void gemv(op op_a, value_t alpha, const a_type &a, const x_type &x, value_t beta, y_type &&y) {
+            const auto out = detail::vector_of(y);
+            using out_t = typename std::remove_reference<decltype(*out.data)>::type;
+            const strided_view<const out_t> a_view = detail::matrix_of(a);
+            detail::gemv<out_t>(out_t(alpha), detail::apply(op_a, a_view), detail::read_only(detail::vector_of(x)), out_t(beta), out);
+        }
+
+        template <typename value_t, typename a_type, typename x_type, typename y_type>
+        void gemv(value_t alpha, const a_type &a, const x_type &x, value_t beta, y_type &&y) {
+            gemv(op::none, alpha, a, x, beta, std::forward<y_type>(y));
+        }
+
+        // C = alpha op(A) op(B) + beta C; large products are split over the pool of the policy.
+        template <typename policy, typename value_t, typename a_type, typename b_type, typename c_type>
+        auto gemm(const policy &p, op op_a, op op_b, value_t alpha, const a_type &a, const b_type &b, value_t beta, c_type &&c)
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+        {
+            const auto out = detail::matrix_of(c);
+            using out_t = typename std::remove_reference<decltype(*out.data())>::type;
+            const strided_view<const out_t> a_view = detail::matrix_of(a), b_view = detail::matrix_of(b);
+            detail::gemm<out_t>(execution::pool_of(p), out_t(alpha), detail::apply(op_a, a_view), detail::apply(op_b, b_view), out_t(beta), out);
+        }
+
+        template <typename value_t, typename a_type, typename b_type, typename c_type>
+        void gemm(op op_a, op op_b, value_t alpha, const a_type &a, const b_type &b, value_t beta, c_type &&c) {
+            gemm(execution::seq, op_a, op_b, alpha, a, b, beta, std::forward<c_type>(c));
+        }
+
+        template <typename value_t, typename a_type, typename b_type, typename c_type>
+        void gemm(value_t alpha, const a_type &a, const b_type &b, value_t beta, c_type &&c) {
+            gemm(execution::seq, op::none, op::none, alpha, a, b, beta, std::forward<c_type>(c));
+        }
+    };
+};
@@ -0,0 +1,231 @@
+//
+//  cholesky_factorization.hpp
+//
+//  A = L L^T for symmetric positive definite A, at half the flops of LU
+//  and without pivoting. only the lower triangle of A is read, and L is
+//  kept with zeros above the diagonal. factor once, then solve /
+//  determinant / log_determinant / inverse reuse it.
+//
+//  matrices of 2 * block rows and more are factored a block column at a
+//  time: the block below the diagonal is a triangular solve split over
+//  rows, and the symmetric trailing update is a gemm per block row that
+//  stops at the diagonal, so only the lower half is computed. both use
+//  the pool of factorize(execution::par, a).
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "numeric.hpp"
+#include "matrix.hpp"
+#include "dynamic_matrix.hpp"
+#include "lu_factorization.hpp"
+#include "gemm.hpp"
+#include "thread_pool.hpp"
+#include "instrumentation.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace cholesky {
+            // columns of one block column in the blocked factorization.
+            constexpr std::size_t block = 64;
+
+            // unblocked factorization of the n x n diagonal block at a, row by row with
+            // contiguous dot products. false if a pivot is not positive.
+            template <typename value_t>
+            bool factor_diagonal(std::size_t n, value_t *a, std::size_t ld) {
+                using acc_t = accumulator_t<value_t>;
+                for(std::size_t j = 0; j < n; j++) {
+                    value_t *row_j = a + j * ld;
+                    acc_t d = acc_t(row_j[j]);
+                    for(std::size_t p = 0; p < j; p++) d -= acc_t(row_j[p]) * acc_t(row_j[p]);
+                    if(!(acc_t(0) < d)) return false;
+                    row_j[j] = value_t(std::sqrt(d));
+                    const acc_t inverse = acc_t(1) / acc_t(row_j[j]);
+                    for(std::size_t i = j + 1; i < n; i++) {
+                        value_t *row_i = a + i * ld;
+                        acc_t sum = acc_t(row_i[j]);
+                        for(std::size_t p = 0; p < j; p++) sum -= acc_t(row_i[p]) * acc_t(row_j[p]);
+                        row_i[j] = value_t(sum * inverse);
+                    }
+                }
+                return true;
+            }
+
+            // rows [i0, i1) of the block below the diagonal block at (k0, k0): A21 = A21 L11^-T.
+            template <typename value_t>
+            void solve_rows(value_t *a, std::size_t ld, std::size_t k0, std::size_t nb, std::size_t i0, std::size_t i1) {
+                using acc_t = accumulator_t<value_t>;
+                const value_t *l11 = a + k0 * ld + k0;
+                for(std::size_t i = i0; i < i1; i++) {
+                    value_t *row_i = a + i * ld + k0;
+                    for(std::size_t j = 0; j < nb; j++) {
+                        const value_t *row_j = l11 + j * ld;
+                        acc_t sum = acc_t(row_i[j]);
+                        for(std::size_t p = 0; p < j; p++) sum -= acc_t(row_i[p]) * acc_t(row_j[p]);
+                        row_i[j] = value_t(sum / acc_t(row_j[j]));
+                    }
+                }
+            }
+
+            // the lower triangle of the n x n block at a is overwritten by L and the strict
+            // upper triangle by zeros. false if A is not (numerically) positive definite.
+            template <typename value_t>
+            bool factor(std::size_t n, value_t *a, std::size_t ld, thread_pool *pool = nullptr) {
+                bool positive = true;
+                if(n < 2 * block) positive = factor_diagonal(n, a, ld);
+                else for(std::size_t k0 = 0; k0 < n && positive; k0 += block) {
+                    const std::size_t nb = std::min(block, n - k0), rest = k0 + nb;
+                    positive = factor_diagonal(nb, a + k0 * ld + k0, ld);
+                    if(!positive || rest == n) break;
+
+                    // L21 = A21 L11^-T, in row chunks
+                    const std::size_t chunk = block, chunk_num = (n - rest + chunk - 1) / chunk;
+                    const auto solve_chunk = [=](std::size_t c) {
+                        solve_rows(a, ld, k0, nb, rest + c * chunk, std::min(n, rest + (c + 1) * chunk));
+                    };
+                    if(pool) pool->parallel_for(chunk_num, solve_chunk);
+                    else for(std::size_t c = 0; c < chunk_num; c++) solve_chunk(c);
+
+                    // A22 -= L21 L21^T, one block row at a time up to its diagonal block
+                    for(std::size_t r0 = rest; r0 < n; r0 += block) {
+                        const std::size_t r1 = std::min(n, r0 + block);
+                        gemm::multiply(pool, r1 - r0, r1 - rest, nb,
+                                       a + r0 * ld + k0, ld, 1,
+                                       a + rest * ld + k0, 1, ld,
+                                       a + r0 * ld + rest, ld, 1,
+                                       value_t(-1));
+                    }
+                }
+                for(std::size_t i = 0; i < n; i++) std::fill(a + i * ld + i + 1, a + i * ld + n, value_t(0));
+                return positive;
+            }
+
+            // b (n x nrhs, row stride ldb) is overwritten by the solution of L L^T x = b.
+            template <typename value_t>
+            void substitute(std::size_t n, const value_t *l, std::size_t ld, value_t *b, std::size_t ldb, std::size_t nrhs) {
+                for(std::size_t i = 0; i < n; i++) {
+                    value_t *b_i = b + i * ldb;
+                    const value_t *row_i = l + i * ld;
+                    for(std::size_t k = 0; k < i; k++) {
+                        const value_t f = row_i[k];
+                        const value_t *b_k = b + k * ldb;
+                        for(std::size_t j = 0; j < nrhs; j++) b_i[j] -= f * b_k[j];
+                    }
+                    const value_t inverse = value_t(1) / row_i[i];
+                    for(std::size_t j = 0; j < nrhs; j++) b_i[j] *= inverse;
+                }
+                // L^T x = y by rows of L: x_i is final once the rows below have been subtracted.
+                for(std::size_t i = n; i-- > 0;) {
+                    value_t *b_i = b + i * ldb;
+                    const value_t *row_i = l + i * ld;
+                    const value_t inverse = value_t(1) / row_i[i];
+                    for(std::size_t j = 0; j < nrhs; j++) b_i[j] *= inverse;
+                    for(std::size_t k = 0; k < i; k++) {
+                        const value_t f = row_i[k];
+                        value_t *b_k = b + k * ldb;
+                        for(std::size_t j = 0; j < nrhs; j++) b_k[j] -= f * b_i[j];
+                    }
+                }
+            }
+        };
+    };
+
+    template <typename matrix_type>
+    struct cholesky_factorization {
+        using value_type = typename matrix_type::value_type;
+
+        cholesky_factorization() = default;
+        explicit cholesky_factorization(const matrix_type &a) { factorize(a); }
+        template <typename policy, typename std::enable_if<execution::is_execution_policy<policy>::value>::type * = nullptr>
+        cholesky_factorization(const policy &p, const matrix_type &a) { factorize(p, a); }
+
+        // reuses the storage of a previous factorization when the size matches.
+        cholesky_factorization &factorize(const matrix_type &a) {
+            return factorize(execution::seq, a);
+        }
+
+        template <typename policy>
+        auto factorize(const policy &p, const matrix_type &a)
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, cholesky_factorization &>::type
+        {
+            assert(a.row_size() == a.column_size());
+            const std::size_t n = a.row_size();
+            BBB_INSTRUMENT_SPAN(cholesky_decomposition, n, n, 0, n * n * n / 3, n * n * sizeof(value_type));
+            l = a;
+            positive = detail::cholesky::factor(n, detail::storage_of(l), detail::stride_of(l), execution::pool_of(p));
+            return *this;
+        }
+
+        std::size_t size() const { return l.row_size(); }
+        // false when a pivot was not positive; L is then incomplete.
+        bool is_positive_definite() const { return positive; }
+
+        // L, zero above the diagonal.
+        const matrix_type &factor() const { return l; }
+
+        value_type determinant() const {
+            assert(positive);
+            value_type det{1};
+            for(std::size_t i = 0; i < size(); i++) det *= l(i, i) * l(i, i);
+            return det;
+        }
+
+        // log det A, which does not overflow for large covariance matrices.
+        value_type log_determinant() const {
+            assert(positive);
+            value_type sum{0};
+            for(std::size_t i = 0; i < size(); i++) sum += std::log(l(i, i));
+            return value_type(2) * sum;
+        }
+
+        // b is an n x k matrix of right hand sides, a row_vector<n> / column_vector<n> or a std::vector.
+        template <typename rhs_type>
+        rhs_type solve(const rhs_type &b) const {
+            rhs_type x = b;
+            solve_in_place(x);
+            return x;
+        }
+
+        template <typename rhs_type>
+        void solve_in_place(rhs_type &b) const {
+            const detail::rhs_block<value_type> block = detail::as_rhs(b, size());
+            solve_in_place(block.data, block.ld, block.count);
+        }
+
+        // n x nrhs block with row stride ldb, overwritten by the solution.
+        void solve_in_place(value_type *b, std::size_t ldb, std::size_t nrhs) const {
+            assert(positive);
+            const std::size_t n = size();
+            BBB_INSTRUMENT_SPAN(cholesky_solve, n, n, nrhs, 2 * n * n * nrhs, (n * n / 2 + 2 * n * nrhs) * sizeof(value_type));
+            detail::cholesky::substitute(n, detail::storage_of(l), detail::stride_of(l), b, ldb, nrhs);
+        }
+
+        matrix_type inverse() const {
+            matrix_type inv = l;
+            const std::size_t n = size();
+            value_type *data = detail::storage_of(inv);
+            const std::size_t ld = detail::stride_of(inv);
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) data[i * ld + j] = value_type(i == j);
+            }
+            solve_in_place(data, ld, n);
+            return inv;
+        }
+
+    private:
+        matrix_type l;
+        bool positive{false};
+    };
+
+    template <typename matrix_type>
+    inline cholesky_factorization<matrix_type> make_cholesky_factorization(const matrix_type &a) {
+        return cholesky_factorization<matrix_type>(a);
+    }
+};
@@ -0,0 +1,433 @@
+//
+//  dynamic_matrix.hpp
+//
+//  run time sized, heap allocated row major matrix. rows start on a cache
+//  line: the leading dimension is padded up to a multiple of 64 bytes.
+//  takes part in the same expressions and products as the fixed matrix.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#include "matrix.hpp"
+#include "aligned_allocator.hpp"
+#include "pool_allocator.hpp"
+#include "thread_pool.hpp"
+#include "instrumentation.hpp"
+
+namespace bbb {
+    template <typename value_t = default_value_t, typename allocator = aligned_allocator<value_t>>
+    struct dynamic_matrix;
+
+    namespace detail {
+        template <std::size_t col_num, typename value_t>
+        struct evaluated_matrix<dynamic_extent, col_num, value_t> { using type = dynamic_matrix<value_t>; };
+        template <std::size_t row_num, typename value_t>
+        struct evaluated_matrix<row_num, dynamic_extent, value_t> { using type = dynamic_matrix<value_t>; };
+        template <typename value_t>
+        struct evaluated_matrix<dynamic_extent, dynamic_extent, value_t> { using type = dynamic_matrix<value_t>; };
+    };
+
+    template <typename value_t, typename allocator>
+    struct dynamic_matrix : matrix_expression_tag {
+        using value_type = value_t;
+        using allocator_type = allocator;
+        using container_type = std::vector<value_t, allocator>;
+
+        static constexpr std::size_t row_extent = dynamic_extent;
+        static constexpr std::size_t column_extent = dynamic_extent;
+
+        explicit dynamic_matrix(const allocator &alloc = allocator())
+        : rows(0), cols(0), ld(0), storage(alloc) {}
+
+        dynamic_matrix(std::size_t rows, std::size_t cols, const allocator &alloc = allocator())
+        : rows(rows), cols(cols), ld(padded(cols)), storage(rows * padded(cols), value_t(), alloc) {}
+
+        dynamic_matrix(std::size_t rows, std::size_t cols, value_t x, const allocator &alloc = allocator())
+        : dynamic_matrix(rows, cols, alloc) { fill(x); }
+
+        template <typename expression, typename std::enable_if<is_matrix_expression<expression>::value && !std::is_base_of<dynamic_matrix, expression>::value>::type * = nullptr>
+        dynamic_matrix(const expression &e, const allocator &alloc = allocator())
+        : dynamic_matrix(e.row_size(), e.column_size(), alloc) { assign(e); }
+
+        dynamic_matrix(const dynamic_matrix &) = default;
+        dynamic_matrix(dynamic_matrix &&m) noexcept
+        : rows(m.rows), cols(m.cols), ld(m.ld), storage(std::move(m.storage)) { m.rows = m.cols = m.ld = 0; }
+
+        dynamic_matrix &operator=(const dynamic_matrix &) = default;
+        dynamic_matrix &operator=(dynamic_matrix &&m) noexcept {
+            storage = std::move(m.storage);
+            rows = m.rows;
+            cols = m.cols;
+            ld = m.ld;
+            m.rows = m.cols = m.ld = 0;
+            return *this;
+        }
+
+        template <typename expression>
+        auto operator=(const expression &e)
+        -> typename std::enable_if<is_matrix_expression<expression>::value && !std::is_base_of<dynamic_matrix, expression>::value, dynamic_matrix &>::type
+        {
+            // checked against the layout after resize, which keeps or reallocates the buffer.
+            if(detail::aliases(e, detail::span_of(storage.data(), e.row_size(), e.column_size(), padded(e.column_size()), 1))) return *this = copy_of(e);
+            resize(e.row_size(), e.column_size());
+            return assign(e);
+        }
+
+        static dynamic_matrix identity(std::size_t size, const allocator &alloc = allocator()) {
+            dynamic_matrix m(size, size, alloc);
+            for(std::size_t i = 0; i < size; i++) m[i][i] = value_t(1);
+            return m;
+        }
+
+        std::size_t row_size() const { return rows; }
+        std::size_t column_size() const { return cols; }
+        // distance in elements between the starts of two consecutive rows
+        std::size_t leading_dimension() const { return ld; }
+        bool empty() const { return rows == 0 || cols == 0; }
+
+        // keeps the buffer when the padded size does not grow; contents are unspecified after a reshape.
+        void resize(std::size_t rows, std::size_t cols) {
+            this->rows = rows;
+            this->cols = cols;
+            ld = padded(cols);
+            if(storage.size() < rows * ld) storage.resize(rows * ld);
+        }
+
+        void fill(value_t x) {
+            for(std::size_t i = 0; i < rows; i++) std::fill(row(i), row(i) + cols, x);
+        }
+
+        value_t *data() { return storage.data(); }
+        const value_t *data() const { return storage.data(); }
+        value_t *row(std::size_t i) { return storage.data() + i * ld; }
+        const value_t *row(std::size_t i) const { return storage.data() + i * ld; }
+
+        inline value_t *operator[](std::size_t i) { return row(i); }
+        inline const value_t *operator[](std::size_t i) const { return row(i); }
+
+        inline value_t &operator()(std::size_t i, std::size_t j) { return storage[i * ld + j]; }
+        inline const value_t &operator()(std::size_t i, std::size_t j) const { return storage[i * ld + j]; }
+
+        allocator get_allocator() const { return storage.get_allocator(); }
+
+        template <typename expression>
+        auto operator+=(const expression &rhs)
+        -> typename std::enable_if<is_matrix_expression<expression>::value, dynamic_matrix &>::type
+        {
+            assert(rhs.row_size() == rows && rhs.column_size() == cols);
+            if(detail::aliases(rhs, span())) return *this += copy_of(rhs);
+            return add_assign(rhs, std::is_base_of<dynamic_matrix, expression>{});
+        }
+
+        template <typename expression>
+        auto operator-=(const expression &rhs)
+        -> typename std::enable_if<is_matrix_expression<expression>::value, dynamic_matrix &>::type
+        {
+            assert(rhs.row_size() == rows && rhs.column_size() == cols);
+            if(detail::aliases(rhs, span())) return *this -= copy_of(rhs);
+            return sub_assign(rhs, std::is_base_of<dynamic_matrix, expression>{});
+        }
+
+        dynamic_matrix &operator*=(value_t scale) {
+            for(std::size_t i = 0; i < rows; i++) simd::scale(row(i), scale, cols);
+            return *this;
+        }
+
+        dynamic_matrix &operator/=(value_t scale) {
+            return *this *= (1.0 / scale);
+        }
+
+        bool operator==(const dynamic_matrix &rhs) const {
+            if(rows != rhs.rows || cols != rhs.cols) return false;
+            for(std::size_t i = 0; i < rows; i++) {
+                if(!std::equal(row(i), row(i) + cols, rhs.row(i))) return false;
+            }
+            return true;
+        }
+        bool operator!=(const dynamic_matrix &rhs) const { return !(*this == rhs); }
+
+        void swap(dynamic_matrix &rhs) {
+            std::swap(rows, rhs.rows);
+            std::swap(cols, rhs.cols);
+            std::swap(ld, rhs.ld);
+            storage.swap(rhs.storage);
+        }
+
+        dynamic_matrix transpose() const {
+            BBB_INSTRUMENT_COUNT(transpose, cols, rows, 0, 0, 2 * rows * cols * sizeof(value_t));
+            dynamic_matrix res(cols, rows, get_allocator());
+            for(std::size_t i = 0; i < rows; i++) {
+                for(std::size_t j = 0; j < cols; j++) {
+                    res[j][i] = (*this)[i][j];
+                }
+            }
+            return res;
+        }
+
+        // zero-copy windows on the elements, see strided_view.hpp.
+        strided_view<value_t> view() { return {storage.data(), rows, cols, static_cast<std::ptrdiff_t>(ld), 1}; }
+        strided_view<const value_t> view() const { return {storage.data(), rows, cols, static_cast<std::ptrdiff_t>(ld), 1}; }
+
+        template <std::size_t block_rows, std::size_t block_cols>
+        strided_view<value_t, block_rows, block_cols> block(std::size_t i, std::size_t j) { return view().template block<block_rows, block_cols>(i, j); }
+        template <std::size_t block_rows, std::size_t block_cols>
+        strided_view<const value_t, block_rows, block_cols> block(std::size_t i, std::size_t j) const { return view().template block<block_rows, block_cols>(i, j); }
+
+        strided_view<value_t> block(std::size_t i, std::size_t j, std::size_t block_rows, std::size_t block_cols) { return view().block(i, j, block_rows, block_cols); }
+        strided_view<const value_t> block(std::size_t i, std::size_t j, std::size_t block_rows, std::size_t block_cols) const { return view().block(i, j, block_rows, block_cols); }
+
+        strided_view<value_t, 1, dynamic_extent> row_view(std::size_t i) { return view().row_view(i); }
+        strided_view<const value_t, 1, dynamic_extent> row_view(std::size_t i) const { return view().row_view(i); }
+
+        strided_view<value_t, dynamic_extent, 1> column_view(std::size_t j) { return view().column_view(j); }
+        strided_view<const value_t, dynamic_extent, 1> column_view(std::size_t j) const { return view().column_view(j); }
+
+        // transposed view; transpose() makes a copy.
+        strided_view<value_t> t() { return view().t(); }
+        strided_view<const value_t> t() const { return view().t(); }
+
+        value_t trace() const {
+            assert(rows == cols);
+            value_t sum{0};
+            for(std::size_t i = 0; i < rows; i++) sum += (*this)[i][i];
+            return sum;
+        }
+
+    private:
+        detail::storage_span span() const { return detail::span_of(storage.data(), rows, cols, ld, 1); }
+
+        template <typename expression>
+        dynamic_matrix copy_of(const expression &e) const {
+            dynamic_matrix copy(e.row_size(), e.column_size(), get_allocator());
+            return copy.assign(e), copy;
+        }
+
+        static std::size_t padded(std::size_t cols) {
+            const std::size_t lane = cache_line_size / sizeof(value_t) ? cache_line_size / sizeof(value_t) : 1;
+            return (cols + lane - 1) / lane * lane;
+        }
+
+        template <typename expression>
+        dynamic_matrix &assign(const expression &rhs) {
+            const detail::operand_t<const expression &> e = rhs;
+            for(std::size_t i = 0; i < rows; i++) {
+                value_t *r = row(i);
+                for(std::size_t j = 0; j < cols; j++) r[j] = e(i, j);
+            }
+            return *this;
+        }
+
+        template <typename expression>
+        dynamic_matrix &add_assign(const expression &e, std::false_type) {
+            const detail::operand_t<const expression &> rhs = e;
+            for(std::size_t i = 0; i < rows; i++) {
+                value_t *r = row(i);
+                for(std::size_t j = 0; j < cols; j++) r[j] += rhs(i, j);
+            }
+            return *this;
+        }
+        dynamic_matrix &add_assign(const dynamic_matrix &rhs, std::true_type) {
+            for(std::size_t i = 0; i < rows; i++) simd::add(row(i), rhs.row(i), cols);
+            return *this;
+        }
+
+        template <typename expression>
+        dynamic_matrix &sub_assign(const expression &e, std::false_type) {
+            const detail::operand_t<const expression &> rhs = e;
+            for(std::size_t i = 0; i < rows; i++) {
+                value_t *r = row(i);
+                for(std::size_t j = 0; j < cols; j++) r[j] -= rhs(i, j);
+            }
+            return *this;
+        }
+        dynamic_matrix &sub_assign(const dynamic_matrix &rhs, std::true_type) {
+            for(std::size_t i = 0; i < rows; i++) simd::sub(row(i), rhs.row(i), cols);
+            return *this;
+        }
+
+        std::size_t rows, cols, ld;
+        container_type storage;
+    };
+
+    namespace detail {
+        template <typename value_t, typename allocator>
+        struct aliasing<dynamic_matrix<value_t, allocator>> {
+            static bool reads(const dynamic_matrix<value_t, allocator> &m, const storage_span &destination) {
+                return conflicts(span_of(m.data(), m.row_size(), m.column_size(), m.leading_dimension(), 1), destination);
+            }
+        };
+    };
+
+    template <typename value_t>
+    using pooled_matrix = dynamic_matrix<value_t, pool_allocator<value_t>>;
+
+    namespace detail {
+        // operand of a product: pointer, extents, row stride ld and column stride cs.
+        template <typename value_t>
+        struct dense_operand {
+            const value_t *data;
+            std::size_t rows, cols, ld, cs;
+        };
+
+        template <typename value_t, typename allocator>
+        inline dense_operand<value_t> make_dense_operand(const dynamic_matrix<value_t, allocator> &m) {
+            return {m.data(), m.row_size(), m.column_size(), m.leading_dimension(), 1};
+        }
+
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        inline dense_operand<value_t> make_dense_operand(const matrix<row_num, col_num, value_t> &m) {
+            return {m.raw_data(), row_num, col_num, col_num, 1};
+        }
+
+        // views with negative strides are not products operands.
+        template <typename value_t, std::size_t row_num, std::size_t col_num>
+        inline dense_operand<typename std::remove_const<value_t>::type> make_dense_operand(const strided_view<value_t, row_num, col_num> &m) {
+            assert(0 <= m.row_stride() && 0 <= m.column_stride());
+            return {m.data(), m.row_size(), m.column_size(), static_cast<std::size_t>(m.row_stride()), static_cast<std::size_t>(m.column_stride())};
+        }
+
+        // c (zero filled, row stride ldc) += a * b
+        template <typename value_t>
+        void multiply_into(const dense_operand<value_t> &a, const dense_operand<value_t> &b, value_t *c, std::size_t ldc, thread_pool *pool = nullptr) {
+            assert(a.cols == b.rows);
+            BBB_INSTRUMENT_SPAN(multiply, a.rows, b.cols, a.cols, 2 * a.rows * b.cols * a.cols, (a.rows * a.cols + b.rows * b.cols + a.rows * b.cols) * sizeof(value_t));
+            if(a.rows * b.cols * a.cols < gemm::threshold) {
+                for(std::size_t i = 0; i < a.rows; i++) {
+                    value_t *c_i = c + i * ldc;
+                    for(std::size_t k = 0; k < a.cols; k++) {
+                        const value_t a_ik = a.data[i * a.ld + k * a.cs];
+                        const value_t *b_k = b.data + k * b.ld;
+                        if(b.cs == 1) for(std::size_t j = 0; j < b.cols; j++) c_i[j] += a_ik * b_k[j];
+                        else for(std::size_t j = 0; j < b.cols; j++) c_i[j] += a_ik * b_k[j * b.cs];
+                    }
+                }
+            } else {
+                gemm::multiply(pool, a.rows, b.cols, a.cols,
+                               a.data, static_cast<std::ptrdiff_t>(a.ld), static_cast<std::ptrdiff_t>(a.cs),
+                               b.data, static_cast<std::ptrdiff_t>(b.ld), static_cast<std::ptrdiff_t>(b.cs),
+                               c, static_cast<std::ptrdiff_t>(ldc), 1);
+            }
+        }
+
+        template <typename value_t, typename allocator>
+        void multiply_into(const dense_operand<value_t> &a, const dense_operand<value_t> &b, dynamic_matrix<value_t, allocator> &c, thread_pool *pool = nullptr) {
+            c.resize(a.rows, b.cols);
+            c.fill(value_t(0));
+            multiply_into(a, b, c.data(), c.leading_dimension(), pool);
+        }
+
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        void multiply_into(const dense_operand<value_t> &a, const dense_operand<value_t> &b, matrix<row_num, col_num, value_t> &c, thread_pool *pool = nullptr) {
+            assert(a.rows == row_num && b.cols == col_num);
+            std::fill(c.raw_data(), c.raw_data() + row_num * col_num, value_t(0));
+            multiply_into(a, b, c.raw_data(), col_num, pool);
+        }
+    };
+
+    template <typename value_t, typename allocator>
+    dynamic_matrix<value_t, allocator> operator*(const dynamic_matrix<value_t, allocator> &lhs, const dynamic_matrix<value_t, allocator> &rhs) {
+        dynamic_matrix<value_t, allocator> res(lhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    template <std::size_t row_num, std::size_t col_num, typename value_t, typename allocator>
+    dynamic_matrix<value_t, allocator> operator*(const matrix<row_num, col_num, value_t> &lhs, const dynamic_matrix<value_t, allocator> &rhs) {
+        dynamic_matrix<value_t, allocator> res(rhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    template <std::size_t row_num, std::size_t col_num, typename value_t, typename allocator>
+    dynamic_matrix<value_t, allocator> operator*(const dynamic_matrix<value_t, allocator> &lhs, const matrix<row_num, col_num, value_t> &rhs) {
+        dynamic_matrix<value_t, allocator> res(lhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    namespace detail {
+        // a product with a view operand: views, matrices and dynamic matrices in any mix.
+        // the result is a fixed matrix when both outer extents are known at compile time.
+        template <typename lhs_t, typename rhs_t, typename value_t = typename lhs_t::value_type>
+        using view_product_t = typename std::enable_if<
+            (is_strided_view<lhs_t>::value || is_strided_view<rhs_t>::value)
+            && std::is_same<value_t, typename rhs_t::value_type>::value
+            && std::is_same<decltype(make_dense_operand(std::declval<const lhs_t &>())), dense_operand<value_t>>::value
+            && std::is_same<decltype(make_dense_operand(std::declval<const rhs_t &>())), dense_operand<value_t>>::value,
+            typename evaluated_matrix<lhs_t::row_extent, rhs_t::column_extent, value_t>::type
+        >::type;
+    };
+
+    template <typename lhs_t, typename rhs_t>
+    detail::view_product_t<lhs_t, rhs_t> operator*(const lhs_t &lhs, const rhs_t &rhs) {
+        static_assert(detail::extent_matches(lhs_t::column_extent, rhs_t::row_extent), "required: inner dimensions match");
+        detail::view_product_t<lhs_t, rhs_t> res;
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res);
+        return res;
+    }
+
+    // lhs * rhs under an execution policy: multiply(execution::par, a, b).
+    template <typename policy, typename value_t, typename allocator>
+    auto multiply(const policy &p, const dynamic_matrix<value_t, allocator> &lhs, const dynamic_matrix<value_t, allocator> &rhs)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value, dynamic_matrix<value_t, allocator>>::type
+    {
+        dynamic_matrix<value_t, allocator> res(lhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res, execution::pool_of(p));
+        return res;
+    }
+
+    template <typename policy, std::size_t row_num, std::size_t col_num, typename value_t, typename allocator>
+    auto multiply(const policy &p, const matrix<row_num, col_num, value_t> &lhs, const dynamic_matrix<value_t, allocator> &rhs)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value, dynamic_matrix<value_t, allocator>>::type
+    {
+        dynamic_matrix<value_t, allocator> res(rhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res, execution::pool_of(p));
+        return res;
+    }
+
+    template <typename policy, std::size_t row_num, std::size_t col_num, typename value_t, typename allocator>
+    auto multiply(const policy &p, const dynamic_matrix<value_t, allocator> &lhs, const matrix<row_num, col_num, value_t> &rhs)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value, dynamic_matrix<value_t, allocator>>::type
+    {
+        dynamic_matrix<value_t, allocator> res(lhs.get_allocator());
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res, execution::pool_of(p));
+        return res;
+    }
+
+    template <typename policy, std::size_t row_num, std::size_t inner_num, std::size_t col_num, typename value_t>
+    auto multiply(const policy &p, const matrix<row_num, inner_num, value_t> &lhs, const matrix<inner_num, col_num, value_t> &rhs)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value, matrix<row_num, col_num, value_t>>::type
+    {
+        matrix<row_num, col_num, value_t> res;
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res, execution::pool_of(p));
+        return res;
+    }
+
+    template <typename policy, typename lhs_t, typename rhs_t>
+    auto multiply(const policy &p, const lhs_t &lhs, const rhs_t &rhs)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value, detail::view_product_t<lhs_t, rhs_t>>::type
+    {
+        static_assert(detail::extent_matches(lhs_t::column_extent, rhs_t::row_extent), "required: inner dimensions match");
+        detail::view_product_t<lhs_t, rhs_t> res;
+        detail::multiply_into(detail::make_dense_operand(lhs), detail::make_dense_operand(rhs), res, execution::pool_of(p));
+        return res;
+    }
+};
+
+template <typename value_t, typename allocator>
+std::ostream &operator<<(std::ostream &os, const bbb::dynamic_matrix<value_t, allocator> &mat) {
+    for(std::size_t i = 0; i < mat.row_size(); i++) {
+        for(std::size_t j = 0; j + 1 < mat.column_size(); j++) {
+            os << mat[i][j] << ", ";
+        }
+        if(mat.column_size()) os << mat[i][mat.column_size() - 1];
+        os << std::endl;
+    }
+    return os;
+}
@@ -0,0 +1,355 @@
+//
+//  expression.hpp
+//
+//  lazy element-wise expressions for matrix and base_vec.
+//  operator+, operator-, scalar operator* and operator/ build nodes
+//  and the whole tree is evaluated in one loop when it is assigned.
+//
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+
+namespace bbb {
+    template <std::size_t row_num, std::size_t col_num, typename value_t> struct matrix;
+    template <std::size_t s, typename value_t> struct base_vec;
+    template <std::size_t s, typename value_t> struct vec;
+
+    // extent of a dimension only known at run time (dynamic_matrix and friends)
+    constexpr std::size_t dynamic_extent = static_cast<std::size_t>(-1);
+    
+    struct matrix_expression_tag {};
+    struct vec_expression_tag {};
+
+    template <typename type>
+    struct is_matrix_expression : std::is_base_of<matrix_expression_tag, typename std::decay<type>::type> {};
+
+    template <typename type>
+    struct is_vec_expression : std::is_base_of<vec_expression_tag, typename std::decay<type>::type> {};
+
+    // lazy product of fixed size matrices, see matrix_product.hpp.
+    template <typename lhs_t, typename rhs_t> struct matrix_product;
+
+    template <typename type>
+    struct is_matrix_product : std::false_type {};
+    template <typename lhs_t, typename rhs_t>
+    struct is_matrix_product<matrix_product<lhs_t, rhs_t>> : std::true_type {};
+
+    namespace detail {
+        // lvalue operands are held by reference, temporaries by value,
+        // so a node never outlives the operands it reads from.
+        template <typename type>
+        using reference_or_value_t = typename std::conditional<
+            std::is_lvalue_reference<type>::value,
+            const typename std::decay<type>::type &,
+            typename std::decay<type>::type
+        >::type;
+
+        // a product is evaluated once when it is captured instead of
+        // being multiplied out again for every entry that is read.
+        template <typename operand_type, bool = is_matrix_product<typename std::decay<operand_type>::type>::value>
+        struct operand { using type = reference_or_value_t<operand_type>; };
+        template <typename operand_type>
+        struct operand<operand_type, true> { using type = typename std::decay<operand_type>::type::result_type; };
+
+        template <typename type>
+        using operand_t = typename operand<type>::type;
+
+        template <typename type>
+        using value_type_of = typename std::decay<type>::type::value_type;
+
+        // the entries of a matrix in memory, in bytes: entry (i, j) at origin + i * row_step
+        // + j * column_step, all of them within [first, last).
+        struct storage_span {
+            const char *origin;
+            std::ptrdiff_t row_step, column_step;
+            const char *first, *last;
+        };
+
+        template <typename value_t>
+        storage_span span_of(const value_t *data, std::size_t rows, std::size_t cols, std::ptrdiff_t row_stride, std::ptrdiff_t column_stride) {
+            const char *origin = reinterpret_cast<const char *>(data);
+            const std::ptrdiff_t row_step = row_stride * std::ptrdiff_t(sizeof(value_t)), column_step = column_stride * std::ptrdiff_t(sizeof(value_t));
+            if(rows == 0 || cols == 0) return {origin, row_step, column_step, origin, origin};
+            const std::ptrdiff_t down = std::ptrdiff_t(rows - 1) * row_step, across = std::ptrdiff_t(cols - 1) * column_step;
+            const std::ptrdiff_t low = std::min<std::ptrdiff_t>(down, 0) + std::min<std::ptrdiff_t>(across, 0);
+            const std::ptrdiff_t high = std::max<std::ptrdiff_t>(down, 0) + std::max<std::ptrdiff_t>(across, 0);
+            return {origin, row_step, column_step, origin + low, origin + high + std::ptrdiff_t(sizeof(value_t))};
+        }
+
+        // reading source while writing destination entry by entry is only safe if they share
+        // no storage or lay out every entry at the same address.
+        inline bool conflicts(const storage_span &source, const storage_span &destination) {
+            const std::less<const char *> before{};
+            if(!before(source.first, destination.last) || !before(destination.first, source.last)) return false;
+            return source.origin != destination.origin || source.row_step != destination.row_step || source.column_step != destination.column_step;
+        }
+
+        // whether assigning e into the storage of destination entry by entry can read an
+        // entry after it was overwritten (a = a.t()). the assignments then evaluate e into a
+        // temporary first. specialized for the nodes and for everything that owns or views
+        // storage; other operands (products are evaluated on capture) never alias.
+        template <typename type, typename = void>
+        struct aliasing {
+            static bool reads(const type &, const storage_span &) { return false; }
+        };
+
+        template <typename expression>
+        bool aliases(const expression &e, const storage_span &destination) {
+            return aliasing<typename std::decay<expression>::type>::reads(e, destination);
+        }
+
+        constexpr bool extent_matches(std::size_t lhs, std::size_t rhs) {
+            return lhs == dynamic_extent || rhs == dynamic_extent || lhs == rhs;
+        }
+
+        constexpr std::size_t common_extent(std::size_t lhs, std::size_t rhs) {
+            return lhs == dynamic_extent ? rhs : lhs;
+        }
+
+        // what eval() of a matrix expression gives back. the dynamic cases
+        // are specialized by dynamic_matrix.hpp.
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        struct evaluated_matrix { using type = matrix<row_num, col_num, value_t>; };
+
+        struct plus {
+            template <typename lhs_t, typename rhs_t>
+            constexpr auto operator()(const lhs_t &lhs, const rhs_t &rhs) const
+            -> decltype(lhs + rhs) { return lhs + rhs; }
+        };
+
+        struct minus {
+            template <typename lhs_t, typename rhs_t>
+            constexpr auto operator()(const lhs_t &lhs, const rhs_t &rhs) const
+            -> decltype(lhs - rhs) { return lhs - rhs; }
+        };
+
+        struct negate {
+            template <typename type>
+            constexpr auto operator()(const type &x) const
+            -> decltype(-x) { return -x; }
+        };
+
+        template <typename scale_t>
+        struct multiplies_by {
+            scale_t scale;
+            constexpr multiplies_by(scale_t scale) : scale(scale) {}
+
+            template <typename type>
+            constexpr auto operator()(const type &x) const
+            -> decltype(x * std::declval<const scale_t &>()) { return x * scale; }
+        };
+
+        // floating point division is done by the reciprocal, as operator/= always did.
+        template <typename scale_t, bool = std::is_floating_point<scale_t>::value>
+        struct divides_by {
+            scale_t inverse;
+            constexpr divides_by(scale_t scale) : inverse(scale_t(1) / scale) {}
+
+            template <typename type>
+            constexpr auto operator()(const type &x) const
+            -> decltype(x * std::declval<const scale_t &>()) { return x * inverse; }
+        };
+
+        template <typename scale_t>
+        struct divides_by<scale_t, false> {
+            scale_t scale;
+            constexpr divides_by(scale_t scale) : scale(scale) {}
+
+            template <typename type>
+            constexpr auto operator()(const type &x) const
+            -> decltype(x / std::declval<const scale_t &>()) { return x / scale; }
+        };
+    };
+
+    template <typename lhs_t, typename rhs_t, typename op_t>
+    struct matrix_binary_expression : matrix_expression_tag {
+        using lhs_type = typename std::decay<lhs_t>::type;
+        using rhs_type = typename std::decay<rhs_t>::type;
+        using value_type = typename std::decay<decltype(std::declval<const op_t &>()(std::declval<typename lhs_type::value_type>(), std::declval<typename rhs_type::value_type>()))>::type;
+
+        static constexpr std::size_t row_extent = detail::common_extent(lhs_type::row_extent, rhs_type::row_extent);
+        static constexpr std::size_t column_extent = detail::common_extent(lhs_type::column_extent, rhs_type::column_extent);
+        static_assert(detail::extent_matches(lhs_type::row_extent, rhs_type::row_extent) && detail::extent_matches(lhs_type::column_extent, rhs_type::column_extent), "required: operands have same dimensions");
+
+        matrix_binary_expression(lhs_t &&lhs, rhs_t &&rhs, op_t op = op_t{})
+        : lhs(std::forward<lhs_t>(lhs))
+        , rhs(std::forward<rhs_t>(rhs))
+        , op(op)
+        {
+            assert(this->lhs.row_size() == this->rhs.row_size() && this->lhs.column_size() == this->rhs.column_size());
+        }
+
+        constexpr std::size_t row_size() const { return lhs.row_size(); }
+        constexpr std::size_t column_size() const { return lhs.column_size(); }
+
+        inline constexpr value_type operator()(std::size_t i, std::size_t j) const { return op(lhs(i, j), rhs(i, j)); }
+        inline typename detail::evaluated_matrix<row_extent, column_extent, value_type>::type eval() const { return *this; }
+
+        constexpr const typename std::decay<detail::operand_t<lhs_t>>::type &left() const { return lhs; }
+        constexpr const typename std::decay<detail::operand_t<rhs_t>>::type &right() const { return rhs; }
+
+    private:
+        detail::operand_t<lhs_t> lhs;
+        detail::operand_t<rhs_t> rhs;
+        op_t op;
+    };
+
+    template <typename operand_type, typename op_t>
+    struct matrix_unary_expression : matrix_expression_tag {
+        using argument_type = typename std::decay<operand_type>::type;
+        using value_type = typename std::decay<decltype(std::declval<const op_t &>()(std::declval<typename argument_type::value_type>()))>::type;
+
+        static constexpr std::size_t row_extent = argument_type::row_extent;
+        static constexpr std::size_t column_extent = argument_type::column_extent;
+
+        matrix_unary_expression(operand_type &&operand, op_t op = op_t{})
+        : operand(std::forward<operand_type>(operand))
+        , op(op) {}
+
+        constexpr std::size_t row_size() const { return operand.row_size(); }
+        constexpr std::size_t column_size() const { return operand.column_size(); }
+
+        inline constexpr value_type operator()(std::size_t i, std::size_t j) const { return op(operand(i, j)); }
+        inline typename detail::evaluated_matrix<row_extent, column_extent, value_type>::type eval() const { return *this; }
+
+        constexpr const typename std::decay<detail::operand_t<operand_type>>::type &argument() const { return operand; }
+
+    private:
+        detail::operand_t<operand_type> operand;
+        op_t op;
+    };
+
+    namespace detail {
+        template <typename lhs_t, typename rhs_t, typename op_t>
+        struct aliasing<matrix_binary_expression<lhs_t, rhs_t, op_t>> {
+            static bool reads(const matrix_binary_expression<lhs_t, rhs_t, op_t> &e, const storage_span &destination) {
+                return aliases(e.left(), destination) || aliases(e.right(), destination);
+            }
+        };
+
+        template <typename operand_type, typename op_t>
+        struct aliasing<matrix_unary_expression<operand_type, op_t>> {
+            static bool reads(const matrix_unary_expression<operand_type, op_t> &e, const storage_span &destination) {
+                return aliases(e.argument(), destination);
+            }
+        };
+    };
+
+    template <typename lhs_t, typename rhs_t, typename std::enable_if<is_matrix_expression<lhs_t>::value && is_matrix_expression<rhs_t>::value>::type * = nullptr>
+    inline matrix_binary_expression<lhs_t, rhs_t, detail::plus> operator+(lhs_t &&lhs, rhs_t &&rhs) {
+        return {std::forward<lhs_t>(lhs), std::forward<rhs_t>(rhs)};
+    }
+
+    template <typename lhs_t, typename rhs_t, typename std::enable_if<is_matrix_expression<lhs_t>::value && is_matrix_expression<rhs_t>::value>::type * = nullptr>
+    inline matrix_binary_expression<lhs_t, rhs_t, detail::minus> operator-(lhs_t &&lhs, rhs_t &&rhs) {
+        return {std::forward<lhs_t>(lhs), std::forward<rhs_t>(rhs)};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_matrix_expression<expression_t>::value>::type * = nullptr>
+    inline matrix_unary_expression<expression_t, detail::negate> operator-(expression_t &&e) {
+        return {std::forward<expression_t>(e)};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_matrix_expression<expression_t>::value>::type * = nullptr>
+    inline matrix_unary_expression<expression_t, detail::multiplies_by<detail::value_type_of<expression_t>>>
+    operator*(expression_t &&e, detail::value_type_of<expression_t> scale) {
+        return {std::forward<expression_t>(e), scale};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_matrix_expression<expression_t>::value>::type * = nullptr>
+    inline matrix_unary_expression<expression_t, detail::multiplies_by<detail::value_type_of<expression_t>>>
+    operator*(detail::value_type_of<expression_t> scale, expression_t &&e) {
+        return {std::forward<expression_t>(e), scale};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_matrix_expression<expression_t>::value>::type * = nullptr>
+    inline matrix_unary_expression<expression_t, detail::divides_by<detail::value_type_of<expression_t>>>
+    operator/(expression_t &&e, detail::value_type_of<expression_t> scale) {
+        return {std::forward<expression_t>(e), scale};
+    }
+
+    template <typename lhs_t, typename rhs_t, typename op_t>
+    struct vec_binary_expression : vec_expression_tag {
+        using lhs_type = typename std::decay<lhs_t>::type;
+        using rhs_type = typename std::decay<rhs_t>::type;
+        using value_type = typename std::decay<decltype(std::declval<const op_t &>()(std::declval<typename lhs_type::value_type>(), std::declval<typename rhs_type::value_type>()))>::type;
+
+        static constexpr std::size_t extent = lhs_type::extent;
+        static_assert(lhs_type::extent == rhs_type::extent, "required: operands have same size");
+
+        vec_binary_expression(lhs_t &&lhs, rhs_t &&rhs, op_t op = op_t{})
+        : lhs(std::forward<lhs_t>(lhs))
+        , rhs(std::forward<rhs_t>(rhs))
+        , op(op) {}
+
+        constexpr std::size_t size() const { return extent; }
+
+        inline constexpr value_type operator[](std::size_t index) const { return op(lhs[index], rhs[index]); }
+        inline vec<extent, value_type> eval() const { return *this; }
+
+    private:
+        detail::operand_t<lhs_t> lhs;
+        detail::operand_t<rhs_t> rhs;
+        op_t op;
+    };
+
+    template <typename operand_type, typename op_t>
+    struct vec_unary_expression : vec_expression_tag {
+        using argument_type = typename std::decay<operand_type>::type;
+        using value_type = typename std::decay<decltype(std::declval<const op_t &>()(std::declval<typename argument_type::value_type>()))>::type;
+
+        static constexpr std::size_t extent = argument_type::extent;
+
+        vec_unary_expression(operand_type &&operand, op_t op = op_t{})
+        : operand(std::forward<operand_type>(operand))
+        , op(op) {}
+
+        constexpr std::size_t size() const { return extent; }
+
+        inline constexpr value_type operator[](std::size_t index) const { return op(operand[index]); }
+        inline vec<extent, value_type> eval() const { return *this; }
+
+    private:
+        detail::operand_t<operand_type> operand;
+        op_t op;
+    };
+
+    template <typename lhs_t, typename rhs_t, typename std::enable_if<is_vec_expression<lhs_t>::value && is_vec_expression<rhs_t>::value>::type * = nullptr>
+    inline vec_binary_expression<lhs_t, rhs_t, detail::plus> operator+(lhs_t &&lhs, rhs_t &&rhs) {
+        return {std::forward<lhs_t>(lhs), std::forward<rhs_t>(rhs)};
+    }
+
+    template <typename lhs_t, typename rhs_t, typename std::enable_if<is_vec_expression<lhs_t>::value && is_vec_expression<rhs_t>::value>::type * = nullptr>
+    inline vec_binary_expression<lhs_t, rhs_t, detail::minus> operator-(lhs_t &&lhs, rhs_t &&rhs) {
+        return {std::forward<lhs_t>(lhs), std::forward<rhs_t>(rhs)};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_vec_expression<expression_t>::value>::type * = nullptr>
+    inline vec_unary_expression<expression_t, detail::negate> operator-(expression_t &&e) {
+        return {std::forward<expression_t>(e)};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_vec_expression<expression_t>::value>::type * = nullptr>
+    inline vec_unary_expression<expression_t, detail::multiplies_by<detail::value_type_of<expression_t>>>
+    operator*(expression_t &&e, detail::value_type_of<expression_t> scale) {
+        return {std::forward<expression_t>(e), scale};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_vec_expression<expression_t>::value>::type * = nullptr>
+    inline vec_unary_expression<expression_t, detail::multiplies_by<detail::value_type_of<expression_t>>>
+    operator*(detail::value_type_of<expression_t> scale, expression_t &&e) {
+        return {std::forward<expression_t>(e), scale};
+    }
+
+    template <typename expression_t, typename std::enable_if<is_vec_expression<expression_t>::value>::type * = nullptr>
+    inline vec_unary_expression<expression_t, detail::divides_by<detail::value_type_of<expression_t>>>
+    operator/(expression_t &&e, detail::value_type_of<expression_t> scale) {
+        return {std::forward<expression_t>(e), scale};
+    }
+};
@@ -0,0 +1,209 @@
+//
+//  gemm.hpp
+//
+//  packed, cache-blocked matrix multiply.
+//  C += alpha A * B on row/column strided operands, so transposed or
+//  sliced operands can be passed without copying them first.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include "thread_pool.hpp"
+#include "numeric.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace gemm {
+            // mc x kc block of A stays in L2, kc x nr micro panel of B in L1,
+            // kc x nc panel of B in L3. mr x nr accumulators stay in registers.
+            template <typename value_t>
+            struct blocking {
+                static constexpr std::size_t mr = 4;
+                static constexpr std::size_t nr = 4;
+                static constexpr std::size_t mc = 64;
+                static constexpr std::size_t kc = 256;
+                static constexpr std::size_t nc = 1024;
+            };
+
+            template <>
+            struct blocking<double> {
+                static constexpr std::size_t mr = 4;
+                static constexpr std::size_t nr = 8;
+                static constexpr std::size_t mc = 96;
+                static constexpr std::size_t kc = 256;
+                static constexpr std::size_t nc = 2048;
+            };
+
+            template <>
+            struct blocking<float> {
+                static constexpr std::size_t mr = 4;
+                static constexpr std::size_t nr = 16;
+                static constexpr std::size_t mc = 128;
+                static constexpr std::size_t kc = 384;
+                static constexpr std::size_t nc = 4096;
+            };
+
+            // below this many multiply-adds the plain triple loop wins.
+            constexpr std::size_t threshold = 32 * 32 * 32;
+            // below this many multiply-adds splitting C over threads does not pay off.
+            constexpr std::size_t parallel_threshold = 128 * 128 * 128;
+
+            template <std::size_t m, std::size_t n, std::size_t k, typename lhs_value_t, typename rhs_value_t>
+            struct use_blocked : std::integral_constant<bool,
+                std::is_same<lhs_value_t, rhs_value_t>::value
+                && std::is_floating_point<lhs_value_t>::value
+                && threshold <= m * n * k
+            > {};
+
+            template <typename value_t>
+            inline std::vector<value_t> &pack_buffer_a() {
+                static thread_local std::vector<value_t> buffer;
+                return buffer;
+            }
+
+            template <typename value_t>
+            inline std::vector<value_t> &pack_buffer_b() {
+                static thread_local std::vector<value_t> buffer;
+                return buffer;
+            }
+
+            // packs an m x k block of alpha A into mr-row micro panels, zero padded.
+            template <typename value_t>
+            void pack_a(std::size_t m, std::size_t k, const value_t *a, std::ptrdiff_t rs, std::ptrdiff_t cs, value_t alpha, value_t *packed) {
+                const std::size_t mr = blocking<value_t>::mr;
+                for(std::size_t i0 = 0; i0 < m; i0 += mr) {
+                    const std::size_t mi = std::min(mr, m - i0);
+                    for(std::size_t p = 0; p < k; p++) {
+                        const value_t *src = a + i0 * rs + p * cs;
+                        std::size_t i = 0;
+                        if(alpha == value_t(1)) for(; i < mi; i++) packed[i] = src[i * rs];
+                        else for(; i < mi; i++) packed[i] = alpha * src[i * rs];
+                        for(; i < mr; i++) packed[i] = value_t(0);
+                        packed += mr;
+                    }
+                }
+            }
+
+            // packs a k x n panel of B into nr-column micro panels, zero padded.
+            template <typename value_t>
+            void pack_b(std::size_t k, std::size_t n, const value_t *b, std::ptrdiff_t rs, std::ptrdiff_t cs, value_t *packed) {
+                const std::size_t nr = blocking<value_t>::nr;
+                for(std::size_t j0 = 0; j0 < n; j0 += nr) {
+                    const std::size_t nj = std::min(nr, n - j0);
+                    for(std::size_t p = 0; p < k; p++) {
+                        const value_t *src = b + p * rs + j0 * cs;
+                        std::size_t j = 0;
+                        for(; j < nj; j++) packed[j] = src[j * cs];
+                        for(; j < nr; j++) packed[j] = value_t(0);
+                        packed += nr;
+                    }
+                }
+            }
+
+            // mr x nr register tile; only the m x n corner is written back.
+            // 16-bit types are widened to float in the tile and rounded once on write back.
+            template <typename value_t>
+            inline void micro_kernel(std::size_t k, const value_t *a, const value_t *b, value_t *c, std::ptrdiff_t rs_c, std::ptrdiff_t cs_c, std::size_t m, std::size_t n) {
+                constexpr std::size_t mr = blocking<value_t>::mr;
+                constexpr std::size_t nr = blocking<value_t>::nr;
+                compute_t<value_t> ab[mr * nr] = {};
+                for(std::size_t p = 0; p < k; p++) {
+                    for(std::size_t i = 0; i < mr; i++) {
+                        const compute_t<value_t> a_ip = a[i];
+                        for(std::size_t j = 0; j < nr; j++) ab[i * nr + j] += a_ip * b[j];
+                    }
+                    a += mr;
+                    b += nr;
+                }
+                if(m == mr && n == nr && cs_c == 1) {
+                    for(std::size_t i = 0; i < mr; i++) {
+                        value_t *row = c + i * rs_c;
+                        for(std::size_t j = 0; j < nr; j++) row[j] += ab[i * nr + j];
+                    }
+                } else {
+                    for(std::size_t i = 0; i < m; i++) {
+                        for(std::size_t j = 0; j < n; j++) c[i * rs_c + j * cs_c] += ab[i * nr + j];
+                    }
+                }
+            }
+
+            // C[m x n] += packed A block * packed B panel
+            template <typename value_t>
+            void macro_kernel(std::size_t m, std::size_t n, std::size_t k, const value_t *packed_a, const value_t *packed_b, value_t *c, std::ptrdiff_t rs_c, std::ptrdiff_t cs_c) {
+                const std::size_t mr = blocking<value_t>::mr, nr = blocking<value_t>::nr;
+                for(std::size_t j0 = 0; j0 < n; j0 += nr) {
+                    const std::size_t nj = std::min(nr, n - j0);
+                    for(std::size_t i0 = 0; i0 < m; i0 += mr) {
+                        const std::size_t mi = std::min(mr, m - i0);
+                        micro_kernel(k, packed_a + i0 * k, packed_b + j0 * k, c + i0 * rs_c + j0 * cs_c, rs_c, cs_c, mi, nj);
+                    }
+                }
+            }
+
+            template <typename value_t>
+            void multiply(std::size_t m, std::size_t n, std::size_t k,
+                          const value_t *a, std::ptrdiff_t rs_a, std::ptrdiff_t cs_a,
+                          const value_t *b, std::ptrdiff_t rs_b, std::ptrdiff_t cs_b,
+                          value_t *c, std::ptrdiff_t rs_c, std::ptrdiff_t cs_c,
+                          value_t alpha = value_t(1))
+            {
+                const std::size_t mr = blocking<value_t>::mr, nr = blocking<value_t>::nr;
+                const std::size_t mc = blocking<value_t>::mc, kc = blocking<value_t>::kc, nc = blocking<value_t>::nc;
+                std::vector<value_t> &buffer_a = pack_buffer_a<value_t>();
+                std::vector<value_t> &buffer_b = pack_buffer_b<value_t>();
+                const std::size_t round_m = (std::min(mc, m) + mr - 1) / mr * mr;
+                const std::size_t round_n = (std::min(nc, n) + nr - 1) / nr * nr;
+                const std::size_t depth = std::min(kc, k);
+                if(buffer_a.size() < round_m * depth) buffer_a.resize(round_m * depth);
+                if(buffer_b.size() < round_n * depth) buffer_b.resize(round_n * depth);
+
+                for(std::size_t j0 = 0; j0 < n; j0 += nc) {
+                    const std::size_t nj = std::min(nc, n - j0);
+                    for(std::size_t p0 = 0; p0 < k; p0 += kc) {
+                        const std::size_t kp = std::min(kc, k - p0);
+                        pack_b(kp, nj, b + p0 * rs_b + j0 * cs_b, rs_b, cs_b, buffer_b.data());
+                        for(std::size_t i0 = 0; i0 < m; i0 += mc) {
+                            const std::size_t mi = std::min(mc, m - i0);
+                            pack_a(mi, kp, a + i0 * rs_a + p0 * cs_a, rs_a, cs_a, alpha, buffer_a.data());
+                            macro_kernel(mi, nj, kp, buffer_a.data(), buffer_b.data(), c + i0 * rs_c + j0 * cs_c, rs_c, cs_c);
+                        }
+                    }
+                }
+            }
+
+            // C is cut into tiles of whole mc x nr blocks; every tile is an independent
+            // product with its own thread local pack buffers. pool == nullptr runs sequentially.
+            template <typename value_t>
+            void multiply(thread_pool *pool, std::size_t m, std::size_t n, std::size_t k,
+                          const value_t *a, std::ptrdiff_t rs_a, std::ptrdiff_t cs_a,
+                          const value_t *b, std::ptrdiff_t rs_b, std::ptrdiff_t cs_b,
+                          value_t *c, std::ptrdiff_t rs_c, std::ptrdiff_t cs_c,
+                          value_t alpha = value_t(1))
+            {
+                if(!pool || pool->size() == 1 || m * n * k < parallel_threshold) {
+                    multiply(m, n, k, a, rs_a, cs_a, b, rs_b, cs_b, c, rs_c, cs_c, alpha);
+                    return;
+                }
+                const std::size_t mr = blocking<value_t>::mr, nr = blocking<value_t>::nr, mc = blocking<value_t>::mc;
+                const std::size_t target = 4 * pool->size();
+                const std::size_t row_tiles = std::max<std::size_t>(1, std::min(target, (m + mc - 1) / mc));
+                const std::size_t col_tiles = std::max<std::size_t>(1, std::min((target + row_tiles - 1) / row_tiles, (n + 8 * nr - 1) / (8 * nr)));
+                const std::size_t row_step = ((m + row_tiles - 1) / row_tiles + mr - 1) / mr * mr;
+                const std::size_t col_step = ((n + col_tiles - 1) / col_tiles + nr - 1) / nr * nr;
+                const std::size_t row_count = (m + row_step - 1) / row_step, col_count = (n + col_step - 1) / col_step;
+                pool->parallel_for(row_count * col_count, [=](std::size_t tile) {
+                    const std::size_t i0 = tile / col_count * row_step, j0 = tile % col_count * col_step;
+                    multiply(std::min(row_step, m - i0), std::min(col_step, n - j0), k,
+                             a + i0 * rs_a, rs_a, cs_a,
+                             b + j0 * cs_b, rs_b, cs_b,
+                             c + i0 * rs_c + j0 * cs_c, rs_c, cs_c, alpha);
+                });
+            }
+        };
+    };
+};
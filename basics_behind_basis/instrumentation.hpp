@@ -0,0 +1,312 @@
+//
+//  instrumentation.hpp
+//
+//  opt-in counters for the hot paths. define BBB_ENABLE_INSTRUMENTATION
+//  (for the whole program) to compile them in; without it every hook below
+//  expands to nothing and the instrumented code is unchanged.
+//
+//  each call of an instrumented operation adds its flops and bytes touched
+//  to a thread local table keyed by operation, extents and call site; the
+//  expensive ones (products, factorizations) are also timed. snapshot()
+//  sums the tables of all threads, including threads that have already
+//  exited.
+//
+//  call sites are labelled by the caller: everything run inside
+//  BBB_INSTRUMENT_SITE("name") on the same thread is filed under "name".
+//  timed operations are forwarded to the tracer set with set_tracer(),
+//  which is called from whichever thread runs the operation.
+//
+//  the unrolled constexpr paths of matrices up to 4 x 4 are not counted.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#ifdef BBB_ENABLE_INSTRUMENTATION
+#   define BBB_INSTRUMENTATION 1
+#else
+#   define BBB_INSTRUMENTATION 0
+#endif
+
+namespace bbb {
+    namespace instrumentation {
+        constexpr bool enabled = BBB_INSTRUMENTATION != 0;
+
+        enum class operation {
+            multiply,
+            transpose,
+            lu_decomposition,
+            lu_solve,
+            cholesky_decomposition,
+            cholesky_solve,
+            qr_decomposition,
+            qr_solve,
+            dot,
+            norm,
+            distance
+        };
+
+        inline const char *name_of(operation op) {
+            switch(op) {
+                case operation::multiply: return "multiply";
+                case operation::transpose: return "transpose";
+                case operation::lu_decomposition: return "lu_decomposition";
+                case operation::lu_solve: return "lu_solve";
+                case operation::cholesky_decomposition: return "cholesky_decomposition";
+                case operation::cholesky_solve: return "cholesky_solve";
+                case operation::qr_decomposition: return "qr_decomposition";
+                case operation::qr_solve: return "qr_solve";
+                case operation::dot: return "dot";
+                case operation::norm: return "norm";
+                case operation::distance: return "distance";
+            }
+            return "";
+        }
+
+        // one call: rows x cols is the result (or the operand of a reduction, cols == 1),
+        // inner the summed extent of a product or the right hand side count of a solve.
+        struct span {
+            operation op;
+            const char *site;
+            std::size_t rows, cols, inner;
+            std::uint64_t flops, bytes;
+        };
+
+        struct tracer {
+            virtual ~tracer() = default;
+            virtual void begin(const span &) {}
+            virtual void end(const span &, std::uint64_t /* nanoseconds */) {}
+        };
+
+        struct counters {
+            std::uint64_t calls{0};
+            std::uint64_t flops{0};
+            std::uint64_t bytes{0};
+            std::uint64_t nanoseconds{0};
+
+            counters &operator+=(const counters &rhs) {
+                calls += rhs.calls;
+                flops += rhs.flops;
+                bytes += rhs.bytes;
+                nanoseconds += rhs.nanoseconds;
+                return *this;
+            }
+        };
+
+        struct record {
+            operation op;
+            std::string site;
+            std::size_t rows, cols, inner;
+            counters total;
+        };
+
+        namespace detail {
+            struct key {
+                operation op;
+                const char *site;
+                std::size_t rows, cols, inner;
+
+                bool operator<(const key &rhs) const {
+                    if(op != rhs.op) return op < rhs.op;
+                    if(site != rhs.site) return std::less<const char *>()(site, rhs.site);
+                    if(rows != rhs.rows) return rows < rhs.rows;
+                    if(cols != rhs.cols) return cols < rhs.cols;
+                    return inner < rhs.inner;
+                }
+            };
+
+            using table = std::map<key, counters>;
+
+            // written by its own thread, read by snapshot(); the lock is uncontended
+            // except while a snapshot is taken.
+            struct thread_table {
+                std::mutex mutex;
+                table entries;
+            };
+
+            struct registry {
+                std::mutex mutex;
+                std::vector<thread_table *> live;
+                table retired;
+
+                static registry &get() {
+                    static registry instance;
+                    return instance;
+                }
+            };
+
+            inline void merge(table &into, const table &from) {
+                for(const auto &entry : from) into[entry.first] += entry.second;
+            }
+
+            // registers the table of the calling thread on first use and folds it
+            // into the retired totals when the thread exits.
+            struct thread_slot {
+                thread_table local;
+
+                thread_slot() {
+                    registry &r = registry::get();
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    r.live.push_back(&local);
+                }
+
+                ~thread_slot() {
+                    registry &r = registry::get();
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    merge(r.retired, local.entries);
+                    r.live.erase(std::find(r.live.begin(), r.live.end(), &local));
+                }
+            };
+
+            inline thread_table &local_table() {
+                static thread_local thread_slot slot;
+                return slot.local;
+            }
+
+            inline const char *&current_site() {
+                static thread_local const char *site = "";
+                return site;
+            }
+
+            inline std::atomic<tracer *> &active_tracer() {
+                static std::atomic<tracer *> instance{nullptr};
+                return instance;
+            }
+
+            inline void add(const span &s, std::uint64_t nanoseconds) {
+                thread_table &t = local_table();
+                std::lock_guard<std::mutex> lock(t.mutex);
+                counters &c = t.entries[key{s.op, s.site, s.rows, s.cols, s.inner}];
+                c.calls++;
+                c.flops += s.flops;
+                c.bytes += s.bytes;
+                c.nanoseconds += nanoseconds;
+            }
+
+            inline span make_span(operation op, std::size_t rows, std::size_t cols, std::size_t inner, std::uint64_t flops, std::uint64_t bytes) {
+                return {op, current_site(), rows, cols, inner, flops, bytes};
+            }
+
+            inline void count(const span &s) { add(s, 0); }
+
+            struct timed {
+                explicit timed(const span &s)
+                : s(s)
+                , trace(active_tracer().load(std::memory_order_acquire))
+                {
+                    if(trace) trace->begin(s);
+                    start = std::chrono::steady_clock::now();
+                }
+
+                ~timed() {
+                    const std::uint64_t nanoseconds = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+                    add(s, nanoseconds);
+                    if(trace) trace->end(s, nanoseconds);
+                }
+
+                timed(const timed &) = delete;
+                timed &operator=(const timed &) = delete;
+
+            private:
+                span s;
+                tracer *trace;
+                std::chrono::steady_clock::time_point start;
+            };
+        };
+
+        // labels the operations run on this thread until the scope ends; label must outlive it.
+        struct site_scope {
+            explicit site_scope(const char *label)
+            : previous(detail::current_site())
+            { detail::current_site() = label; }
+
+            ~site_scope() { detail::current_site() = previous; }
+
+            site_scope(const site_scope &) = delete;
+            site_scope &operator=(const site_scope &) = delete;
+
+        private:
+            const char *previous;
+        };
+
+        // returns the previous tracer; nullptr detaches. the tracer must stay alive
+        // until no instrumented operation can still be running.
+        inline tracer *set_tracer(tracer *t) {
+            return detail::active_tracer().exchange(t, std::memory_order_acq_rel);
+        }
+
+        // totals of every thread, most time first, then most flops.
+        inline std::vector<record> snapshot() {
+            detail::table all;
+            {
+                detail::registry &r = detail::registry::get();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                all = r.retired;
+                for(detail::thread_table *t : r.live) {
+                    std::lock_guard<std::mutex> table_lock(t->mutex);
+                    detail::merge(all, t->entries);
+                }
+            }
+            // the same label may live at different addresses in different translation units.
+            std::vector<record> records;
+            for(const auto &entry : all) {
+                const detail::key &k = entry.first;
+                auto same = std::find_if(records.begin(), records.end(), [&k](const record &r) {
+                    return r.op == k.op && r.rows == k.rows && r.cols == k.cols && r.inner == k.inner && r.site == k.site;
+                });
+                if(same == records.end()) records.push_back(record{k.op, k.site, k.rows, k.cols, k.inner, entry.second});
+                else same->total += entry.second;
+            }
+            std::sort(records.begin(), records.end(), [](const record &a, const record &b) {
+                if(a.total.nanoseconds != b.total.nanoseconds) return b.total.nanoseconds < a.total.nanoseconds;
+                return b.total.flops < a.total.flops;
+            });
+            return records;
+        }
+
+        // totals summed over sites and extents, per operation.
+        inline counters total(const std::vector<record> &records, operation op) {
+            counters sum;
+            for(const record &r : records) if(r.op == op) sum += r.total;
+            return sum;
+        }
+
+        inline void reset() {
+            detail::registry &r = detail::registry::get();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.retired.clear();
+            for(detail::thread_table *t : r.live) {
+                std::lock_guard<std::mutex> table_lock(t->mutex);
+                t->entries.clear();
+            }
+        }
+    };
+};
+
+#if BBB_INSTRUMENTATION
+#   define BBB_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#   define BBB_INSTRUMENT_CONCAT(a, b) BBB_INSTRUMENT_CONCAT_IMPL(a, b)
+    // times the rest of the enclosing scope.
+#   define BBB_INSTRUMENT_SPAN(op, rows, cols, inner, flops, bytes) \
+        const ::bbb::instrumentation::detail::timed BBB_INSTRUMENT_CONCAT(bbb_instrumented_, __LINE__)( \
+            ::bbb::instrumentation::detail::make_span(::bbb::instrumentation::operation::op, rows, cols, inner, flops, bytes))
+#   define BBB_INSTRUMENT_COUNT(op, rows, cols, inner, flops, bytes) \
+        ::bbb::instrumentation::detail::count( \
+            ::bbb::instrumentation::detail::make_span(::bbb::instrumentation::operation::op, rows, cols, inner, flops, bytes))
+#   define BBB_INSTRUMENT_SITE(label) \
+        const ::bbb::instrumentation::site_scope BBB_INSTRUMENT_CONCAT(bbb_instrumented_site_, __LINE__)(label)
+#else
+#   define BBB_INSTRUMENT_SPAN(op, rows, cols, inner, flops, bytes) ((void)0)
+#   define BBB_INSTRUMENT_COUNT(op, rows, cols, inner, flops, bytes) ((void)0)
+#   define BBB_INSTRUMENT_SITE(label) ((void)0)
+#endif
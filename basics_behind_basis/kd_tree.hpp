@@ -0,0 +1,300 @@
+//
+//  kd_tree.hpp
+//
+//  static kd-tree over vec<s> for k nearest neighbor and radius queries.
+//  built once from a point set by median splits along the axis of widest
+//  spread. nodes live in one array in depth first order (the left child
+//  follows its parent), and the points are copied in leaf order, so a leaf
+//  is a contiguous run that is scanned linearly. all comparisons use
+//  squared distances; no sqrt is taken.
+//
+//  indices reported by queries refer to the input order. the tree does not
+//  keep the input alive. integer coordinates are compared in double, which
+//  cannot overflow and is exact while squared distances stay below 2^53.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "vec.hpp"
+#include "vec_array.hpp"
+#include "numeric.hpp"
+#include "thread_pool.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace kd_tree {
+            // queries handed to one task when a batch is split over threads.
+            constexpr std::size_t chunk = 256;
+            // deep enough for any tree whose leaves hold at least one of 2^64 points.
+            constexpr std::size_t max_depth = 64;
+
+            template <typename value_t>
+            using distance_t = typename std::conditional<std::is_integral<value_t>::value, double, compute_t<value_t>>::type;
+        };
+    };
+
+    template <std::size_t s, typename value_t = double>
+    struct kd_tree {
+        using point_type = vec<s, value_t>;
+        using distance_type = detail::kd_tree::distance_t<value_t>;
+
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        // the distance of "nothing found yet", farther than any point.
+        static constexpr distance_type unbounded() {
+            return std::numeric_limits<distance_type>::has_infinity ? std::numeric_limits<distance_type>::infinity() : std::numeric_limits<distance_type>::max();
+        }
+
+        struct neighbor {
+            std::size_t index;
+            distance_type squared_distance;
+
+            bool operator<(const neighbor &rhs) const {
+                return squared_distance < rhs.squared_distance || (squared_distance == rhs.squared_distance && index < rhs.index);
+            }
+        };
+
+        kd_tree() = default;
+
+        // leaf_size: most points kept in one leaf.
+        kd_tree(const point_type *points, std::size_t n, std::size_t leaf_size = 16) { build(points, n, leaf_size); }
+        explicit kd_tree(const std::vector<point_type> &points, std::size_t leaf_size = 16) { build(points, leaf_size); }
+        explicit kd_tree(const vec_array<s, value_t> &points, std::size_t leaf_size = 16) { build(points, leaf_size); }
+
+        kd_tree &build(const std::vector<point_type> &points, std::size_t leaf_size = 16) {
+            return build(points.data(), points.size(), leaf_size);
+        }
+
+        kd_tree &build(const vec_array<s, value_t> &points, std::size_t leaf_size = 16) {
+            std::vector<point_type> copy(points.size());
+            for(std::size_t i = 0; i < copy.size(); i++) copy[i] = points[i];
+            return build(copy.data(), copy.size(), leaf_size);
+        }
+
+        kd_tree &build(const point_type *points, std::size_t n, std::size_t leaf_size = 16) {
+            assert(0 < leaf_size && n < std::numeric_limits<std::uint32_t>::max());
+            this->leaf_size = leaf_size;
+            nodes.clear();
+            this->points.assign(points, points + n);
+            indices.resize(n);
+            for(std::size_t i = 0; i < n; i++) indices[i] = static_cast<std::uint32_t>(i);
+            if(n) {
+                nodes.reserve(2 * (n / leaf_size + 1));
+                build_node(0, n);
+            }
+            return *this;
+        }
+
+        std::size_t size() const { return points.size(); }
+        bool empty() const { return points.empty(); }
+        std::size_t node_count() const { return nodes.size(); }
+
+        // index npos if the tree is empty.
+        neighbor nearest(const point_type &query) const {
+            neighbor best{npos, unbounded()};
+            knn(query, 1, &best);
+            return best;
+        }
+
+        // the k nearest points sorted by distance, written to out[0, k). returns how many
+        // were found, min(k, size()); the remaining slots are set to {npos, unbounded()}.
+        std::size_t knn(const point_type &query, std::size_t k, neighbor *out) const {
+            std::size_t found = 0;
+            if(k != 0 && !empty()) {
+                distance_type worst = unbounded();
+                search(query, worst, [&](std::size_t i, distance_type d) {
+                    if(found < k) {
+                        out[found++] = neighbor{indices[i], d};
+                        std::push_heap(out, out + found);
+                        if(found == k) worst = out[0].squared_distance;
+                    } else if(neighbor{indices[i], d} < out[0]) {
+                        std::pop_heap(out, out + k);
+                        out[k - 1] = neighbor{indices[i], d};
+                        std::push_heap(out, out + k);
+                        worst = out[0].squared_distance;
+                    }
+                });
+                std::sort_heap(out, out + found);
+            }
+            std::fill(out + found, out + k, neighbor{npos, unbounded()});
+            return found;
+        }
+
+        std::vector<neighbor> knn(const point_type &query, std::size_t k) const {
+            std::vector<neighbor> out(k);
+            out.resize(knn(query, k, out.data()));
+            return out;
+        }
+
+        // every point with |p - query| <= radius, in no particular order; out is overwritten.
+        std::size_t radius(const point_type &query, distance_type radius, std::vector<neighbor> &out) const {
+            out.clear();
+            if(empty()) return 0;
+            distance_type bound = radius * radius;
+            search(query, bound, [&](std::size_t i, distance_type d) {
+                out.push_back(neighbor{indices[i], d});
+            });
+            return out.size();
+        }
+
+        std::vector<neighbor> radius(const point_type &query, distance_type radius) const {
+            std::vector<neighbor> out;
+            this->radius(query, radius, out);
+            return out;
+        }
+
+        // out[q * k, (q + 1) * k) receives knn(queries[q], k); returns the total found.
+        template <typename policy>
+        auto knn(const policy &p, const point_type *queries, std::size_t count, std::size_t k, neighbor *out) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, std::size_t>::type
+        {
+            std::vector<std::size_t> found((count + detail::kd_tree::chunk - 1) / detail::kd_tree::chunk, 0);
+            for_each_chunk(execution::pool_of(p), count, [&](std::size_t c, std::size_t begin, std::size_t end) {
+                for(std::size_t q = begin; q < end; q++) found[c] += knn(queries[q], k, out + q * k);
+            });
+            std::size_t total = 0;
+            for(std::size_t f : found) total += f;
+            return total;
+        }
+
+        // out[q] receives radius(queries[q], radius).
+        template <typename policy>
+        auto radius(const policy &p, const point_type *queries, std::size_t count, distance_type radius, std::vector<std::vector<neighbor>> &out) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+        {
+            out.resize(count);
+            for_each_chunk(execution::pool_of(p), count, [&](std::size_t, std::size_t begin, std::size_t end) {
+                for(std::size_t q = begin; q < end; q++) this->radius(queries[q], radius, out[q]);
+            });
+        }
+
+    private:
+        // inner nodes: split value and axis, right child index; the left child is the next node.
+        // every node also records the range of points below it, leaves have right == 0.
+        struct node {
+            value_t split;
+            std::uint32_t begin, end;
+            std::uint32_t right;
+            std::uint32_t axis;
+        };
+
+        std::size_t build_node(std::size_t begin, std::size_t end) {
+            const std::size_t index = nodes.size();
+            nodes.push_back(node{value_t(0), static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end), 0, 0});
+            if(end - begin <= leaf_size) return index;
+
+            point_type lo = points[begin], hi = points[begin];
+            for(std::size_t i = begin + 1; i < end; i++) {
+                for(std::size_t k = 0; k < s; k++) {
+                    lo[k] = std::min<compute_t<value_t>>(lo[k], points[i][k]);
+                    hi[k] = std::max<compute_t<value_t>>(hi[k], points[i][k]);
+                }
+            }
+            std::size_t axis = 0;
+            for(std::size_t k = 1; k < s; k++) {
+                if(distance_type(hi[axis]) - distance_type(lo[axis]) < distance_type(hi[k]) - distance_type(lo[k])) axis = k;
+            }
+            if(!(compute_t<value_t>(lo[axis]) < compute_t<value_t>(hi[axis]))) return index; // all points equal
+
+            const std::size_t mid = begin + (end - begin) / 2;
+            partition(begin, mid, end, axis);
+            nodes[index].split = points[mid][axis];
+            nodes[index].axis = static_cast<std::uint32_t>(axis);
+            build_node(begin, mid);
+            nodes[index].right = static_cast<std::uint32_t>(build_node(mid, end));
+            return index;
+        }
+
+        // nth_element on (point, index) pairs kept in two arrays.
+        void partition(std::size_t begin, std::size_t mid, std::size_t end, std::size_t axis) {
+            std::vector<std::uint32_t> &order = order_buffer();
+            order.resize(end - begin);
+            for(std::size_t i = 0; i < order.size(); i++) order[i] = static_cast<std::uint32_t>(begin + i);
+            std::nth_element(order.begin(), order.begin() + (mid - begin), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+                return compute_t<value_t>(points[a][axis]) < compute_t<value_t>(points[b][axis]);
+            });
+            std::vector<point_type> &moved_points = point_buffer();
+            std::vector<std::uint32_t> &moved_indices = index_buffer();
+            moved_points.resize(order.size());
+            moved_indices.resize(order.size());
+            for(std::size_t i = 0; i < order.size(); i++) {
+                moved_points[i] = points[order[i]];
+                moved_indices[i] = indices[order[i]];
+            }
+            std::copy(moved_points.begin(), moved_points.end(), points.begin() + begin);
+            std::copy(moved_indices.begin(), moved_indices.end(), indices.begin() + begin);
+        }
+
+        distance_type squared_distance(const point_type &a, const point_type &b) const {
+            distance_type sum{0};
+            for(std::size_t k = 0; k < s; k++) {
+                const distance_type d = distance_type(a[k]) - distance_type(b[k]);
+                sum += d * d;
+            }
+            return sum;
+        }
+
+        // visits every point closer than bound (inclusive); visit may shrink bound.
+        // far children are pushed with the squared distance to their splitting plane.
+        template <typename visitor>
+        void search(const point_type &query, distance_type &bound, visitor visit) const {
+            struct pending {
+                std::size_t node;
+                distance_type plane;
+            } stack[detail::kd_tree::max_depth];
+            std::size_t top = 0;
+            stack[top++] = pending{0, distance_type(0)};
+            while(top) {
+                const pending current = stack[--top];
+                if(bound < current.plane) continue;
+                std::size_t n = current.node;
+                while(nodes[n].right) {
+                    const node &inner = nodes[n];
+                    const distance_type diff = distance_type(query[inner.axis]) - distance_type(inner.split);
+                    const std::size_t near = diff < 0 ? n + 1 : inner.right;
+                    const std::size_t far = diff < 0 ? inner.right : n + 1;
+                    if(diff * diff <= bound) stack[top++] = pending{far, diff * diff};
+                    n = near;
+                }
+                for(std::size_t i = nodes[n].begin; i < nodes[n].end; i++) {
+                    const distance_type d = squared_distance(points[i], query);
+                    if(d <= bound) visit(i, d);
+                }
+            }
+        }
+
+        template <typename function>
+        static void for_each_chunk(thread_pool *pool, std::size_t count, function f) {
+            const std::size_t chunk = detail::kd_tree::chunk, chunk_num = (count + chunk - 1) / chunk;
+            const auto run = [&](std::size_t c) { f(c, c * chunk, std::min(count, (c + 1) * chunk)); };
+            if(pool && 1 < pool->size() && 1 < chunk_num) pool->parallel_for(chunk_num, run);
+            else for(std::size_t c = 0; c < chunk_num; c++) run(c);
+        }
+
+        static std::vector<std::uint32_t> &order_buffer() {
+            static thread_local std::vector<std::uint32_t> buffer;
+            return buffer;
+        }
+        static std::vector<std::uint32_t> &index_buffer() {
+            static thread_local std::vector<std::uint32_t> buffer;
+            return buffer;
+        }
+        static std::vector<point_type> &point_buffer() {
+            static thread_local std::vector<point_type> buffer;
+            return buffer;
+        }
+
+        std::vector<node> nodes;
+        std::vector<point_type> points;
+        std::vector<std::uint32_t> indices;
+        std::size_t leaf_size{16};
+    };
+};
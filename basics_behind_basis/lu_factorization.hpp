@@ -0,0 +1,474 @@
+//
+//  lu_factorization.hpp
+//
+//  PA = LU with partial pivoting, L and U packed into one matrix
+//  (unit diagonal of L implied) plus a row permutation. factor once,
+//  then solve / determinant / inverse reuse it. factorize(execution::par, a)
+//  runs the blocked factorization on the thread pool.
+//
+//  refined_lu_factorization factors a low precision copy (float, half or
+//  bfloat16) and recovers the working precision by iterative refinement:
+//  x += LU^-1 (b - A x), with the residual computed from A itself.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "numeric.hpp"
+#include "matrix.hpp"
+#include "dynamic_matrix.hpp"
+#include "gemm.hpp"
+#include "thread_pool.hpp"
+#include "instrumentation.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace lu {
+            // columns of one panel in the blocked factorization.
+            constexpr std::size_t block = 64;
+
+            // right-looking elimination of columns [k0, k0 + nb) over rows [k0, n) of an
+            // n x n row major block; row exchanges swap whole rows. false if a zero pivot was met.
+            template <typename value_t>
+            bool factor_panel(std::size_t n, value_t *a, std::size_t ld, std::size_t k0, std::size_t nb, std::size_t *perm, bool &odd) {
+                bool regular = true;
+                for(std::size_t k = k0; k < k0 + nb; k++) {
+                    std::size_t pivot = k;
+                    value_t max = std::abs(a[k * ld + k]);
+                    for(std::size_t i = k + 1; i < n; i++) {
+                        const value_t candidate = std::abs(a[i * ld + k]);
+                        if(max < candidate) max = candidate, pivot = i;
+                    }
+                    if(max == value_t(0)) {
+                        regular = false;
+                        continue;
+                    }
+                    if(pivot != k) {
+                        std::swap_ranges(a + k * ld, a + k * ld + n, a + pivot * ld);
+                        std::swap(perm[k], perm[pivot]);
+                        odd = !odd;
+                    }
+                    const value_t *row_k = a + k * ld;
+                    const value_t inverse = value_t(1) / row_k[k];
+                    for(std::size_t i = k + 1; i < n; i++) {
+                        value_t *row_i = a + i * ld;
+                        const value_t l = row_i[k] *= inverse;
+                        for(std::size_t j = k + 1; j < k0 + nb; j++) row_i[j] -= l * row_k[j];
+                    }
+                }
+                return regular;
+            }
+
+            // perm[i] is the original row now at row i. large matrices are factored a panel
+            // at a time: the row of U next to the panel is a triangular solve and the trailing
+            // update is a gemm, both split over pool when given. the negated L21 copy is owned
+            // by the call: a thread waiting in the gemm can run another factorization.
+            template <typename value_t>
+            bool factor(std::size_t n, value_t *a, std::size_t ld, std::size_t *perm, bool &odd, thread_pool *pool = nullptr) {
+                odd = false;
+                for(std::size_t i = 0; i < n; i++) perm[i] = i;
+                if(n < 2 * block) return factor_panel(n, a, ld, 0, n, perm, odd);
+
+                bool regular = true;
+                std::vector<value_t> l21((n - block) * block);
+                for(std::size_t k0 = 0; k0 < n; k0 += block) {
+                    const std::size_t nb = std::min(block, n - k0);
+                    regular = factor_panel(n, a, ld, k0, nb, perm, odd) && regular;
+                    const std::size_t rest = k0 + nb, m = n - rest;
+                    if(m == 0) break;
+
+                    // U12 = L11^-1 A12, in column chunks
+                    const std::size_t chunk = 4 * block;
+                    const auto solve_chunk = [=](std::size_t c) {
+                        const std::size_t j0 = rest + c * chunk, j1 = std::min(n, j0 + chunk);
+                        for(std::size_t i = 1; i < nb; i++) {
+                            value_t *row_i = a + (k0 + i) * ld;
+                            for(std::size_t p = 0; p < i; p++) {
+                                const value_t l = row_i[k0 + p];
+                                const value_t *row_p = a + (k0 + p) * ld;
+                                for(std::size_t j = j0; j < j1; j++) row_i[j] -= l * row_p[j];
+                            }
+                        }
+                    };
+                    const std::size_t chunk_num = (m + chunk - 1) / chunk;
+                    if(pool) pool->parallel_for(chunk_num, solve_chunk);
+                    else for(std::size_t c = 0; c < chunk_num; c++) solve_chunk(c);
+
+                    // A22 -= L21 U12
+                    for(std::size_t i = 0; i < m; i++) {
+                        const value_t *row = a + (rest + i) * ld + k0;
+                        for(std::size_t p = 0; p < nb; p++) l21[i * nb + p] = -row[p];
+                    }
+                    gemm::multiply(pool, m, m, nb,
+                                   l21.data(), nb, 1,
+                                   a + k0 * ld + rest, ld, 1,
+                                   a + rest * ld + rest, ld, 1);
+                }
+                return regular;
+            }
+
+            // b (n x nrhs, row stride ldb) is overwritten by the solution of LU x = b.
+            // the permutation must already be applied to b.
+            template <typename value_t>
+            void substitute(std::size_t n, const value_t *a, std::size_t ld, value_t *b, std::size_t ldb, std::size_t nrhs) {
+                for(std::size_t i = 1; i < n; i++) {
+                    value_t *b_i = b + i * ldb;
+                    const value_t *row_i = a + i * ld;
+                    for(std::size_t k = 0; k < i; k++) {
+                        const value_t l = row_i[k];
+                        const value_t *b_k = b + k * ldb;
+                        for(std::size_t j = 0; j < nrhs; j++) b_i[j] -= l * b_k[j];
+                    }
+                }
+                for(std::size_t i = n; i-- > 0;) {
+                    value_t *b_i = b + i * ldb;
+                    const value_t *row_i = a + i * ld;
+                    for(std::size_t k = i + 1; k < n; k++) {
+                        const value_t u = row_i[k];
+                        const value_t *b_k = b + k * ldb;
+                        for(std::size_t j = 0; j < nrhs; j++) b_i[j] -= u * b_k[j];
+                    }
+                    const value_t inverse = value_t(1) / row_i[i];
+                    for(std::size_t j = 0; j < nrhs; j++) b_i[j] *= inverse;
+                }
+            }
+        };
+
+        // raw row major access to the storage of the matrix types.
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        inline value_t *storage_of(matrix<row_num, col_num, value_t> &m) { return m.raw_data(); }
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        inline const value_t *storage_of(const matrix<row_num, col_num, value_t> &m) { return m.raw_data(); }
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        inline std::size_t stride_of(const matrix<row_num, col_num, value_t> &) { return col_num; }
+
+        template <typename value_t, typename allocator>
+        inline value_t *storage_of(dynamic_matrix<value_t, allocator> &m) { return m.data(); }
+        template <typename value_t, typename allocator>
+        inline const value_t *storage_of(const dynamic_matrix<value_t, allocator> &m) { return m.data(); }
+        template <typename value_t, typename allocator>
+        inline std::size_t stride_of(const dynamic_matrix<value_t, allocator> &m) { return m.leading_dimension(); }
+
+        // right hand sides: n x k matrices, or vectors given as 1 x n / std::vector.
+        template <typename value_t>
+        struct rhs_block {
+            value_t *data;
+            std::size_t ld, count;
+        };
+
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        inline rhs_block<value_t> as_rhs(matrix<row_num, col_num, value_t> &b, std::size_t n) {
+            if(row_num == 1 && col_num == n && n != 1) return {b.raw_data(), 1, 1};
+            assert(row_num == n);
+            return {b.raw_data(), col_num, col_num};
+        }
+
+        template <typename value_t, typename allocator>
+        inline rhs_block<value_t> as_rhs(dynamic_matrix<value_t, allocator> &b, std::size_t n) {
+            assert(b.row_size() == n);
+            return {b.data(), b.leading_dimension(), b.column_size()};
+        }
+
+        template <typename value_t, typename allocator>
+        inline rhs_block<value_t> as_rhs(std::vector<value_t, allocator> &b, std::size_t n) {
+            assert(b.size() == n);
+            return {b.data(), 1, 1};
+        }
+
+        template <typename matrix_type, bool = matrix_type::row_extent == dynamic_extent>
+        struct permutation_storage { using type = std::vector<std::size_t>; };
+
+        template <typename matrix_type>
+        struct permutation_storage<matrix_type, false> { using type = std::array<std::size_t, matrix_type::row_extent>; };
+
+        // the same shape of matrix holding another element type.
+        template <typename matrix_type, typename value_t>
+        struct rebind_matrix;
+
+        template <std::size_t row_num, std::size_t col_num, typename value_t_, typename value_t>
+        struct rebind_matrix<matrix<row_num, col_num, value_t_>, value_t> { using type = matrix<row_num, col_num, value_t>; };
+
+        template <std::size_t size, typename value_t_, typename value_t>
+        struct rebind_matrix<square_matrix<size, value_t_>, value_t> { using type = square_matrix<size, value_t>; };
+
+        template <typename value_t_, typename allocator, typename value_t>
+        struct rebind_matrix<dynamic_matrix<value_t_, allocator>, value_t> { using type = dynamic_matrix<value_t>; };
+
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        inline void resize_like(matrix<row_num, col_num, value_t> &, std::size_t, std::size_t) {}
+        template <typename value_t, typename allocator>
+        inline void resize_like(dynamic_matrix<value_t, allocator> &m, std::size_t rows, std::size_t cols) { m.resize(rows, cols); }
+    };
+
+    template <typename matrix_type>
+    struct lu_factorization {
+        using value_type = typename matrix_type::value_type;
+        using permutation_type = typename detail::permutation_storage<matrix_type>::type;
+
+        lu_factorization() = default;
+        explicit lu_factorization(const matrix_type &a) { factorize(a); }
+        template <typename policy, typename std::enable_if<execution::is_execution_policy<policy>::value>::type * = nullptr>
+        lu_factorization(const policy &p, const matrix_type &a) { factorize(p, a); }
+
+        // reuses the storage of a previous factorization when the size matches.
+        lu_factorization &factorize(const matrix_type &a) {
+            return factorize(execution::seq, a);
+        }
+
+        template <typename policy>
+        auto factorize(const policy &p, const matrix_type &a)
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, lu_factorization &>::type
+        {
+            assert(a.row_size() == a.column_size());
+            const std::size_t n = a.row_size();
+            BBB_INSTRUMENT_SPAN(lu_decomposition, n, n, 0, 2 * n * n * n / 3, 2 * n * n * sizeof(value_type));
+            lu = a;
+            resize_permutation(perm, n);
+            regular = detail::lu::factor(size(), detail::storage_of(lu), detail::stride_of(lu), perm.data(), odd, execution::pool_of(p));
+            return *this;
+        }
+
+        std::size_t size() const { return lu.row_size(); }
+        bool is_singular() const { return !regular; }
+
+        // L below the diagonal (unit diagonal implied), U on and above it.
+        const matrix_type &packed() const { return lu; }
+        // row i of P A is row permutation()[i] of A.
+        const permutation_type &permutation() const { return perm; }
+
+        value_type determinant() const {
+            if(!regular) return value_type(0);
+            value_type det = odd ? value_type(-1) : value_type(1);
+            for(std::size_t i = 0; i < size(); i++) det *= lu(i, i);
+            return det;
+        }
+
+        // b is an n x k matrix of right hand sides, a row_vector<n> / column_vector<n> or a std::vector.
+        template <typename rhs_type>
+        rhs_type solve(const rhs_type &b) const {
+            rhs_type x = b;
+            solve_in_place(x);
+            return x;
+        }
+
+        template <typename rhs_type>
+        void solve_in_place(rhs_type &b) const {
+            const detail::rhs_block<value_type> block = detail::as_rhs(b, size());
+            solve_in_place(block.data, block.ld, block.count);
+        }
+
+        // n x nrhs block with row stride ldb, overwritten by the solution.
+        void solve_in_place(value_type *b, std::size_t ldb, std::size_t nrhs) const {
+            assert(regular);
+            const std::size_t n = size();
+            BBB_INSTRUMENT_SPAN(lu_solve, n, n, nrhs, 2 * n * n * nrhs, (n * n + 2 * n * nrhs) * sizeof(value_type));
+            std::vector<value_type> &scratch = permute_buffer();
+            scratch.resize(n * nrhs);
+            for(std::size_t i = 0; i < n; i++) std::copy(b + perm[i] * ldb, b + perm[i] * ldb + nrhs, scratch.data() + i * nrhs);
+            for(std::size_t i = 0; i < n; i++) std::copy(scratch.data() + i * nrhs, scratch.data() + (i + 1) * nrhs, b + i * ldb);
+            detail::lu::substitute(n, detail::storage_of(lu), detail::stride_of(lu), b, ldb, nrhs);
+        }
+
+        matrix_type inverse() const {
+            matrix_type inv = lu;
+            const std::size_t n = size();
+            BBB_INSTRUMENT_SPAN(lu_solve, n, n, n, 2 * n * n * n, 3 * n * n * sizeof(value_type));
+            value_type *data = detail::storage_of(inv);
+            const std::size_t ld = detail::stride_of(inv);
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) data[i * ld + j] = value_type(perm[i] == j);
+            }
+            assert(regular);
+            detail::lu::substitute(n, detail::storage_of(lu), detail::stride_of(lu), data, ld, n);
+            return inv;
+        }
+
+    private:
+        static void resize_permutation(std::vector<std::size_t> &p, std::size_t n) { p.resize(n); }
+        template <std::size_t n>
+        static void resize_permutation(std::array<std::size_t, n> &, std::size_t) {}
+
+        static std::vector<value_type> &permute_buffer() {
+            static thread_local std::vector<value_type> buffer;
+            return buffer;
+        }
+
+        matrix_type lu;
+        permutation_type perm{};
+        bool regular{false};
+        bool odd{false};
+    };
+
+    template <typename matrix_type>
+    inline lu_factorization<matrix_type> make_lu_factorization(const matrix_type &a) {
+        return lu_factorization<matrix_type>(a);
+    }
+
+    // outcome of a refined solve. residual is the largest normwise backward error
+    // |b - A x|_inf / (|A|_inf |x|_inf) over the right hand sides.
+    struct refinement_status {
+        std::size_t iterations;
+        double residual;
+        bool converged;
+    };
+
+    // A is kept in its own precision for the residuals; only the O(n^3) factorization
+    // runs in factor_t. refinement converges while cond(A) * eps(factor_t) < 1.
+    template <typename matrix_type, typename factor_t = float>
+    struct refined_lu_factorization {
+        using value_type = typename matrix_type::value_type;
+        using factor_matrix_type = typename detail::rebind_matrix<matrix_type, factor_t>::type;
+
+        // corrections applied at most per solve.
+        std::size_t max_iterations{10};
+
+        refined_lu_factorization() = default;
+        explicit refined_lu_factorization(const matrix_type &a) { factorize(a); }
+        template <typename policy, typename std::enable_if<execution::is_execution_policy<policy>::value>::type * = nullptr>
+        refined_lu_factorization(const policy &p, const matrix_type &a) { factorize(p, a); }
+
+        refined_lu_factorization &factorize(const matrix_type &a) {
+            return factorize(execution::seq, a);
+        }
+
+        template <typename policy>
+        auto factorize(const policy &p, const matrix_type &a)
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, refined_lu_factorization &>::type
+        {
+            assert(a.row_size() == a.column_size());
+            this->a = a;
+            const std::size_t n = size();
+            detail::resize_like(low, n, n);
+            const value_type *src = detail::storage_of(this->a);
+            factor_t *dst = detail::storage_of(low);
+            const std::size_t ld = detail::stride_of(this->a), low_ld = detail::stride_of(low);
+            a_norm = 0.0;
+            for(std::size_t i = 0; i < n; i++) {
+                convert(src + i * ld, dst + i * low_ld, n);
+                double row_sum = 0.0;
+                for(std::size_t j = 0; j < n; j++) row_sum += std::abs(double(src[i * ld + j]));
+                a_norm = std::max(a_norm, row_sum);
+            }
+            lu.factorize(p, low);
+            return *this;
+        }
+
+        std::size_t size() const { return a.row_size(); }
+        // singular in factor_t; a matrix that is regular in the working precision can still be.
+        bool is_singular() const { return lu.is_singular(); }
+
+        const lu_factorization<factor_matrix_type> &low_precision() const { return lu; }
+
+        template <typename rhs_type>
+        rhs_type solve(const rhs_type &b) const {
+            rhs_type x = b;
+            solve_in_place(x);
+            return x;
+        }
+
+        template <typename rhs_type>
+        refinement_status solve_in_place(rhs_type &b) const {
+            const detail::rhs_block<value_type> block = detail::as_rhs(b, size());
+            return solve_in_place(block.data, block.ld, block.count);
+        }
+
+        // n x nrhs block with row stride ldb, overwritten by the solution.
+        // stops once the backward error is within sqrt(n) units of roundoff of value_type;
+        // b is left untouched if the low precision factorization is singular.
+        refinement_status solve_in_place(value_type *b, std::size_t ldb, std::size_t nrhs) const {
+            refinement_status status{0, std::numeric_limits<double>::infinity(), false};
+            if(lu.is_singular()) return status;
+            const std::size_t n = size(), count = n * nrhs;
+            std::vector<value_type> &x = solution_buffer();
+            std::vector<value_type> &r = residual_buffer();
+            std::vector<factor_t> &d = correction_buffer();
+            std::vector<value_type> &scale = scale_buffer();
+            x.resize(count);
+            r.resize(count);
+            d.resize(count);
+
+            for(std::size_t i = 0; i < n; i++) convert(b + i * ldb, d.data() + i * nrhs, nrhs);
+            lu.solve_in_place(d.data(), nrhs, nrhs);
+            convert(d.data(), x.data(), count);
+
+            const double tolerance = numeric_traits<value_type>::epsilon() * std::sqrt(double(n));
+            while(true) {
+                status.residual = residual(b, ldb, nrhs, x.data(), r.data());
+                if(status.residual <= tolerance) {
+                    status.converged = true;
+                    break;
+                }
+                if(status.iterations == max_iterations) break;
+                // each residual column is scaled to unit max norm first, so it neither
+                // underflows nor overflows the narrow exponent range of half.
+                scale.assign(nrhs, value_type(0));
+                for(std::size_t k = 0; k < count; k++) scale[k % nrhs] = std::max<value_type>(scale[k % nrhs], std::abs(r[k]));
+                for(std::size_t j = 0; j < nrhs; j++) if(scale[j] == value_type(0)) scale[j] = value_type(1);
+                for(std::size_t k = 0; k < count; k++) d[k] = factor_t(compute_t<value_type>(r[k] / scale[k % nrhs]));
+                lu.solve_in_place(d.data(), nrhs, nrhs);
+                for(std::size_t k = 0; k < count; k++) x[k] += scale[k % nrhs] * value_type(compute_t<factor_t>(d[k]));
+                status.iterations++;
+            }
+            for(std::size_t i = 0; i < n; i++) std::copy(x.data() + i * nrhs, x.data() + (i + 1) * nrhs, b + i * ldb);
+            return status;
+        }
+
+    private:
+        // r = b - A x in accumulator_t<value_type>; returns the largest backward error of the columns.
+        double residual(const value_type *b, std::size_t ldb, std::size_t nrhs, const value_type *x, value_type *r) const {
+            using acc_t = accumulator_t<value_type>;
+            const std::size_t n = size(), ld = detail::stride_of(a);
+            const value_type *data = detail::storage_of(a);
+            double worst = 0.0;
+            for(std::size_t j = 0; j < nrhs; j++) {
+                double r_norm = 0.0, x_norm = 0.0;
+                for(std::size_t i = 0; i < n; i++) {
+                    acc_t sum = acc_t(b[i * ldb + j]);
+                    const value_type *row = data + i * ld;
+                    for(std::size_t k = 0; k < n; k++) sum -= acc_t(row[k]) * acc_t(x[k * nrhs + j]);
+                    r[i * nrhs + j] = value_type(sum);
+                    r_norm = std::max(r_norm, std::abs(double(sum)));
+                    x_norm = std::max(x_norm, std::abs(double(x[i * nrhs + j])));
+                }
+                const double scale = a_norm * x_norm;
+                worst = std::max(worst, scale == 0.0 ? (r_norm == 0.0 ? 0.0 : std::numeric_limits<double>::infinity()) : r_norm / scale);
+            }
+            return worst;
+        }
+
+        static std::vector<value_type> &solution_buffer() {
+            static thread_local std::vector<value_type> buffer;
+            return buffer;
+        }
+        static std::vector<value_type> &residual_buffer() {
+            static thread_local std::vector<value_type> buffer;
+            return buffer;
+        }
+        static std::vector<value_type> &scale_buffer() {
+            static thread_local std::vector<value_type> buffer;
+            return buffer;
+        }
+        static std::vector<factor_t> &correction_buffer() {
+            static thread_local std::vector<factor_t> buffer;
+            return buffer;
+        }
+
+        matrix_type a;
+        factor_matrix_type low;
+        lu_factorization<factor_matrix_type> lu;
+        double a_norm{0.0};
+    };
+
+    template <typename factor_t = float, typename matrix_type>
+    inline refined_lu_factorization<matrix_type, factor_t> make_refined_lu_factorization(const matrix_type &a) {
+        return refined_lu_factorization<matrix_type, factor_t>(a);
+    }
+};
@@ -20,127 +20,433 @@
 #include <array>
 #include <cmath>
 #include <algorithm>
+#include <cassert>
+
+#include "expression.hpp"
+#include "strided_view.hpp"
+#include "matrix_product.hpp"
+#include "gemm.hpp"
+#include "simd.hpp"
+#include "numeric.hpp"
+#include "reduction.hpp"
+#include "instrumentation.hpp"
 
 namespace bbb {
     using default_value_t = double;
 
+    namespace detail {
+        template <std::size_t ... indices>
+        struct index_sequence {};
+
+        template <std::size_t n, std::size_t ... indices>
+        struct make_index_sequence_impl : make_index_sequence_impl<n - 1, n - 1, indices ...> {};
+        template <std::size_t ... indices>
+        struct make_index_sequence_impl<0, indices ...> { using type = index_sequence<indices ...>; };
+
+        template <std::size_t n>
+        using make_index_sequence = typename make_index_sequence_impl<n>::type;
+
+        template <typename value_t>
+        constexpr value_t sum(value_t x) { return x; }
+        template <typename value_t, typename ... value_ts>
+        constexpr value_t sum(value_t x, value_ts ... xs) { return x + sum(xs ...); }
+
+        // matrices up to 4 x 4 use fully unrolled kernels that fold to constants
+        // when their arguments are constant.
+        template <std::size_t row_num, std::size_t col_num, std::size_t inner_num = 1>
+        struct is_small_matrix : std::integral_constant<bool, row_num <= 4 && col_num <= 4 && inner_num <= 4> {};
+
+        struct from_rows_t {};
+    };
+
     template <std::size_t row_num, std::size_t col_num, typename value_t = default_value_t>
-    struct matrix {
+    struct matrix : matrix_expression_tag {
         using value_type = value_t;
         using column_type = std::array<value_t, col_num>;
         using inner_container_type = std::array<column_type, row_num>;
         inner_container_type data;
+        static_assert(sizeof(inner_container_type) == sizeof(value_t) * row_num * col_num, "required: contiguous storage");
+        
+        static constexpr std::size_t row_extent = row_num;
+        static constexpr std::size_t column_extent = col_num;
         
         constexpr std::size_t row_size() const { return row_num; }
         constexpr std::size_t column_size() const { return col_num; }
 
         matrix() = default;
-        matrix(const value_type (&data)[col_num][row_num]) {
-            for(std::size_t j = 0; j < col_num; j++) {
-                for(std::size_t i = 0; i < row_num; i++) {
-                    this->data[j][i] = data[j][i];
-                }
-            }
-        }
+        constexpr matrix(const value_type (&data)[row_num][col_num])
+        : matrix(data, detail::make_index_sequence<row_num>{}, detail::make_index_sequence<col_num>{}) {}
+        constexpr matrix(detail::from_rows_t, const inner_container_type &data)
+        : data(data) {}
+        template <typename expression, typename std::enable_if<is_matrix_expression<expression>::value && !std::is_base_of<matrix, expression>::value>::type * = nullptr>
+        matrix(const expression &e) { assign(e); }
+        // products are multiplied in the order chosen by matrix_product.hpp.
+        template <typename lhs_t, typename rhs_t, typename std::enable_if<std::is_same<typename matrix_product<lhs_t, rhs_t>::result_type, matrix>::value>::type * = nullptr>
+        constexpr matrix(const matrix_product<lhs_t, rhs_t> &p)
+        : matrix(p.eval()) {}
+        
+        template <typename expression>
+        auto operator=(const expression &e)
+        -> typename std::enable_if<is_matrix_expression<expression>::value && !std::is_base_of<matrix, expression>::value, matrix &>::type
+        { return detail::aliases(e, span()) ? *this = matrix(e) : assign(e); }
+        
         inline column_type &operator[](std::size_t index) { return data[index]; }
         inline const column_type &operator[](std::size_t index) const { return data[index]; }
         
-        inline matrix operator+(const matrix &rhs) const { return matrix{*this} += rhs; }
-        matrix &operator+=(const matrix &rhs) {
-            for(std::size_t j = 0; j < data.size(); j++) {
-                for(std::size_t i = 0; i < data[j].size(); i++) {
-                    data[j][i] += rhs.data[j][i];
-                }
-            }
-            return *this;
-        }
+        inline value_type &operator()(std::size_t i, std::size_t j) { return data[i][j]; }
+        inline constexpr const value_type &operator()(std::size_t i, std::size_t j) const { return data[i][j]; }
         
-        inline constexpr matrix operator-(const matrix &rhs) const { return matrix{*this} -= rhs; }
-        matrix &operator-=(const matrix &rhs) {
-            for(std::size_t j = 0; j < data.size(); j++) {
-                for(std::size_t i = 0; i < data[j].size(); i++) {
-                    data[j][i] -= rhs[j][i];
-                }
-            }
-            return *this;
+        template <typename expression>
+        auto operator+=(const expression &rhs)
+        -> typename std::enable_if<is_matrix_expression<expression>::value, matrix &>::type
+        {
+            static_assert(detail::extent_matches(expression::row_extent, row_num) && detail::extent_matches(expression::column_extent, col_num), "required: operands have same dimensions");
+            assert(rhs.row_size() == row_num && rhs.column_size() == col_num);
+            if(detail::aliases(rhs, span())) return *this += matrix(rhs);
+            return add_assign(rhs, std::is_base_of<matrix, expression>{});
         }
         
-        template <std::size_t col_num_, typename value_t_>
-        matrix<row_num, col_num_, value_t> operator*(const matrix<col_num, col_num_, value_t_> &rhs) const {
-            matrix<row_num, col_num_, value_t> res;
-            for(std::size_t i = 0; i < row_num; i++) {
-                for(std::size_t j = 0; j < col_num_; j++) {
-                    res[i][j] = 0;
-                    for(std::size_t k = 0; k < col_num; k++) {
-                        res[i][j] += data[i][k] * rhs[k][j];
-                    }
-                }
-            }
-            return res;
+        template <typename expression>
+        auto operator-=(const expression &rhs)
+        -> typename std::enable_if<is_matrix_expression<expression>::value, matrix &>::type
+        {
+            static_assert(detail::extent_matches(expression::row_extent, row_num) && detail::extent_matches(expression::column_extent, col_num), "required: operands have same dimensions");
+            assert(rhs.row_size() == row_num && rhs.column_size() == col_num);
+            if(detail::aliases(rhs, span())) return *this -= matrix(rhs);
+            return sub_assign(rhs, std::is_base_of<matrix, expression>{});
         }
         
-        inline constexpr matrix operator*(value_t scale) const { return matrix{*this} *= scale; }
         matrix &operator*=(value_t scale) {
-            for(std::size_t j = 0; j < data.size(); j++) {
-                for(std::size_t i = 0; i < data[j].size(); i++) {
-                    data[j][i] *= scale;
-                }
-            }
+            simd::scale(raw_data(), scale, row_num * col_num);
             return *this;
         }
         
-        inline constexpr matrix operator/(value_t scale) const { return matrix{*this} /= scale; }
         matrix &operator/=(value_t scale) {
             return *this *= (1.0 / scale);
         }
         
         inline constexpr matrix operator+() const { return matrix{*this}; }
-        inline constexpr matrix operator-() const { return matrix{*this} *= -1.0; }
         
         inline constexpr bool operator==(const matrix &rhs) const { return data == rhs.data; };
         inline constexpr bool operator!=(const matrix &rhs) const { return data != rhs.data; };
         inline void swap(matrix &rhs) { std::swap(data, rhs.data); }
         
-        constexpr_14 matrix<col_num, row_num, value_t> transpose() const {
+        constexpr matrix<col_num, row_num, value_t> transpose() const {
+            return transposed(detail::is_small_matrix<row_num, col_num>{});
+        }
+
+        // zero-copy windows on the elements, see strided_view.hpp.
+        strided_view<value_t, row_num, col_num> view() { return {raw_data(), row_num, col_num, col_num, 1}; }
+        strided_view<const value_t, row_num, col_num> view() const { return {raw_data(), row_num, col_num, col_num, 1}; }
+
+        template <std::size_t block_rows, std::size_t block_cols>
+        strided_view<value_t, block_rows, block_cols> block(std::size_t i, std::size_t j) { return view().template block<block_rows, block_cols>(i, j); }
+        template <std::size_t block_rows, std::size_t block_cols>
+        strided_view<const value_t, block_rows, block_cols> block(std::size_t i, std::size_t j) const { return view().template block<block_rows, block_cols>(i, j); }
+
+        strided_view<value_t> block(std::size_t i, std::size_t j, std::size_t block_rows, std::size_t block_cols) { return view().block(i, j, block_rows, block_cols); }
+        strided_view<const value_t> block(std::size_t i, std::size_t j, std::size_t block_rows, std::size_t block_cols) const { return view().block(i, j, block_rows, block_cols); }
+
+        strided_view<value_t, 1, col_num> row_view(std::size_t i) { return view().row_view(i); }
+        strided_view<const value_t, 1, col_num> row_view(std::size_t i) const { return view().row_view(i); }
+
+        strided_view<value_t, row_num, 1> column_view(std::size_t j) { return view().column_view(j); }
+        strided_view<const value_t, row_num, 1> column_view(std::size_t j) const { return view().column_view(j); }
+
+        // transposed view; transpose() makes a copy.
+        strided_view<value_t, col_num, row_num> t() { return view().t(); }
+        strided_view<const value_t, col_num, row_num> t() const { return view().t(); }
+
+        template <std::size_t size = row_num>
+        inline constexpr auto trace() const
+        -> typename std::enable_if<size == col_num, value_type>::type
+        {
+            return diagonal_sum(detail::is_small_matrix<size, size>{});
+        }
+
+        // closed form for sizes up to 4
+        template <std::size_t size = row_num>
+        constexpr_14 auto determinant() const
+        -> typename std::enable_if<size == col_num && size <= 4, value_type>::type
+        {
+            return determinant_of(std::integral_constant<std::size_t, size>{});
+        }
+
+        // closed form (adjugate over determinant) for sizes up to 4; the matrix must be regular.
+        template <std::size_t size = row_num>
+        constexpr_14 auto inverse() const
+        -> typename std::enable_if<size == col_num && size <= 4, matrix>::type
+        {
+            return inverse_of(std::integral_constant<std::size_t, size>{});
+        }
+
+        template <std::size_t size = row_num>
+        typename std::enable_if<size == col_num>::type lu_decomposition(matrix &l, matrix &u) {
+            BBB_INSTRUMENT_SPAN(lu_decomposition, size, size, 0, 2 * size * size * size / 3, 3 * size * size * sizeof(value_t));
+            std::fill(l.raw_data(), l.raw_data() + size * size, value_t(0));
+            std::fill(u.raw_data(), u.raw_data() + size * size, value_t(0));
+            for(std::size_t i = 0; i < size; i++) l[i][i] = 1;
+
+            using acc_t = accumulator_t<value_t>;
+            for(std::size_t j = 0; j < size; j++) {
+                u[0][j] = (*this)[0][j];
+                for(std::size_t i = 1; i < j + 1; i++) {
+                    acc_t sum{0};
+                    for(std::size_t k = 0; k < i; k++) sum += acc_t(l[i][k]) * acc_t(u[k][j]);
+                    u[i][j] = value_t(acc_t((*this)[i][j]) - sum);
+                }
+                for(std::size_t i = j + 1; i < size; i++) {
+                    acc_t sum{0};
+                    for(std::size_t k = 0; k < i; k++) sum += acc_t(l[i][k]) * acc_t(u[k][j]);
+                    l[i][j] = value_t((acc_t((*this)[i][j]) - sum) / acc_t(u[j][j]));
+                }
+            }
+        }
+        
+        value_type *raw_data() { return data[0].data(); }
+        const value_type *raw_data() const { return data[0].data(); }
+        
+    private:
+        template <typename, typename> friend struct matrix_product;
+
+        template <std::size_t col_num_, typename value_t_>
+        constexpr matrix<row_num, col_num_, value_t> product(const matrix<col_num, col_num_, value_t_> &rhs) const {
+            return product(rhs, detail::is_small_matrix<row_num, col_num_, col_num>{});
+        }
+
+        template <std::size_t ... i, typename col_indices>
+        constexpr matrix(const value_type (&data)[row_num][col_num], detail::index_sequence<i ...>, col_indices j)
+        : data{{copy_row(data[i], j) ...}} {}
+
+        template <std::size_t ... j>
+        static constexpr column_type copy_row(const value_type (&row)[col_num], detail::index_sequence<j ...>) {
+            return {{row[j] ...}};
+        }
+
+        template <std::size_t i, std::size_t j, typename rhs_t, std::size_t ... k>
+        constexpr value_t product_entry(const rhs_t &rhs, detail::index_sequence<k ...>) const {
+            return detail::sum(value_t((*this)(i, k) * rhs(k, j)) ...);
+        }
+
+        template <std::size_t i, typename rhs_t, std::size_t ... j, typename inner_indices>
+        constexpr std::array<value_t, sizeof...(j)> product_row(const rhs_t &rhs, detail::index_sequence<j ...>, inner_indices k) const {
+            return {{product_entry<i, j>(rhs, k) ...}};
+        }
+
+        template <std::size_t col_num_, typename value_t_, std::size_t ... i>
+        constexpr matrix<row_num, col_num_, value_t> unrolled_product(const matrix<col_num, col_num_, value_t_> &rhs, detail::index_sequence<i ...>) const {
+            return {detail::from_rows_t{}, {{product_row<i>(rhs, detail::make_index_sequence<col_num_>{}, detail::make_index_sequence<col_num>{}) ...}}};
+        }
+
+        template <std::size_t col_num_, typename value_t_>
+        constexpr matrix<row_num, col_num_, value_t> product(const matrix<col_num, col_num_, value_t_> &rhs, std::true_type) const {
+            return unrolled_product(rhs, detail::make_index_sequence<row_num>{});
+        }
+
+        template <std::size_t col_num_, typename value_t_>
+        matrix<row_num, col_num_, value_t> product(const matrix<col_num, col_num_, value_t_> &rhs, std::false_type) const {
+            BBB_INSTRUMENT_SPAN(multiply, row_num, col_num_, col_num, 2 * row_num * col_num_ * col_num, (row_num * col_num + col_num * col_num_ + row_num * col_num_) * sizeof(value_t));
+            return multiply(rhs, detail::gemm::use_blocked<row_num, col_num_, col_num, value_t, value_t_>{});
+        }
+
+        template <std::size_t j, std::size_t ... i>
+        constexpr std::array<value_t, row_num> transposed_row(detail::index_sequence<i ...>) const {
+            return {{(*this)(i, j) ...}};
+        }
+
+        template <std::size_t ... j>
+        constexpr matrix<col_num, row_num, value_t> transposed(detail::index_sequence<j ...>) const {
+            return {detail::from_rows_t{}, {{transposed_row<j>(detail::make_index_sequence<row_num>{}) ...}}};
+        }
+
+        constexpr matrix<col_num, row_num, value_t> transposed(std::true_type) const {
+            return transposed(detail::make_index_sequence<col_num>{});
+        }
+
+        matrix<col_num, row_num, value_t> transposed(std::false_type) const {
+            BBB_INSTRUMENT_COUNT(transpose, col_num, row_num, 0, 0, 2 * row_num * col_num * sizeof(value_t));
             matrix<col_num, row_num, value_t> res;
-            for(std::size_t j = 0; j < data.size(); j++) {
-                for(std::size_t i = 0; i < data[j].size(); i++) {
+            for(std::size_t j = 0; j < row_num; j++) {
+                for(std::size_t i = 0; i < col_num; i++) {
                     res[i][j] = data[j][i];
                 }
             }
             return res;
         }
 
-        inline constexpr_14 auto trace() const
-        -> typename std::enable_if<row_num == col_num, value_type>::type
-        {
-            std::size_t size = row_num;
+        template <std::size_t ... i>
+        constexpr value_type diagonal_sum(detail::index_sequence<i ...>) const {
+            return detail::sum((*this)(i, i) ...);
+        }
+
+        constexpr value_type diagonal_sum(std::true_type) const {
+            return diagonal_sum(detail::make_index_sequence<row_num>{});
+        }
+
+        value_type diagonal_sum(std::false_type) const {
             value_type sum{0};
-            for(std::size_t i = 0; i < size; i++) sum += (*this)[i][i];
+            for(std::size_t i = 0; i < row_num; i++) sum += data[i][i];
             return sum;
         }
 
-        typename std::enable_if<row_num == col_num>::type lu_decomposition(matrix &l, matrix &u) {
-            std::size_t size = row_num;
-            l *= 0;
-            u *= 0;
-            for(std::size_t i = 0; i < size; i++) l[i][i] = 1;
+        constexpr value_type determinant_of(std::integral_constant<std::size_t, 1>) const {
+            return (*this)(0, 0);
+        }
 
-            for(std::size_t j = 0; j < size; j++) {
-                u[0][j] = (*this)[0][j];
-                for(std::size_t i = 1; i < j + 1; i++) {
-                    value_t sum{0.0};
-                    for(std::size_t k = 0; k < i; k++) sum += l[i][k] * u[k][j];
-                    u[i][j] = (*this)[i][j] - sum;
+        constexpr value_type determinant_of(std::integral_constant<std::size_t, 2>) const {
+            return (*this)(0, 0) * (*this)(1, 1) - (*this)(0, 1) * (*this)(1, 0);
+        }
+
+        constexpr value_type determinant_of(std::integral_constant<std::size_t, 3>) const {
+            return (*this)(0, 0) * ((*this)(1, 1) * (*this)(2, 2) - (*this)(1, 2) * (*this)(2, 1))
+                 - (*this)(0, 1) * ((*this)(1, 0) * (*this)(2, 2) - (*this)(1, 2) * (*this)(2, 0))
+                 + (*this)(0, 2) * ((*this)(1, 0) * (*this)(2, 1) - (*this)(1, 1) * (*this)(2, 0));
+        }
+
+        // expansion by the 2 x 2 minors of the upper (s) and lower (c) row pairs.
+        constexpr value_type determinant_of(std::integral_constant<std::size_t, 4>) const {
+            return ((*this)(0, 0) * (*this)(1, 1) - (*this)(1, 0) * (*this)(0, 1)) * ((*this)(2, 2) * (*this)(3, 3) - (*this)(3, 2) * (*this)(2, 3))
+                 - ((*this)(0, 0) * (*this)(1, 2) - (*this)(1, 0) * (*this)(0, 2)) * ((*this)(2, 1) * (*this)(3, 3) - (*this)(3, 1) * (*this)(2, 3))
+                 + ((*this)(0, 0) * (*this)(1, 3) - (*this)(1, 0) * (*this)(0, 3)) * ((*this)(2, 1) * (*this)(3, 2) - (*this)(3, 1) * (*this)(2, 2))
+                 + ((*this)(0, 1) * (*this)(1, 2) - (*this)(1, 1) * (*this)(0, 2)) * ((*this)(2, 0) * (*this)(3, 3) - (*this)(3, 0) * (*this)(2, 3))
+                 - ((*this)(0, 1) * (*this)(1, 3) - (*this)(1, 1) * (*this)(0, 3)) * ((*this)(2, 0) * (*this)(3, 2) - (*this)(3, 0) * (*this)(2, 2))
+                 + ((*this)(0, 2) * (*this)(1, 3) - (*this)(1, 2) * (*this)(0, 3)) * ((*this)(2, 0) * (*this)(3, 1) - (*this)(3, 0) * (*this)(2, 1));
+        }
+
+        constexpr_14 matrix inverse_of(std::integral_constant<std::size_t, 1>) const {
+            return {detail::from_rows_t{}, {{{{value_t(1) / (*this)(0, 0)}}}}};
+        }
+
+        constexpr_14 matrix inverse_of(std::integral_constant<std::size_t, 2>) const {
+            const value_t inv = value_t(1) / determinant_of(std::integral_constant<std::size_t, 2>{});
+            return {detail::from_rows_t{}, {{
+                {{ (*this)(1, 1) * inv, -(*this)(0, 1) * inv}},
+                {{-(*this)(1, 0) * inv,  (*this)(0, 0) * inv}}
+            }}};
+        }
+
+        constexpr_14 matrix inverse_of(std::integral_constant<std::size_t, 3>) const {
+            const matrix &a = *this;
+            const value_t c00 = a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1);
+            const value_t c01 = a(1, 2) * a(2, 0) - a(1, 0) * a(2, 2);
+            const value_t c02 = a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0);
+            const value_t inv = value_t(1) / (a(0, 0) * c00 + a(0, 1) * c01 + a(0, 2) * c02);
+            return {detail::from_rows_t{}, {{
+                {{c00 * inv, (a(0, 2) * a(2, 1) - a(0, 1) * a(2, 2)) * inv, (a(0, 1) * a(1, 2) - a(0, 2) * a(1, 1)) * inv}},
+                {{c01 * inv, (a(0, 0) * a(2, 2) - a(0, 2) * a(2, 0)) * inv, (a(0, 2) * a(1, 0) - a(0, 0) * a(1, 2)) * inv}},
+                {{c02 * inv, (a(0, 1) * a(2, 0) - a(0, 0) * a(2, 1)) * inv, (a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0)) * inv}}
+            }}};
+        }
+
+        constexpr_14 matrix inverse_of(std::integral_constant<std::size_t, 4>) const {
+            const matrix &a = *this;
+            const value_t s0 = a(0, 0) * a(1, 1) - a(1, 0) * a(0, 1);
+            const value_t s1 = a(0, 0) * a(1, 2) - a(1, 0) * a(0, 2);
+            const value_t s2 = a(0, 0) * a(1, 3) - a(1, 0) * a(0, 3);
+            const value_t s3 = a(0, 1) * a(1, 2) - a(1, 1) * a(0, 2);
+            const value_t s4 = a(0, 1) * a(1, 3) - a(1, 1) * a(0, 3);
+            const value_t s5 = a(0, 2) * a(1, 3) - a(1, 2) * a(0, 3);
+            const value_t c5 = a(2, 2) * a(3, 3) - a(3, 2) * a(2, 3);
+            const value_t c4 = a(2, 1) * a(3, 3) - a(3, 1) * a(2, 3);
+            const value_t c3 = a(2, 1) * a(3, 2) - a(3, 1) * a(2, 2);
+            const value_t c2 = a(2, 0) * a(3, 3) - a(3, 0) * a(2, 3);
+            const value_t c1 = a(2, 0) * a(3, 2) - a(3, 0) * a(2, 2);
+            const value_t c0 = a(2, 0) * a(3, 1) - a(3, 0) * a(2, 1);
+            const value_t inv = value_t(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+            return {detail::from_rows_t{}, {{
+                {{( a(1, 1) * c5 - a(1, 2) * c4 + a(1, 3) * c3) * inv, (-a(0, 1) * c5 + a(0, 2) * c4 - a(0, 3) * c3) * inv,
+                  ( a(3, 1) * s5 - a(3, 2) * s4 + a(3, 3) * s3) * inv, (-a(2, 1) * s5 + a(2, 2) * s4 - a(2, 3) * s3) * inv}},
+                {{(-a(1, 0) * c5 + a(1, 2) * c2 - a(1, 3) * c1) * inv, ( a(0, 0) * c5 - a(0, 2) * c2 + a(0, 3) * c1) * inv,
+                  (-a(3, 0) * s5 + a(3, 2) * s2 - a(3, 3) * s1) * inv, ( a(2, 0) * s5 - a(2, 2) * s2 + a(2, 3) * s1) * inv}},
+                {{( a(1, 0) * c4 - a(1, 1) * c2 + a(1, 3) * c0) * inv, (-a(0, 0) * c4 + a(0, 1) * c2 - a(0, 3) * c0) * inv,
+                  ( a(3, 0) * s4 - a(3, 1) * s2 + a(3, 3) * s0) * inv, (-a(2, 0) * s4 + a(2, 1) * s2 - a(2, 3) * s0) * inv}},
+                {{(-a(1, 0) * c3 + a(1, 1) * c1 - a(1, 2) * c0) * inv, ( a(0, 0) * c3 - a(0, 1) * c1 + a(0, 2) * c0) * inv,
+                  (-a(3, 0) * s3 + a(3, 1) * s1 - a(3, 2) * s0) * inv, ( a(2, 0) * s3 - a(2, 1) * s1 + a(2, 2) * s0) * inv}}
+            }}};
+        }
+
+        template <std::size_t col_num_, typename value_t_>
+        matrix<row_num, col_num_, value_t> multiply(const matrix<col_num, col_num_, value_t_> &rhs, std::false_type) const {
+            using acc_t = accumulator_t<value_t>;
+            matrix<row_num, col_num_, value_t> res;
+            for(std::size_t i = 0; i < row_num; i++) {
+                for(std::size_t j = 0; j < col_num_; j++) {
+                    acc_t sum{0};
+                    for(std::size_t k = 0; k < col_num; k++) {
+                        sum += acc_t(data[i][k]) * acc_t(rhs[k][j]);
+                    }
+                    res[i][j] = value_t(sum);
                 }
-                for(std::size_t i = j + 1; i < size; i++) {
-                    value_t sum{0.0};
-                    for(std::size_t k = 0; k < i; k++) sum += l[i][k] * u[k][j];
-                    l[i][j] = ((*this)[i][j] - sum) / u[j][j];
+            }
+            return res;
+        }
+        
+        template <std::size_t col_num_>
+        matrix<row_num, col_num_, value_t> multiply(const matrix<col_num, col_num_, value_t> &rhs, std::true_type) const {
+            matrix<row_num, col_num_, value_t> res;
+            std::fill(res.raw_data(), res.raw_data() + row_num * col_num_, value_t(0));
+            detail::gemm::multiply(row_num, col_num_, col_num,
+                                   raw_data(), col_num, 1,
+                                   rhs.raw_data(), col_num_, 1,
+                                   res.raw_data(), col_num_, 1);
+            return res;
+        }
+        
+        template <typename expression>
+        matrix &add_assign(const expression &e, std::false_type) {
+            const detail::operand_t<const expression &> rhs = e;
+            for(std::size_t j = 0; j < row_num; j++) {
+                for(std::size_t i = 0; i < col_num; i++) {
+                    data[j][i] += rhs(j, i);
+                }
+            }
+            return *this;
+        }
+        matrix &add_assign(const matrix &rhs, std::true_type) {
+            simd::add(raw_data(), rhs.raw_data(), row_num * col_num);
+            return *this;
+        }
+        
+        template <typename expression>
+        matrix &sub_assign(const expression &e, std::false_type) {
+            const detail::operand_t<const expression &> rhs = e;
+            for(std::size_t j = 0; j < row_num; j++) {
+                for(std::size_t i = 0; i < col_num; i++) {
+                    data[j][i] -= rhs(j, i);
+                }
+            }
+            return *this;
+        }
+        matrix &sub_assign(const matrix &rhs, std::true_type) {
+            simd::sub(raw_data(), rhs.raw_data(), row_num * col_num);
+            return *this;
+        }
+        
+        detail::storage_span span() const { return detail::span_of(raw_data(), row_num, col_num, col_num, 1); }
+
+        template <typename expression>
+        matrix &assign(const expression &rhs) {
+            static_assert(detail::extent_matches(expression::row_extent, row_num) && detail::extent_matches(expression::column_extent, col_num), "required: operands have same dimensions");
+            assert(rhs.row_size() == row_num && rhs.column_size() == col_num);
+            const detail::operand_t<const expression &> e = rhs;
+            for(std::size_t j = 0; j < row_num; j++) {
+                for(std::size_t i = 0; i < col_num; i++) {
+                    data[j][i] = e(j, i);
                 }
             }
+            return *this;
         }
     };
+
+    namespace detail {
+        // matrix and the types derived from it
+        template <typename type>
+        struct aliasing<type, typename std::enable_if<is_fixed_matrix<type>::value>::type> {
+            static bool reads(const type &m, const storage_span &destination) {
+                return conflicts(span_of(m.raw_data(), type::row_extent, type::column_extent, type::column_extent, 1), destination);
+            }
+        };
+    };
     
     template <std::size_t size, typename value_t = default_value_t>
     struct square_matrix : matrix<size, size, value_t> {
@@ -151,8 +457,11 @@ namespace bbb {
 
         square_matrix() = default;
         template <typename value_t_>
-        square_matrix(const matrix<size, size, value_t_> &m)
+        constexpr square_matrix(const matrix<size, size, value_t_> &m)
         : matrix<size, size, value_t>(m) {}
+        template <typename expression, typename std::enable_if<is_matrix_expression<expression>::value && !std::is_base_of<matrix<size, size, value_t>, expression>::value>::type * = nullptr>
+        square_matrix(const expression &e)
+        : matrix<size, size, value_t>(e) {}
         
         inline square_matrix &operator*=(const square_matrix &rhs) {
             return (*this = (*this) * rhs);
@@ -168,38 +477,44 @@ namespace bbb {
         using matrix<size, 1, value_t>::data;
         
         value_type &operator[](std::size_t index) { return data[index][0]; }
-        constexpr value_type &operator[](std::size_t index) const { return data[index][0]; }
+        constexpr const value_type &operator[](std::size_t index) const { return data[index][0]; }
         
-        constexpr_14 double dot(const row_vector &rhs) const {
-            value_type sum{0.0};
-            for(std::size_t i = 0; i < size; i++) sum += (*this)[i] * rhs[i];
-            return sum;
+        compute_t<value_type> dot(const row_vector &rhs) const {
+            return reduction::dot(this->raw_data(), rhs.raw_data(), size);
+        }
+        
+        double distance(const row_vector &rhs) const {
+            return std::sqrt(reduction::squared_distance(this->raw_data(), rhs.raw_data(), size));
+        }
+        
+        double norm() const {
+            return reduction::p_norm<2>(this->raw_data(), size);
+        }
+        
+        double p_distance(const row_vector &rhs, std::size_t p) const {
+            return reduction::p_distance(this->raw_data(), rhs.raw_data(), size, p);
         }
         
-        inline constexpr_14 double distance(const row_vector &rhs) const {
-            return ((*this) - rhs).norm();
+        template <std::size_t p>
+        double p_distance(const row_vector &rhs) const {
+            return reduction::p_distance<p>(this->raw_data(), rhs.raw_data(), size);
         }
         
-        constexpr_14 double norm() const {
-            double sum{0.0};
-            for(std::size_t i = 0; i < size; i++) sum += (*this)[i] * (*this)[i];
-            return std::sqrt(sum);
+        double p_norm(std::size_t p) const {
+            return reduction::p_norm(this->raw_data(), size, p);
         }
         
-        inline constexpr double p_distance(const row_vector &rhs, std::size_t p) const {
-            return ((*this) - rhs).p_norm(p);
+        template <std::size_t p>
+        double p_norm() const {
+            return reduction::p_norm<p>(this->raw_data(), size);
         }
         
-        constexpr_14 double p_norm(std::size_t p) const {
-            double sum{0.0};
-            for(std::size_t i = 0; i < size; i++) sum += std::pow(std::fabs((*this)[i]), p);
-            return std::pow(sum, 1.0 / p);
+        double inf_norm() const {
+            return reduction::max_abs(this->raw_data(), size);
         }
         
-        constexpr_14 double inf_norm() const {
-            double max{fabs((*this)[0])};
-            for(std::size_t i = 1; i < size; i++) max = std::max(std::fabs((*this)[i]), max);
-            return max;
+        double inf_distance(const row_vector &rhs) const {
+            return reduction::max_abs_distance(this->raw_data(), rhs.raw_data(), size);
         }
         
         inline constexpr column_vector<size, value_type> convert_to_column() const {
@@ -213,38 +528,44 @@ namespace bbb {
         using matrix<1, size, value_t>::data;
         
         value_type &operator[](std::size_t index) { return data[0][index]; }
-        constexpr value_type &operator[](std::size_t index) const { return data[0][index]; }
+        constexpr const value_type &operator[](std::size_t index) const { return data[0][index]; }
         
-        constexpr_14 value_type dot(const column_vector &rhs) const {
-            value_type sum{0.0};
-            for(std::size_t i = 0; i < size; i++) sum += (*this)[i] * rhs[i];
-            return sum;
+        compute_t<value_type> dot(const column_vector &rhs) const {
+            return reduction::dot(this->raw_data(), rhs.raw_data(), size);
+        }
+        
+        double distance(const column_vector &rhs) const {
+            return std::sqrt(reduction::squared_distance(this->raw_data(), rhs.raw_data(), size));
+        }
+        
+        double norm() const {
+            return reduction::p_norm<2>(this->raw_data(), size);
+        }
+        
+        double p_distance(const column_vector &rhs, std::size_t p) const {
+            return reduction::p_distance(this->raw_data(), rhs.raw_data(), size, p);
         }
         
-        inline constexpr double distance(const column_vector &rhs) const {
-            return ((*this) - rhs).norm();
+        template <std::size_t p>
+        double p_distance(const column_vector &rhs) const {
+            return reduction::p_distance<p>(this->raw_data(), rhs.raw_data(), size);
         }
         
-        constexpr_14 double norm() const {
-            double sum{0.0};
-            for(std::size_t i = 0; i < size; i++) sum += (*this)[i] * (*this)[i];
-            return std::sqrt(sum);
+        double p_norm(std::size_t p) const {
+            return reduction::p_norm(this->raw_data(), size, p);
         }
         
-        inline constexpr double p_distance(const column_vector &rhs, std::size_t p) const {
-            return ((*this) - rhs).p_norm(p);
+        template <std::size_t p>
+        double p_norm() const {
+            return reduction::p_norm<p>(this->raw_data(), size);
         }
         
-        constexpr_14 double p_norm(std::size_t p) const {
-            double sum{0.0};
-            for(std::size_t i = 0; i < size; i++) sum += std::pow(std::fabs((*this)[i]), p);
-            return std::pow(sum, 1.0 / p);
+        double inf_norm() const {
+            return reduction::max_abs(this->raw_data(), size);
         }
         
-        constexpr_14 double inf_norm() const {
-            double max{fabs((*this)[0])};
-            for(std::size_t i = 1; i < size; i++) max = std::max(std::fabs((*this)[i]), max);
-            return max;
+        double inf_distance(const column_vector &rhs) const {
+            return reduction::max_abs_distance(this->raw_data(), rhs.raw_data(), size);
         }
         
         inline constexpr row_vector<size, value_type> convert_to_row_vector() const {
@@ -260,11 +581,16 @@ namespace bbb {
 
 template <std::size_t row_num, std::size_t col_num, typename value_t>
 std::ostream &operator<<(std::ostream &os, const bbb::matrix<row_num, col_num, value_t> &mat) {
-    for(std::size_t j = 0; j < col_num; j++) {
-        for(std::size_t i = 0; i < row_num - 1; i++) {
+    for(std::size_t j = 0; j < row_num; j++) {
+        for(std::size_t i = 0; i < col_num - 1; i++) {
             os << mat[j][i] << ", ";
         }
-        os << mat[j][row_num - 1] << std::endl;
+        os << mat[j][col_num - 1] << std::endl;
     }
     return os;
 }
+
+template <typename lhs_t, typename rhs_t>
+std::ostream &operator<<(std::ostream &os, const bbb::matrix_product<lhs_t, rhs_t> &p) {
+    return os << p.eval();
+}
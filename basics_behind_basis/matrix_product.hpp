@@ -0,0 +1,249 @@
+//
+//  matrix_product.hpp
+//
+//  lazy products of fixed size matrices. a * b * c * x builds a tree of
+//  matrix_product nodes instead of multiplying from the left; assigning it
+//  (or eval()) multiplies the factors in the association with the fewest
+//  multiply-adds. the extents are template parameters, so the classic
+//  matrix chain recurrence runs at compile time and the chosen order is
+//  fixed in the generated code. a chain of large matrices ending in a
+//  vector becomes a sequence of matrix-vector products.
+//
+//  operands are held like those of the element-wise expressions: lvalues
+//  by reference, temporaries by value. a product is read when it is
+//  evaluated, so auto p = a * b; sees later writes to a and must not
+//  outlive a and b; assign it to a matrix to keep the value. ties keep the
+//  written order, and a product of constant matrices is folded at compile
+//  time. p(i, j) multiplies one row through the chain; transpose(), trace(),
+//  determinant(), inverse() and operator[] work on the evaluated product.
+//
+
+#pragma once
+
+#ifndef constexpr_14
+#   if 201402L <= __cplusplus
+#       define constexpr_14 constexpr
+#   else
+#       define constexpr_14
+#   endif
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+
+#include "expression.hpp"
+#include "numeric.hpp"
+
+namespace bbb {
+    namespace detail {
+        template <std::size_t row_num, std::size_t col_num, typename value_t>
+        std::true_type is_fixed_matrix_test(const matrix<row_num, col_num, value_t> *);
+        std::false_type is_fixed_matrix_test(...);
+
+        // matrix and the types derived from it (square_matrix, row_vector, ...)
+        template <typename type>
+        struct is_fixed_matrix : decltype(is_fixed_matrix_test(std::declval<typename std::decay<type>::type *>())) {};
+
+        template <typename type>
+        struct is_product_factor : std::integral_constant<bool, is_fixed_matrix<type>::value || is_matrix_product<typename std::decay<type>::type>::value> {};
+
+        namespace chain {
+            template <typename node, bool = is_matrix_product<node>::value>
+            struct factors : std::integral_constant<std::size_t, 1> {};
+            template <typename node>
+            struct factors<node, true> : std::integral_constant<std::size_t, factors<typename node::lhs_type>::value + factors<typename node::rhs_type>::value> {};
+
+            // the k-th factor of a product tree, counted from the left.
+            template <std::size_t k, typename node, bool = is_matrix_product<node>::value>
+            struct factor {
+                using type = node;
+                static constexpr const node &get(const node &n) { return n; }
+            };
+
+            template <std::size_t k, typename node>
+            struct factor<k, node, true> {
+                static constexpr std::size_t left = factors<typename node::lhs_type>::value;
+                using in_left = std::integral_constant<bool, (k < left)>;
+                using next = factor<(k < left ? k : k - left), typename std::conditional<(k < left), typename node::lhs_type, typename node::rhs_type>::type>;
+                using type = typename next::type;
+
+                static constexpr const type &get(const node &n) { return next::get(side(n, in_left{})); }
+
+            private:
+                static constexpr const typename node::lhs_type &side(const node &n, std::true_type) { return n.left(); }
+                static constexpr const typename node::rhs_type &side(const node &n, std::false_type) { return n.right(); }
+            };
+
+            // d_0, ..., d_n with factor k of extent d_k x d_k+1.
+            template <typename node, std::size_t k, bool = (k < factors<node>::value)>
+            struct extent : std::integral_constant<std::size_t, factor<k, node>::type::row_extent> {};
+            template <typename node, std::size_t k>
+            struct extent<node, k, false> : std::integral_constant<std::size_t, node::column_extent> {};
+
+            // cheapest association of the factors i ... j: its multiply-adds and the
+            // factor after which the outermost product splits. each (i, j) is one
+            // instantiation, so the recurrence is memoized by the compiler.
+            template <typename node, std::size_t i, std::size_t j, bool = (i == j)>
+            struct order {
+                static constexpr std::uint64_t cost = 0;
+                static constexpr std::size_t split = i;
+            };
+
+            template <typename node, std::size_t i, std::size_t j, std::size_t k>
+            struct split_cost : std::integral_constant<std::uint64_t,
+                order<node, i, k>::cost + order<node, k + 1, j>::cost
+                + std::uint64_t(extent<node, i>::value) * extent<node, k + 1>::value * extent<node, j + 1>::value> {};
+
+            // ties go to the later split, which is the written left to right order.
+            template <typename node, std::size_t i, std::size_t j, std::size_t k = i, bool = (k + 1 == j)>
+            struct best_split {
+                using rest = best_split<node, i, j, k + 1>;
+                static constexpr bool here = split_cost<node, i, j, k>::value < rest::cost;
+                static constexpr std::uint64_t cost = here ? split_cost<node, i, j, k>::value : rest::cost;
+                static constexpr std::size_t split = here ? k : rest::split;
+            };
+
+            template <typename node, std::size_t i, std::size_t j, std::size_t k>
+            struct best_split<node, i, j, k, true> {
+                static constexpr std::uint64_t cost = split_cost<node, i, j, k>::value;
+                static constexpr std::size_t split = k;
+            };
+
+            template <typename node, std::size_t i, std::size_t j>
+            struct order<node, i, j, false> : best_split<node, i, j> {};
+        };
+    };
+
+    template <typename lhs_t, typename rhs_t>
+    struct matrix_product : matrix_expression_tag {
+        using lhs_type = typename std::decay<lhs_t>::type;
+        using rhs_type = typename std::decay<rhs_t>::type;
+        using value_type = typename lhs_type::value_type;
+
+        static constexpr std::size_t row_extent = lhs_type::row_extent;
+        static constexpr std::size_t column_extent = rhs_type::column_extent;
+        static_assert(lhs_type::column_extent == rhs_type::row_extent, "required: inner dimensions match");
+
+        using result_type = matrix<row_extent, column_extent, value_type>;
+
+        static constexpr std::size_t factor_count = detail::chain::factors<lhs_type>::value + detail::chain::factors<rhs_type>::value;
+
+        constexpr matrix_product(lhs_t &&lhs, rhs_t &&rhs)
+        : lhs(std::forward<lhs_t>(lhs))
+        , rhs(std::forward<rhs_t>(rhs)) {}
+
+        constexpr std::size_t row_size() const { return row_extent; }
+        constexpr std::size_t column_size() const { return column_extent; }
+
+        constexpr const lhs_type &left() const { return lhs; }
+        constexpr const rhs_type &right() const { return rhs; }
+
+        // multiply-adds of the order eval() uses.
+        static constexpr std::uint64_t multiply_adds() { return detail::chain::order<matrix_product, 0, factor_count - 1>::cost; }
+
+        // the factor the outermost product splits after, counted from 0.
+        static constexpr std::size_t split() { return detail::chain::order<matrix_product, 0, factor_count - 1>::split; }
+
+        inline constexpr result_type eval() const { return evaluate<0, factor_count - 1>(*this, std::false_type{}); }
+
+        constexpr typename result_type::column_type operator[](std::size_t index) const { return eval().data[index]; }
+
+        constexpr matrix<column_extent, row_extent, value_type> transpose() const { return eval().transpose(); }
+
+        template <std::size_t size = row_extent>
+        constexpr auto trace() const
+        -> decltype(std::declval<const result_type &>().template trace<size>())
+        { return eval().template trace<size>(); }
+
+        template <std::size_t size = row_extent>
+        constexpr_14 auto determinant() const
+        -> decltype(std::declval<const result_type &>().template determinant<size>())
+        { return eval().template determinant<size>(); }
+
+        template <std::size_t size = row_extent>
+        constexpr_14 auto inverse() const
+        -> decltype(std::declval<const result_type &>().template inverse<size>())
+        { return eval().template inverse<size>(); }
+
+        value_type operator()(std::size_t i, std::size_t j) const {
+            assert(i < row_extent && j < column_extent);
+            const factor_t<0> &first = detail::chain::factor<0, matrix_product>::get(*this);
+            matrix<1, extent<1>::value, value_type> row;
+            for(std::size_t p = 0; p < extent<1>::value; p++) row(0, p) = first(i, p);
+            return entry<1>(row, j, std::integral_constant<bool, factor_count == 2>{});
+        }
+
+    private:
+        template <std::size_t k>
+        using factor_t = typename detail::chain::factor<k, matrix_product>::type;
+        template <std::size_t k>
+        using extent = detail::chain::extent<matrix_product, k>;
+        template <std::size_t i, std::size_t j>
+        using order = detail::chain::order<matrix_product, i, j>;
+
+        // factors i ... j: the factor itself or the product formed from it.
+        template <std::size_t i, std::size_t j>
+        using part_t = typename std::conditional<i == j, const factor_t<i> &, matrix<extent<i>::value, extent<j + 1>::value, typename factor_t<i>::value_type>>::type;
+
+        template <std::size_t i, std::size_t j>
+        static constexpr part_t<i, j> evaluate(const matrix_product &p, std::true_type) {
+            return detail::chain::factor<i, matrix_product>::get(p);
+        }
+
+        template <std::size_t i, std::size_t j>
+        static constexpr part_t<i, j> evaluate(const matrix_product &p, std::false_type) {
+            return evaluate<i, order<i, j>::split>(p, std::integral_constant<bool, i == order<i, j>::split>{})
+                .product(evaluate<order<i, j>::split + 1, j>(p, std::integral_constant<bool, order<i, j>::split + 1 == j>{}));
+        }
+
+        // one row of the product, carried through the factors from the left.
+        template <std::size_t k, typename row_t>
+        value_type entry(const row_t &row, std::size_t j, std::false_type) const {
+            return entry<k + 1>(row.product(detail::chain::factor<k, matrix_product>::get(*this)), j, std::integral_constant<bool, k + 2 == factor_count>{});
+        }
+
+        template <std::size_t k, typename row_t>
+        value_type entry(const row_t &row, std::size_t j, std::true_type) const {
+            using acc_t = accumulator_t<value_type>;
+            const factor_t<k> &last = detail::chain::factor<k, matrix_product>::get(*this);
+            acc_t sum{0};
+            for(std::size_t p = 0; p < extent<k>::value; p++) sum += acc_t(row(0, p)) * acc_t(last(p, j));
+            return value_type(sum);
+        }
+
+        detail::reference_or_value_t<lhs_t> lhs;
+        detail::reference_or_value_t<rhs_t> rhs;
+    };
+
+    template <typename lhs_t, typename rhs_t>
+    constexpr auto operator*(lhs_t &&lhs, rhs_t &&rhs)
+    -> typename std::enable_if<detail::is_product_factor<lhs_t>::value && detail::is_product_factor<rhs_t>::value, matrix_product<lhs_t, rhs_t>>::type
+    {
+        return {std::forward<lhs_t>(lhs), std::forward<rhs_t>(rhs)};
+    }
+
+    namespace detail {
+        // the tree chain() builds: the factors nested from the left.
+        template <typename ... factor_ts>
+        struct chain_of;
+        template <typename lhs_t, typename rhs_t>
+        struct chain_of<lhs_t, rhs_t> { using type = matrix_product<lhs_t, rhs_t>; };
+        template <typename lhs_t, typename rhs_t, typename next_t, typename ... rest_ts>
+        struct chain_of<lhs_t, rhs_t, next_t, rest_ts ...> : chain_of<matrix_product<lhs_t, rhs_t>, next_t, rest_ts ...> {};
+    };
+
+    // chain(a, b, c) is a * b * c, for factors that come as a pack.
+    template <typename lhs_t, typename rhs_t>
+    constexpr matrix_product<lhs_t, rhs_t> chain(lhs_t &&lhs, rhs_t &&rhs) {
+        static_assert(detail::is_product_factor<lhs_t>::value && detail::is_product_factor<rhs_t>::value, "required: fixed size matrices or chains");
+        return std::forward<lhs_t>(lhs) * std::forward<rhs_t>(rhs);
+    }
+
+    template <typename lhs_t, typename rhs_t, typename next_t, typename ... rest_ts>
+    constexpr typename detail::chain_of<lhs_t, rhs_t, next_t, rest_ts ...>::type chain(lhs_t &&lhs, rhs_t &&rhs, next_t &&next, rest_ts &&... rest) {
+        return chain(chain(std::forward<lhs_t>(lhs), std::forward<rhs_t>(rhs)), std::forward<next_t>(next), std::forward<rest_ts>(rest) ...);
+    }
+};
@@ -0,0 +1,170 @@
+//
+//  numeric.hpp
+//
+//  16-bit storage formats and the precision traits of the element types.
+//  half (IEEE binary16) and bfloat16 are emulated in software: they only
+//  store 16 bits and every operation converts to float, computes there and
+//  rounds back to nearest even on store. use them to halve the footprint
+//  of float data, not to compute faster.
+//
+//  numeric_traits<value_t>:
+//      compute_type      type the arithmetic is actually done in (float for 16-bit types)
+//      accumulator_type  wider type for sums over many elements
+//      epsilon()         unit roundoff of value_t as double
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace bbb {
+    namespace detail {
+        namespace numeric {
+            inline std::uint32_t bits_of(float x) {
+                std::uint32_t bits;
+                std::memcpy(&bits, &x, sizeof(bits));
+                return bits;
+            }
+
+            inline float float_of(std::uint32_t bits) {
+                float x;
+                std::memcpy(&x, &bits, sizeof(x));
+                return x;
+            }
+
+            // round to nearest even; nan stays a quiet nan, overflow goes to inf.
+            inline std::uint16_t float_to_half(float x) {
+                const std::uint32_t bits = bits_of(x);
+                const std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+                std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+                if(0x7F800000u <= magnitude) return sign | (0x7F800000u < magnitude ? 0x7E00u : 0x7C00u);
+                if(0x477FF000u <= magnitude) return sign | 0x7C00u;
+                if(magnitude < 0x38800000u) {
+                    // subnormal result: adding 0.5f lines the half mantissa up with the float one
+                    // and lets the fpu do the rounding.
+                    const float shifted = float_of(magnitude) + 0.5f;
+                    return static_cast<std::uint16_t>(sign | (bits_of(shifted) - 0x3F000000u));
+                }
+                const std::uint32_t odd = (magnitude >> 13) & 1u;
+                magnitude += 0xC8000FFFu + odd; // rebias exponent by -112, round
+                return static_cast<std::uint16_t>(sign | (magnitude >> 13));
+            }
+
+            inline float half_to_float(std::uint16_t h) {
+                const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+                const std::uint32_t exponent = (h >> 10) & 0x1Fu, mantissa = h & 0x3FFu;
+                if(exponent == 0) {
+                    const float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f; // 2^-24
+                    return sign ? -magnitude : magnitude;
+                }
+                if(exponent == 0x1Fu) return float_of(sign | 0x7F800000u | (mantissa << 13));
+                return float_of(sign | ((exponent + 112) << 23) | (mantissa << 13));
+            }
+
+            inline std::uint16_t float_to_bfloat16(float x) {
+                const std::uint32_t bits = bits_of(x);
+                if((bits & 0x7FFFFFFFu) > 0x7F800000u) return static_cast<std::uint16_t>((bits >> 16) | 0x0040u);
+                return static_cast<std::uint16_t>((bits + 0x7FFFu + ((bits >> 16) & 1u)) >> 16);
+            }
+
+            inline float bfloat16_to_float(std::uint16_t h) {
+                return float_of(static_cast<std::uint32_t>(h) << 16);
+            }
+
+            // storage and conversions shared by half and bfloat16; arithmetic goes
+            // through the implicit conversion to float.
+            template <typename derived, std::uint16_t (*encode)(float), float (*decode)(std::uint16_t)>
+            struct float16_base {
+                float16_base() = default;
+                float16_base(float x) : bits(encode(x)) {}
+
+                operator float() const { return decode(bits); }
+
+                static derived from_bits(std::uint16_t bits) {
+                    derived x;
+                    x.bits = bits;
+                    return x;
+                }
+
+                derived operator-() const { return from_bits(bits ^ 0x8000u); }
+                const derived &operator+() const { return static_cast<const derived &>(*this); }
+
+                derived &operator+=(float x) { return assign(decode(bits) + x); }
+                derived &operator-=(float x) { return assign(decode(bits) - x); }
+                derived &operator*=(float x) { return assign(decode(bits) * x); }
+                derived &operator/=(float x) { return assign(decode(bits) / x); }
+
+                std::uint16_t bits;
+
+            private:
+                derived &assign(float x) {
+                    bits = encode(x);
+                    return static_cast<derived &>(*this);
+                }
+            };
+        };
+    };
+
+    // IEEE 754 binary16: 5 exponent bits, 10 mantissa bits, max 65504.
+    struct half : detail::numeric::float16_base<half, detail::numeric::float_to_half, detail::numeric::half_to_float> {
+        using float16_base::float16_base;
+        half() = default;
+    };
+
+    // upper half of a float: float range, 7 mantissa bits.
+    struct bfloat16 : detail::numeric::float16_base<bfloat16, detail::numeric::float_to_bfloat16, detail::numeric::bfloat16_to_float> {
+        using float16_base::float16_base;
+        bfloat16() = default;
+    };
+
+    template <typename value_t>
+    struct is_float16 : std::integral_constant<bool, std::is_same<value_t, half>::value || std::is_same<value_t, bfloat16>::value> {};
+
+    // element types accepted by vec, matrix and the kernels.
+    template <typename value_t>
+    struct is_numeric : std::integral_constant<bool, std::is_arithmetic<value_t>::value || is_float16<value_t>::value> {};
+
+    template <typename value_t>
+    struct numeric_traits {
+        using compute_type = value_t;
+        using accumulator_type = value_t;
+        static constexpr double epsilon() { return std::numeric_limits<value_t>::epsilon(); }
+    };
+
+    template <>
+    struct numeric_traits<float> {
+        using compute_type = float;
+        using accumulator_type = double;
+        static constexpr double epsilon() { return std::numeric_limits<float>::epsilon(); }
+    };
+
+    template <>
+    struct numeric_traits<half> {
+        using compute_type = float;
+        using accumulator_type = float;
+        static constexpr double epsilon() { return 1.0 / 1024.0; }
+    };
+
+    template <>
+    struct numeric_traits<bfloat16> {
+        using compute_type = float;
+        using accumulator_type = float;
+        static constexpr double epsilon() { return 1.0 / 128.0; }
+    };
+
+    template <typename value_t>
+    using compute_t = typename numeric_traits<value_t>::compute_type;
+
+    template <typename value_t>
+    using accumulator_t = typename numeric_traits<value_t>::accumulator_type;
+
+    // out[i] = in[i] converted through the compute type, e.g. double -> half or half -> float.
+    template <typename src_t, typename dst_t>
+    inline void convert(const src_t *in, dst_t *out, std::size_t n) {
+        for(std::size_t i = 0; i < n; i++) out[i] = static_cast<dst_t>(static_cast<compute_t<src_t>>(in[i]));
+    }
+};
@@ -0,0 +1,106 @@
+//
+//  pool_allocator.hpp
+//
+//  memory_pool keeps freed blocks in per size class free lists, so a loop
+//  that builds and drops the same sized matrices stops touching the heap
+//  after its first iteration. pool_allocator<T> is the allocator adaptor
+//  for containers. a pool is not thread safe: use one per thread.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <array>
+#include <vector>
+#include <limits>
+
+#include "aligned_allocator.hpp"
+
+namespace bbb {
+    struct memory_pool {
+        memory_pool() = default;
+        memory_pool(const memory_pool &) = delete;
+        memory_pool &operator=(const memory_pool &) = delete;
+        ~memory_pool() { release(); }
+
+        // size classes are powers of two starting at one cache line.
+        void *allocate(std::size_t bytes) {
+            const std::size_t index = size_class(bytes);
+            std::vector<void *> &free_list = free_lists[index];
+            if(!free_list.empty()) {
+                void *block = free_list.back();
+                free_list.pop_back();
+                return block;
+            }
+            void *block = upstream.allocate(class_size(index));
+            blocks.push_back(block);
+            return block;
+        }
+
+        void deallocate(void *block, std::size_t bytes) {
+            if(block) free_lists[size_class(bytes)].push_back(block);
+        }
+
+        // returns every block to the system; outstanding allocations become invalid.
+        void release() {
+            for(auto &free_list : free_lists) free_list.clear();
+            for(void *block : blocks) upstream.deallocate(static_cast<unsigned char *>(block), 0);
+            blocks.clear();
+        }
+
+        std::size_t block_count() const { return blocks.size(); }
+
+    private:
+        static constexpr std::size_t class_num = std::numeric_limits<std::size_t>::digits;
+
+        // the highest power of two; past it class_size would shift out to 0.
+        static constexpr std::size_t largest_class_size = std::numeric_limits<std::size_t>::max() / 2 + 1;
+
+        static std::size_t size_class(std::size_t bytes) {
+            if(largest_class_size < bytes) throw std::bad_alloc();
+            std::size_t index = 0;
+            while(class_size(index) < bytes) index++;
+            return index;
+        }
+        static std::size_t class_size(std::size_t index) { return cache_line_size << index; }
+
+        aligned_allocator<unsigned char> upstream;
+        std::array<std::vector<void *>, class_num> free_lists;
+        std::vector<void *> blocks;
+    };
+
+    template <typename value_t>
+    struct pool_allocator {
+        using value_type = value_t;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        template <typename other_t>
+        struct rebind { using other = pool_allocator<other_t>; };
+
+        pool_allocator(memory_pool &pool)
+        : pool(&pool) {}
+        template <typename other_t>
+        pool_allocator(const pool_allocator<other_t> &other)
+        : pool(other.pool) {}
+
+        value_t *allocate(std::size_t n) {
+            if(std::numeric_limits<std::size_t>::max() / sizeof(value_t) < n) throw std::bad_alloc();
+            return static_cast<value_t *>(pool->allocate(n * sizeof(value_t)));
+        }
+        void deallocate(value_t *p, std::size_t n) { pool->deallocate(p, n * sizeof(value_t)); }
+
+        template <typename other_t>
+        bool operator==(const pool_allocator<other_t> &rhs) const { return pool == rhs.pool; }
+        template <typename other_t>
+        bool operator!=(const pool_allocator<other_t> &rhs) const { return pool != rhs.pool; }
+
+    private:
+        template <typename other_t>
+        friend struct pool_allocator;
+        memory_pool *pool;
+    };
+};
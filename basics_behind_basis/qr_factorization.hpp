@@ -0,0 +1,331 @@
+//
+//  qr_factorization.hpp
+//
+//  A = Q R by Householder reflections for m x n A with m >= n: the
+//  least squares solution of A x = b, and a stable solve of square
+//  systems where LU would need pivoting.
+//
+//  R is kept on and above the diagonal, the reflector vectors v (unit
+//  first entry implied) below it. the reflectors of each block of columns
+//  are combined in compact WY form, I - V T V^T with T upper triangular,
+//  so the trailing update of the factorization and Q^T b are two gemms
+//  and a small triangular product per block instead of one rank one
+//  update per column. factorize(execution::par, a) splits those gemms
+//  over the pool.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "numeric.hpp"
+#include "matrix.hpp"
+#include "dynamic_matrix.hpp"
+#include "lu_factorization.hpp"
+#include "gemm.hpp"
+#include "thread_pool.hpp"
+#include "instrumentation.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace qr {
+            // columns of one block of reflectors.
+            constexpr std::size_t block = 32;
+
+            // H = I - tau v v^T with v_0 = 1 maps x (len entries, stride apart) onto beta e_0;
+            // x_0 becomes beta and x_1... become v_1.... tau is 0 when x is already along e_0.
+            template <typename value_t>
+            value_t make_reflector(std::size_t len, value_t *x, std::size_t stride) {
+                using acc_t = accumulator_t<value_t>;
+                acc_t tail{0};
+                for(std::size_t i = 1; i < len; i++) tail += acc_t(x[i * stride]) * acc_t(x[i * stride]);
+                if(tail == acc_t(0)) return value_t(0);
+                const acc_t alpha = acc_t(x[0]);
+                const acc_t norm = std::sqrt(alpha * alpha + tail);
+                const acc_t beta = alpha < acc_t(0) ? norm : -norm;
+                const acc_t scale = acc_t(1) / (alpha - beta);
+                for(std::size_t i = 1; i < len; i++) x[i * stride] = value_t(acc_t(x[i * stride]) * scale);
+                x[0] = value_t(beta);
+                return value_t((beta - alpha) / beta);
+            }
+
+            // V of the nb reflectors stored below the diagonal of the rows x nb panel at a,
+            // as an explicit rows x nb row major matrix with its unit diagonal and zeros.
+            template <typename value_t>
+            void unpack(std::size_t rows, std::size_t nb, const value_t *a, std::size_t ld, value_t *v) {
+                for(std::size_t r = 0; r < rows; r++) {
+                    for(std::size_t i = 0; i < nb; i++) v[r * nb + i] = r < i ? value_t(0) : r == i ? value_t(1) : a[r * ld + i];
+                }
+            }
+
+            // C (rows x cols, row stride ldc) = (I - V T V^T)^T C when transpose, else (I - V T V^T) C.
+            // V is rows x nb as unpack() makes it, T nb x nb upper triangular with row stride ldt.
+            // w is scratch owned by the caller, live across the gemm, where a waiting thread can
+            // run another factorization.
+            template <typename value_t>
+            void apply_block(thread_pool *pool, bool transpose, std::size_t rows, std::size_t nb, const value_t *v,
+                             const value_t *t, std::size_t ldt, value_t *c, std::size_t ldc, std::size_t cols, std::vector<value_t> &w)
+            {
+                w.assign(nb * cols, value_t(0));
+                const bool small = rows * cols * nb < gemm::threshold;
+
+                // W = V^T C
+                if(small) {
+                    for(std::size_t r = 0; r < rows; r++) {
+                        const value_t *c_r = c + r * ldc;
+                        for(std::size_t i = 0; i < nb && i <= r; i++) {
+                            const value_t f = v[r * nb + i];
+                            value_t *w_i = w.data() + i * cols;
+                            for(std::size_t j = 0; j < cols; j++) w_i[j] += f * c_r[j];
+                        }
+                    }
+                } else {
+                    gemm::multiply(pool, nb, cols, rows, v, 1, nb, c, ldc, 1, w.data(), cols, 1);
+                }
+
+                // W = T^T W or T W, in place: each row only reads rows not yet overwritten.
+                if(transpose) {
+                    for(std::size_t i = nb; i-- > 0;) {
+                        value_t *w_i = w.data() + i * cols;
+                        for(std::size_t j = 0; j < cols; j++) w_i[j] *= t[i * ldt + i];
+                        for(std::size_t p = 0; p < i; p++) {
+                            const value_t f = t[p * ldt + i];
+                            const value_t *w_p = w.data() + p * cols;
+                            for(std::size_t j = 0; j < cols; j++) w_i[j] += f * w_p[j];
+                        }
+                    }
+                } else {
+                    for(std::size_t i = 0; i < nb; i++) {
+                        value_t *w_i = w.data() + i * cols;
+                        for(std::size_t j = 0; j < cols; j++) w_i[j] *= t[i * ldt + i];
+                        for(std::size_t p = i + 1; p < nb; p++) {
+                            const value_t f = t[i * ldt + p];
+                            const value_t *w_p = w.data() + p * cols;
+                            for(std::size_t j = 0; j < cols; j++) w_i[j] += f * w_p[j];
+                        }
+                    }
+                }
+
+                // C -= V W
+                if(small) {
+                    for(std::size_t r = 0; r < rows; r++) {
+                        value_t *c_r = c + r * ldc;
+                        for(std::size_t i = 0; i < nb && i <= r; i++) {
+                            const value_t f = v[r * nb + i];
+                            const value_t *w_i = w.data() + i * cols;
+                            for(std::size_t j = 0; j < cols; j++) c_r[j] -= f * w_i[j];
+                        }
+                    }
+                } else {
+                    gemm::multiply(pool, rows, cols, nb, v, nb, 1, w.data(), cols, 1, c, ldc, 1, value_t(-1));
+                }
+            }
+
+            // reflectors of columns [k0, k0 + nb) over rows [k0, m), applied to the rest of the
+            // panel one at a time, then the T of the block (row stride ldt, its diagonal is tau).
+            template <typename value_t>
+            void factor_panel(std::size_t m, value_t *a, std::size_t ld, std::size_t k0, std::size_t nb, value_t *t, std::size_t ldt, std::vector<value_t> &w) {
+                using acc_t = accumulator_t<value_t>;
+                w.resize(nb);
+                for(std::size_t j = 0; j < nb; j++) {
+                    const std::size_t col = k0 + j;
+                    value_t *a_jj = a + col * ld + col;
+                    const value_t tau = make_reflector(m - col, a_jj, ld);
+                    t[j * ldt + j] = tau;
+                    if(tau == value_t(0)) continue;
+                    // w = v^T A[col:m, col + 1:k0 + nb], A -= tau v w^T
+                    const std::size_t width = nb - j - 1;
+                    for(std::size_t c = 0; c < width; c++) w[c] = a_jj[c + 1];
+                    for(std::size_t r = col + 1; r < m; r++) {
+                        const value_t *row = a + r * ld + col;
+                        for(std::size_t c = 0; c < width; c++) w[c] += row[0] * row[c + 1];
+                    }
+                    for(std::size_t c = 0; c < width; c++) a_jj[c + 1] -= tau * w[c];
+                    for(std::size_t r = col + 1; r < m; r++) {
+                        value_t *row = a + r * ld + col;
+                        const value_t f = tau * row[0];
+                        for(std::size_t c = 0; c < width; c++) row[c + 1] -= f * w[c];
+                    }
+                }
+
+                // T[0:j, j] = -tau_j T[0:j, 0:j] V[:, 0:j]^T v_j
+                for(std::size_t j = 1; j < nb; j++) {
+                    const std::size_t col = k0 + j;
+                    for(std::size_t i = 0; i < j; i++) {
+                        acc_t z = acc_t(a[col * ld + k0 + i]);
+                        for(std::size_t r = col + 1; r < m; r++) z += acc_t(a[r * ld + k0 + i]) * acc_t(a[r * ld + col]);
+                        w[i] = value_t(z);
+                    }
+                    const value_t tau = t[j * ldt + j];
+                    for(std::size_t i = 0; i < j; i++) {
+                        acc_t sum{0};
+                        for(std::size_t p = i; p < j; p++) sum += acc_t(t[i * ldt + p]) * acc_t(w[p]);
+                        t[i * ldt + j] = value_t(-acc_t(tau) * sum);
+                    }
+                    for(std::size_t i = j + 1; i < nb; i++) t[i * ldt + j] = value_t(0);
+                }
+                for(std::size_t i = 1; i < nb; i++) t[i * ldt] = value_t(0);
+            }
+
+            // m x n A at a is overwritten by R and the reflectors; t (n x ldt) receives the T
+            // of each block of ldt columns at its rows. false if R has a zero on its diagonal.
+            template <typename value_t>
+            bool factor(std::size_t m, std::size_t n, value_t *a, std::size_t ld, value_t *t, std::size_t ldt, thread_pool *pool = nullptr) {
+                std::vector<value_t> v, w;
+                for(std::size_t k0 = 0; k0 < n; k0 += ldt) {
+                    const std::size_t nb = std::min(ldt, n - k0), rest = k0 + nb;
+                    factor_panel(m, a, ld, k0, nb, t + k0 * ldt, ldt, w);
+                    if(rest == n) break;
+                    v.resize((m - k0) * nb);
+                    unpack(m - k0, nb, a + k0 * ld + k0, ld, v.data());
+                    apply_block(pool, true, m - k0, nb, v.data(), t + k0 * ldt, ldt, a + k0 * ld + rest, ld, n - rest, w);
+                }
+                bool full_rank = true;
+                for(std::size_t i = 0; i < n; i++) full_rank = full_rank && a[i * ld + i] != value_t(0);
+                return full_rank;
+            }
+
+            // b (m x nrhs, row stride ldb) = Q^T b when transpose, else Q b.
+            template <typename value_t>
+            void apply_q(bool transpose, std::size_t m, std::size_t n, const value_t *a, std::size_t ld, const value_t *t, std::size_t ldt,
+                         value_t *b, std::size_t ldb, std::size_t nrhs)
+            {
+                std::vector<value_t> v, w;
+                const std::size_t block_num = (n + ldt - 1) / ldt;
+                for(std::size_t s = 0; s < block_num; s++) {
+                    const std::size_t k0 = (transpose ? s : block_num - 1 - s) * ldt, nb = std::min(ldt, n - k0);
+                    v.resize((m - k0) * nb);
+                    unpack(m - k0, nb, a + k0 * ld + k0, ld, v.data());
+                    apply_block<value_t>(nullptr, transpose, m - k0, nb, v.data(), t + k0 * ldt, ldt, b + k0 * ldb, ldb, nrhs, w);
+                }
+            }
+
+            // the first n rows of b (row stride ldb) are overwritten by R^-1 b.
+            template <typename value_t>
+            void substitute(std::size_t n, const value_t *a, std::size_t ld, value_t *b, std::size_t ldb, std::size_t nrhs) {
+                for(std::size_t i = n; i-- > 0;) {
+                    value_t *b_i = b + i * ldb;
+                    const value_t *row_i = a + i * ld;
+                    for(std::size_t k = i + 1; k < n; k++) {
+                        const value_t r = row_i[k];
+                        const value_t *b_k = b + k * ldb;
+                        for(std::size_t j = 0; j < nrhs; j++) b_i[j] -= r * b_k[j];
+                    }
+                    const value_t inverse = value_t(1) / row_i[i];
+                    for(std::size_t j = 0; j < nrhs; j++) b_i[j] *= inverse;
+                }
+            }
+        };
+
+        template <typename matrix_type>
+        struct is_fixed_size : std::integral_constant<bool, matrix_type::row_extent != dynamic_extent> {};
+    };
+
+    template <typename matrix_type>
+    struct qr_factorization {
+        using value_type = typename matrix_type::value_type;
+
+        qr_factorization() = default;
+        explicit qr_factorization(const matrix_type &a) { factorize(a); }
+        template <typename policy, typename std::enable_if<execution::is_execution_policy<policy>::value>::type * = nullptr>
+        qr_factorization(const policy &p, const matrix_type &a) { factorize(p, a); }
+
+        // reuses the storage of a previous factorization when the size matches.
+        qr_factorization &factorize(const matrix_type &a) {
+            return factorize(execution::seq, a);
+        }
+
+        template <typename policy>
+        auto factorize(const policy &p, const matrix_type &a)
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, qr_factorization &>::type
+        {
+            const std::size_t m = a.row_size(), n = a.column_size();
+            assert(n <= m);
+            BBB_INSTRUMENT_SPAN(qr_decomposition, m, n, 0, 2 * m * n * n - 2 * n * n * n / 3, 2 * m * n * sizeof(value_type));
+            qr = a;
+            ldt = std::max<std::size_t>(1, std::min(detail::qr::block, n));
+            t.resize(n * ldt);
+            full_rank = detail::qr::factor(m, n, detail::storage_of(qr), detail::stride_of(qr), t.data(), ldt, execution::pool_of(p));
+            return *this;
+        }
+
+        std::size_t row_size() const { return qr.row_size(); }
+        std::size_t column_size() const { return qr.column_size(); }
+        // false if R has a zero on its diagonal; solve needs a full rank A.
+        bool is_full_rank() const { return full_rank; }
+
+        // R on and above the diagonal, the reflectors below it.
+        const matrix_type &packed() const { return qr; }
+
+        // the first n columns of Q, with the shape of A.
+        matrix_type thin_q() const {
+            matrix_type q = qr;
+            const std::size_t m = row_size(), n = column_size();
+            value_type *data = detail::storage_of(q);
+            const std::size_t ld = detail::stride_of(q);
+            for(std::size_t i = 0; i < m; i++) {
+                for(std::size_t j = 0; j < n; j++) data[i * ld + j] = value_type(i == j);
+            }
+            detail::qr::apply_q(false, m, n, detail::storage_of(qr), detail::stride_of(qr), t.data(), ldt, data, ld, n);
+            return q;
+        }
+
+        // the x minimizing |A x - b|: a std::vector of m entries gives one of n, an m x k
+        // matrix an n x k one.
+        template <typename allocator>
+        std::vector<value_type, allocator> solve(const std::vector<value_type, allocator> &b) const {
+            assert(b.size() == row_size());
+            std::vector<value_type, allocator> x = b;
+            solve_in_place(x.data(), 1, 1);
+            x.resize(column_size());
+            return x;
+        }
+
+        template <typename allocator>
+        dynamic_matrix<value_type, allocator> solve(const dynamic_matrix<value_type, allocator> &b) const {
+            assert(b.row_size() == row_size());
+            dynamic_matrix<value_type, allocator> x = b;
+            solve_in_place(x.data(), x.leading_dimension(), x.column_size());
+            x.resize(column_size(), x.column_size());
+            return x;
+        }
+
+        template <std::size_t row_num, std::size_t col_num, typename fixed = matrix_type>
+        auto solve(const matrix<row_num, col_num, value_type> &b) const
+        -> typename std::enable_if<detail::is_fixed_size<fixed>::value, matrix<fixed::column_extent, col_num, value_type>>::type
+        {
+            static_assert(row_num == matrix_type::row_extent, "required: one row of b per row of A");
+            matrix<row_num, col_num, value_type> work = b;
+            solve_in_place(work.raw_data(), col_num, col_num);
+            matrix<fixed::column_extent, col_num, value_type> x;
+            std::copy(work.raw_data(), work.raw_data() + fixed::column_extent * col_num, x.raw_data());
+            return x;
+        }
+
+        // m x nrhs block with row stride ldb: its first n rows are overwritten by the
+        // solution, the remaining m - n rows by the components of the residual.
+        void solve_in_place(value_type *b, std::size_t ldb, std::size_t nrhs) const {
+            assert(full_rank);
+            const std::size_t m = row_size(), n = column_size();
+            BBB_INSTRUMENT_SPAN(qr_solve, m, n, nrhs, (4 * m * n - n * n) * nrhs, (m * n + 2 * m * nrhs) * sizeof(value_type));
+            detail::qr::apply_q(true, m, n, detail::storage_of(qr), detail::stride_of(qr), t.data(), ldt, b, ldb, nrhs);
+            detail::qr::substitute(n, detail::storage_of(qr), detail::stride_of(qr), b, ldb, nrhs);
+        }
+
+    private:
+        matrix_type qr;
+        std::vector<value_type> t;
+        std::size_t ldt{0};
+        bool full_rank{false};
+    };
+
+    template <typename matrix_type>
+    inline qr_factorization<matrix_type> make_qr_factorization(const matrix_type &a) {
+        return qr_factorization<matrix_type>(a);
+    }
+};
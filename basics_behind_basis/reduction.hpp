@@ -0,0 +1,223 @@
+//
+//  reduction.hpp
+//
+//  fused norm / distance reductions over raw arrays. distances read both
+//  operands directly instead of building a difference temporary, and every
+//  loop keeps four partial sums so it pipelines and vectorizes. p = 2 goes
+//  through the dispatched simd kernels; other integer p use repeated
+//  multiplies, and only a run time p outside 1..3 falls back to std::pow.
+//  sums are kept in accumulator_t<value_t>: the simd kernels widen float
+//  lanes to double before the fma, and the other loops widen float and
+//  16-bit data element by element.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
+
+#include "simd.hpp"
+#include "numeric.hpp"
+#include "instrumentation.hpp"
+
+namespace bbb {
+    namespace reduction {
+        namespace detail {
+            template <std::size_t p, typename value_t>
+            struct power {
+                static value_t of(value_t x) { return x * power<p - 1, value_t>::of(x); }
+            };
+            template <typename value_t>
+            struct power<1, value_t> {
+                static value_t of(value_t x) { return x; }
+            };
+
+            // |x|^p with the abs skipped for even p
+            template <std::size_t p, typename value_t>
+            inline value_t abs_power(value_t x) {
+                return power<p, value_t>::of(p % 2 ? std::abs(x) : x);
+            }
+
+            template <std::size_t p, typename acc_t, typename load_t>
+            inline acc_t sum(std::size_t n, load_t load) {
+                acc_t acc[4] = {};
+                std::size_t i = 0;
+                for(; i < n / 4 * 4; i += 4) {
+                    acc[0] += abs_power<p>(load(i + 0));
+                    acc[1] += abs_power<p>(load(i + 1));
+                    acc[2] += abs_power<p>(load(i + 2));
+                    acc[3] += abs_power<p>(load(i + 3));
+                }
+                for(; i < n; i++) acc[0] += abs_power<p>(load(i));
+                return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            }
+
+            template <typename value_t>
+            inline accumulator_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n, std::true_type) {
+                return simd::dot(a, b, n);
+            }
+            template <typename value_t>
+            inline accumulator_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n, std::false_type) {
+                using acc_t = accumulator_t<value_t>;
+                acc_t acc[4] = {};
+                std::size_t i = 0;
+                for(; i < n / 4 * 4; i += 4) {
+                    acc[0] += acc_t(a[i + 0]) * acc_t(b[i + 0]);
+                    acc[1] += acc_t(a[i + 1]) * acc_t(b[i + 1]);
+                    acc[2] += acc_t(a[i + 2]) * acc_t(b[i + 2]);
+                    acc[3] += acc_t(a[i + 3]) * acc_t(b[i + 3]);
+                }
+                for(; i < n; i++) acc[0] += acc_t(a[i]) * acc_t(b[i]);
+                return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            }
+
+            template <typename value_t>
+            inline accumulator_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n, std::true_type) {
+                return simd::squared_distance(a, b, n);
+            }
+            template <typename value_t>
+            inline accumulator_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n, std::false_type) {
+                using acc_t = accumulator_t<value_t>;
+                return sum<2, acc_t>(n, [a, b](std::size_t i) { return acc_t(a[i]) - acc_t(b[i]); });
+            }
+        };
+
+        // sum of a[i] * b[i]; float / double use the simd kernels, other types are widened first.
+        // both paths sum in accumulator_t<value_t>, double for float.
+        template <typename value_t>
+        inline accumulator_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n) {
+            BBB_INSTRUMENT_COUNT(dot, n, 1, 0, 2 * n, 2 * n * sizeof(value_t));
+            return detail::dot(a, b, n, simd::is_dispatchable<value_t>{});
+        }
+
+        // sum of (a[i] - b[i])^2, dispatched like dot.
+        template <typename value_t>
+        inline accumulator_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n) {
+            BBB_INSTRUMENT_COUNT(distance, n, 1, 0, 3 * n, 2 * n * sizeof(value_t));
+            return detail::squared_distance(a, b, n, simd::is_dispatchable<value_t>{});
+        }
+
+        namespace detail {
+            template <std::size_t p, typename value_t>
+            inline accumulator_t<value_t> power_sum(const value_t *a, std::size_t n, std::integral_constant<bool, false>) {
+                using acc_t = accumulator_t<value_t>;
+                return sum<p, acc_t>(n, [a](std::size_t i) { return acc_t(a[i]); });
+            }
+            template <std::size_t p, typename value_t>
+            inline accumulator_t<value_t> power_sum(const value_t *a, std::size_t n, std::integral_constant<bool, true>) {
+                return dot(a, a, n, simd::is_dispatchable<value_t>{});
+            }
+
+            template <std::size_t p, typename value_t>
+            inline accumulator_t<value_t> power_distance_sum(const value_t *a, const value_t *b, std::size_t n, std::integral_constant<bool, false>) {
+                using acc_t = accumulator_t<value_t>;
+                return sum<p, acc_t>(n, [a, b](std::size_t i) { return acc_t(a[i]) - acc_t(b[i]); });
+            }
+            template <std::size_t p, typename value_t>
+            inline accumulator_t<value_t> power_distance_sum(const value_t *a, const value_t *b, std::size_t n, std::integral_constant<bool, true>) {
+                return squared_distance(a, b, n, simd::is_dispatchable<value_t>{});
+            }
+
+            template <std::size_t p>
+            inline double root(double x) { return std::pow(x, 1.0 / p); }
+            template <>
+            inline double root<1>(double x) { return x; }
+            template <>
+            inline double root<2>(double x) { return std::sqrt(x); }
+            template <>
+            inline double root<3>(double x) { return std::cbrt(x); }
+        };
+
+        // sum of |a[i]|^p
+        template <std::size_t p, typename value_t>
+        inline accumulator_t<value_t> power_sum(const value_t *a, std::size_t n) {
+            static_assert(0 < p, "required: p is positive");
+            BBB_INSTRUMENT_COUNT(norm, n, 1, 0, p * n, n * sizeof(value_t));
+            return detail::power_sum<p>(a, n, std::integral_constant<bool, p == 2>{});
+        }
+
+        // sum of |a[i] - b[i]|^p
+        template <std::size_t p, typename value_t>
+        inline accumulator_t<value_t> power_distance_sum(const value_t *a, const value_t *b, std::size_t n) {
+            static_assert(0 < p, "required: p is positive");
+            BBB_INSTRUMENT_COUNT(distance, n, 1, 0, (p + 1) * n, 2 * n * sizeof(value_t));
+            return detail::power_distance_sum<p>(a, b, n, std::integral_constant<bool, p == 2>{});
+        }
+
+        template <std::size_t p, typename value_t>
+        inline double p_norm(const value_t *a, std::size_t n) {
+            return detail::root<p>(power_sum<p>(a, n));
+        }
+
+        template <std::size_t p, typename value_t>
+        inline double p_distance(const value_t *a, const value_t *b, std::size_t n) {
+            return detail::root<p>(power_distance_sum<p>(a, b, n));
+        }
+
+        // run time p: 1, 2 and 3 take the multiply paths.
+        template <typename value_t>
+        inline double p_norm(const value_t *a, std::size_t n, std::size_t p) {
+            switch(p) {
+                case 1: return p_norm<1>(a, n);
+                case 2: return p_norm<2>(a, n);
+                case 3: return p_norm<3>(a, n);
+                default: break;
+            }
+            BBB_INSTRUMENT_COUNT(norm, n, 1, 0, 2 * n, n * sizeof(value_t));
+            double acc[4] = {};
+            std::size_t i = 0;
+            for(; i < n / 4 * 4; i += 4) {
+                for(std::size_t k = 0; k < 4; k++) acc[k] += std::pow(std::fabs(double(a[i + k])), double(p));
+            }
+            for(; i < n; i++) acc[0] += std::pow(std::fabs(double(a[i])), double(p));
+            return std::pow((acc[0] + acc[1]) + (acc[2] + acc[3]), 1.0 / p);
+        }
+
+        template <typename value_t>
+        inline double p_distance(const value_t *a, const value_t *b, std::size_t n, std::size_t p) {
+            switch(p) {
+                case 1: return p_distance<1>(a, b, n);
+                case 2: return p_distance<2>(a, b, n);
+                case 3: return p_distance<3>(a, b, n);
+                default: break;
+            }
+            BBB_INSTRUMENT_COUNT(distance, n, 1, 0, 3 * n, 2 * n * sizeof(value_t));
+            double acc[4] = {};
+            std::size_t i = 0;
+            for(; i < n / 4 * 4; i += 4) {
+                for(std::size_t k = 0; k < 4; k++) acc[k] += std::pow(std::fabs(double(a[i + k] - b[i + k])), double(p));
+            }
+            for(; i < n; i++) acc[0] += std::pow(std::fabs(double(a[i] - b[i])), double(p));
+            return std::pow((acc[0] + acc[1]) + (acc[2] + acc[3]), 1.0 / p);
+        }
+
+        // max of |a[i]|
+        template <typename value_t>
+        inline compute_t<value_t> max_abs(const value_t *a, std::size_t n) {
+            BBB_INSTRUMENT_COUNT(norm, n, 1, 0, n, n * sizeof(value_t));
+            compute_t<value_t> acc[4] = {};
+            std::size_t i = 0;
+            for(; i < n / 4 * 4; i += 4) {
+                for(std::size_t k = 0; k < 4; k++) acc[k] = std::max<compute_t<value_t>>(acc[k], std::abs(a[i + k]));
+            }
+            for(; i < n; i++) acc[0] = std::max<compute_t<value_t>>(acc[0], std::abs(a[i]));
+            return std::max(std::max(acc[0], acc[1]), std::max(acc[2], acc[3]));
+        }
+
+        // max of |a[i] - b[i]|
+        template <typename value_t>
+        inline compute_t<value_t> max_abs_distance(const value_t *a, const value_t *b, std::size_t n) {
+            BBB_INSTRUMENT_COUNT(distance, n, 1, 0, 2 * n, 2 * n * sizeof(value_t));
+            compute_t<value_t> acc[4] = {};
+            std::size_t i = 0;
+            for(; i < n / 4 * 4; i += 4) {
+                for(std::size_t k = 0; k < 4; k++) acc[k] = std::max<compute_t<value_t>>(acc[k], std::abs(a[i + k] - b[i + k]));
+            }
+            for(; i < n; i++) acc[0] = std::max<compute_t<value_t>>(acc[0], std::abs(a[i] - b[i]));
+            return std::max(std::max(acc[0], acc[1]), std::max(acc[2], acc[3]));
+        }
+    };
+};
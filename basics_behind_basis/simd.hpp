@@ -0,0 +1,338 @@
+//
+//  simd.hpp
+//
+//  element-wise kernels for float / double with SSE2, AVX2 and AVX-512
+//  implementations. the widest instruction set supported by the running
+//  cpu is picked once at first use, so one binary runs on any x86-64.
+//  define BBB_DISABLE_SIMD to always use the scalar loops.
+//  dot and squared_distance of float convert every lane to double before
+//  the fma, so float data is stored narrow but summed in double.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#if !defined(BBB_DISABLE_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#   define BBB_SIMD_X86 1
+#   include <immintrin.h>
+#else
+#   define BBB_SIMD_X86 0
+#endif
+
+namespace bbb {
+    namespace simd {
+        enum class instruction_set {
+            scalar,
+            sse2,
+            avx2,
+            avx512
+        };
+
+        // arrays shorter than this stay on the inlined scalar loop,
+        // the indirect call is not worth it for vec<3> and friends.
+        constexpr std::size_t threshold = 16;
+
+        template <typename value_t>
+        struct is_dispatchable : std::integral_constant<bool, std::is_same<value_t, float>::value || std::is_same<value_t, double>::value> {};
+
+        // result and accumulator of dot / squared_distance
+        template <typename value_t>
+        using sum_t = typename std::conditional<is_dispatchable<value_t>::value, double, value_t>::type;
+
+        namespace scalar {
+            template <typename value_t>
+            inline void add(value_t *dst, const value_t *src, std::size_t n) {
+                for(std::size_t i = 0; i < n; i++) dst[i] += src[i];
+            }
+
+            template <typename value_t>
+            inline void sub(value_t *dst, const value_t *src, std::size_t n) {
+                for(std::size_t i = 0; i < n; i++) dst[i] -= src[i];
+            }
+
+            template <typename value_t>
+            inline void scale(value_t *dst, value_t scale, std::size_t n) {
+                for(std::size_t i = 0; i < n; i++) dst[i] *= scale;
+            }
+
+            template <typename value_t>
+            inline void axpy(value_t *dst, value_t scale, const value_t *src, std::size_t n) {
+                for(std::size_t i = 0; i < n; i++) dst[i] += scale * src[i];
+            }
+
+            // four partial sums, so consecutive adds do not wait on each other.
+            template <typename value_t>
+            inline sum_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n) {
+                using acc_t = sum_t<value_t>;
+                acc_t acc[4] = {};
+                std::size_t i = 0;
+                for(; i < n / 4 * 4; i += 4) {
+                    acc[0] += acc_t(a[i + 0]) * acc_t(b[i + 0]);
+                    acc[1] += acc_t(a[i + 1]) * acc_t(b[i + 1]);
+                    acc[2] += acc_t(a[i + 2]) * acc_t(b[i + 2]);
+                    acc[3] += acc_t(a[i + 3]) * acc_t(b[i + 3]);
+                }
+                for(; i < n; i++) acc[0] += acc_t(a[i]) * acc_t(b[i]);
+                return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            }
+
+            template <typename value_t>
+            inline sum_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n) {
+                using acc_t = sum_t<value_t>;
+                acc_t acc[4] = {};
+                std::size_t i = 0;
+                for(; i < n / 4 * 4; i += 4) {
+                    for(std::size_t k = 0; k < 4; k++) {
+                        const acc_t d = acc_t(a[i + k]) - acc_t(b[i + k]);
+                        acc[k] += d * d;
+                    }
+                }
+                for(; i < n; i++) acc[0] += (acc_t(a[i]) - acc_t(b[i])) * (acc_t(a[i]) - acc_t(b[i]));
+                return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            }
+        };
+
+        template <typename value_t>
+        struct kernel_table {
+            instruction_set isa;
+            void (*add)(value_t *, const value_t *, std::size_t);
+            void (*sub)(value_t *, const value_t *, std::size_t);
+            void (*scale)(value_t *, value_t, std::size_t);
+            void (*axpy)(value_t *, value_t, const value_t *, std::size_t);
+            double (*dot)(const value_t *, const value_t *, std::size_t);
+            double (*squared_distance)(const value_t *, const value_t *, std::size_t);
+        };
+
+#if BBB_SIMD_X86
+        namespace detail {
+            __attribute__((target("sse2"))) inline double hsum(__m128d v) {
+                return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+            }
+            __attribute__((target("avx2"))) inline double hsum(__m256d v) {
+                return hsum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+            }
+            // spilled instead of _mm512_reduce_add_*, which trips -Wuninitialized on gcc 12
+            __attribute__((target("avx512f"))) inline double hsum(__m512d v) {
+                alignas(64) double lanes[8];
+                _mm512_store_pd(lanes, v);
+                return hsum(_mm256_add_pd(_mm256_load_pd(lanes), _mm256_load_pd(lanes + 4)));
+            }
+
+            __attribute__((target("sse2"))) inline __m128d sse2_fmadd_pd(__m128d a, __m128d b, __m128d c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+            __attribute__((target("sse2"))) inline __m128 sse2_fmadd_ps(__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+            // width floats loaded and converted to width doubles, for the float reductions
+            __attribute__((target("sse2"))) inline __m128d sse2_load_widened(const float *p) { return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+            __attribute__((target("avx2"))) inline __m256d avx2_load_widened(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+            // maskz form: the plain _mm512_cvtps_pd trips -Wmaybe-uninitialized on gcc 12 too
+            __attribute__((target("avx512f"))) inline __m512d avx512_load_widened(const float *p) { return _mm512_maskz_cvtps_pd(0xff, _mm256_loadu_ps(p)); }
+        };
+
+// one kernel set per (instruction set, value type). every kernel runs the
+// vector body over whole registers and finishes the tail with scalar code.
+#define BBB_SIMD_DEFINE_KERNELS(isa_name, target_name, value_t, reg_t, width, load, store, add_op, sub_op, mul_op, fmadd_op, set1, setzero) \
+        namespace isa_name { \
+            __attribute__((target(target_name))) inline void add(value_t *dst, const value_t *src, std::size_t n) { \
+                std::size_t i = 0; \
+                for(; i + width <= n; i += width) store(dst + i, add_op(load(dst + i), load(src + i))); \
+                for(; i < n; i++) dst[i] += src[i]; \
+            } \
+            __attribute__((target(target_name))) inline void sub(value_t *dst, const value_t *src, std::size_t n) { \
+                std::size_t i = 0; \
+                for(; i + width <= n; i += width) store(dst + i, sub_op(load(dst + i), load(src + i))); \
+                for(; i < n; i++) dst[i] -= src[i]; \
+            } \
+            __attribute__((target(target_name))) inline void scale(value_t *dst, value_t scale, std::size_t n) { \
+                const reg_t s = set1(scale); \
+                std::size_t i = 0; \
+                for(; i + width <= n; i += width) store(dst + i, mul_op(load(dst + i), s)); \
+                for(; i < n; i++) dst[i] *= scale; \
+            } \
+            __attribute__((target(target_name))) inline void axpy(value_t *dst, value_t scale, const value_t *src, std::size_t n) { \
+                const reg_t s = set1(scale); \
+                std::size_t i = 0; \
+                for(; i + width <= n; i += width) store(dst + i, fmadd_op(s, load(src + i), load(dst + i))); \
+                for(; i < n; i++) dst[i] += scale * src[i]; \
+            } \
+        };
+
+// dot and squared_distance, summed in double registers of width lanes.
+// load reads width values of value_t and widens them when value_t is float.
+#define BBB_SIMD_DEFINE_REDUCTIONS(isa_name, target_name, value_t, reg_t, width, load, add_op, sub_op, fmadd_op, setzero) \
+        namespace isa_name { \
+            __attribute__((target(target_name))) inline double dot(const value_t *a, const value_t *b, std::size_t n) { \
+                reg_t acc0 = setzero(), acc1 = setzero(); \
+                std::size_t i = 0; \
+                for(; i + 2 * width <= n; i += 2 * width) { \
+                    acc0 = fmadd_op(load(a + i), load(b + i), acc0); \
+                    acc1 = fmadd_op(load(a + i + width), load(b + i + width), acc1); \
+                } \
+                for(; i + width <= n; i += width) acc0 = fmadd_op(load(a + i), load(b + i), acc0); \
+                double sum = detail::hsum(add_op(acc0, acc1)); \
+                for(; i < n; i++) sum += double(a[i]) * double(b[i]); \
+                return sum; \
+            } \
+            __attribute__((target(target_name))) inline double squared_distance(const value_t *a, const value_t *b, std::size_t n) { \
+                reg_t acc0 = setzero(), acc1 = setzero(); \
+                std::size_t i = 0; \
+                for(; i + 2 * width <= n; i += 2 * width) { \
+                    const reg_t d0 = sub_op(load(a + i), load(b + i)); \
+                    const reg_t d1 = sub_op(load(a + i + width), load(b + i + width)); \
+                    acc0 = fmadd_op(d0, d0, acc0); \
+                    acc1 = fmadd_op(d1, d1, acc1); \
+                } \
+                for(; i + width <= n; i += width) { \
+                    const reg_t d = sub_op(load(a + i), load(b + i)); \
+                    acc0 = fmadd_op(d, d, acc0); \
+                } \
+                double sum = detail::hsum(add_op(acc0, acc1)); \
+                for(; i < n; i++) sum += (double(a[i]) - double(b[i])) * (double(a[i]) - double(b[i])); \
+                return sum; \
+            } \
+        };
+
+        BBB_SIMD_DEFINE_KERNELS(sse2, "sse2", double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd, detail::sse2_fmadd_pd, _mm_set1_pd, _mm_setzero_pd)
+        BBB_SIMD_DEFINE_KERNELS(sse2, "sse2", float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, detail::sse2_fmadd_ps, _mm_set1_ps, _mm_setzero_ps)
+        BBB_SIMD_DEFINE_KERNELS(avx2, "avx2,fma", double, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_fmadd_pd, _mm256_set1_pd, _mm256_setzero_pd)
+        BBB_SIMD_DEFINE_KERNELS(avx2, "avx2,fma", float, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_fmadd_ps, _mm256_set1_ps, _mm256_setzero_ps)
+        BBB_SIMD_DEFINE_KERNELS(avx512, "avx512f", double, __m512d, 8, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_fmadd_pd, _mm512_set1_pd, _mm512_setzero_pd)
+        BBB_SIMD_DEFINE_KERNELS(avx512, "avx512f", float, __m512, 16, _mm512_loadu_ps, _mm512_storeu_ps, _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_fmadd_ps, _mm512_set1_ps, _mm512_setzero_ps)
+
+        BBB_SIMD_DEFINE_REDUCTIONS(sse2, "sse2", double, __m128d, 2, _mm_loadu_pd, _mm_add_pd, _mm_sub_pd, detail::sse2_fmadd_pd, _mm_setzero_pd)
+        BBB_SIMD_DEFINE_REDUCTIONS(sse2, "sse2", float, __m128d, 2, detail::sse2_load_widened, _mm_add_pd, _mm_sub_pd, detail::sse2_fmadd_pd, _mm_setzero_pd)
+        BBB_SIMD_DEFINE_REDUCTIONS(avx2, "avx2,fma", double, __m256d, 4, _mm256_loadu_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_fmadd_pd, _mm256_setzero_pd)
+        BBB_SIMD_DEFINE_REDUCTIONS(avx2, "avx2,fma", float, __m256d, 4, detail::avx2_load_widened, _mm256_add_pd, _mm256_sub_pd, _mm256_fmadd_pd, _mm256_setzero_pd)
+        BBB_SIMD_DEFINE_REDUCTIONS(avx512, "avx512f", double, __m512d, 8, _mm512_loadu_pd, _mm512_add_pd, _mm512_sub_pd, _mm512_fmadd_pd, _mm512_setzero_pd)
+        BBB_SIMD_DEFINE_REDUCTIONS(avx512, "avx512f", float, __m512d, 8, detail::avx512_load_widened, _mm512_add_pd, _mm512_sub_pd, _mm512_fmadd_pd, _mm512_setzero_pd)
+
+#undef BBB_SIMD_DEFINE_KERNELS
+#undef BBB_SIMD_DEFINE_REDUCTIONS
+#endif
+
+        inline instruction_set detect() {
+#if BBB_SIMD_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx512f")) return instruction_set::avx512;
+            if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return instruction_set::avx2;
+            if(__builtin_cpu_supports("sse2")) return instruction_set::sse2;
+#endif
+            return instruction_set::scalar;
+        }
+
+        inline instruction_set detected() {
+            static const instruction_set isa = detect();
+            return isa;
+        }
+
+        inline bool supports(instruction_set isa) {
+            return static_cast<int>(isa) <= static_cast<int>(detected());
+        }
+
+        // kernels of the given instruction set, or the scalar ones if it was not compiled in.
+        template <typename value_t>
+        inline kernel_table<value_t> kernels_for(instruction_set isa) {
+            static_assert(is_dispatchable<value_t>::value, "required: value_t is float or double");
+#if BBB_SIMD_X86
+            switch(isa) {
+                case instruction_set::avx512:
+                    return {isa, avx512::add, avx512::sub, avx512::scale, avx512::axpy, avx512::dot, avx512::squared_distance};
+                case instruction_set::avx2:
+                    return {isa, avx2::add, avx2::sub, avx2::scale, avx2::axpy, avx2::dot, avx2::squared_distance};
+                case instruction_set::sse2:
+                    return {isa, sse2::add, sse2::sub, sse2::scale, sse2::axpy, sse2::dot, sse2::squared_distance};
+                default:
+                    break;
+            }
+#endif
+            return {
+                instruction_set::scalar,
+                scalar::add<value_t>,
+                scalar::sub<value_t>,
+                scalar::scale<value_t>,
+                scalar::axpy<value_t>,
+                scalar::dot<value_t>,
+                scalar::squared_distance<value_t>
+            };
+        }
+
+        template <typename value_t>
+        inline const kernel_table<value_t> &kernels() {
+            static const kernel_table<value_t> table = kernels_for<value_t>(detected());
+            return table;
+        }
+
+        namespace detail {
+            template <typename value_t>
+            inline void add(value_t *dst, const value_t *src, std::size_t n, std::false_type) { scalar::add(dst, src, n); }
+            template <typename value_t>
+            inline void add(value_t *dst, const value_t *src, std::size_t n, std::true_type) {
+                if(n < threshold) scalar::add(dst, src, n);
+                else kernels<value_t>().add(dst, src, n);
+            }
+
+            template <typename value_t>
+            inline void sub(value_t *dst, const value_t *src, std::size_t n, std::false_type) { scalar::sub(dst, src, n); }
+            template <typename value_t>
+            inline void sub(value_t *dst, const value_t *src, std::size_t n, std::true_type) {
+                if(n < threshold) scalar::sub(dst, src, n);
+                else kernels<value_t>().sub(dst, src, n);
+            }
+
+            template <typename value_t>
+            inline void scale(value_t *dst, value_t s, std::size_t n, std::false_type) { scalar::scale(dst, s, n); }
+            template <typename value_t>
+            inline void scale(value_t *dst, value_t s, std::size_t n, std::true_type) {
+                if(n < threshold) scalar::scale(dst, s, n);
+                else kernels<value_t>().scale(dst, s, n);
+            }
+
+            template <typename value_t>
+            inline void axpy(value_t *dst, value_t s, const value_t *src, std::size_t n, std::false_type) { scalar::axpy(dst, s, src, n); }
+            template <typename value_t>
+            inline void axpy(value_t *dst, value_t s, const value_t *src, std::size_t n, std::true_type) {
+                if(n < threshold) scalar::axpy(dst, s, src, n);
+                else kernels<value_t>().axpy(dst, s, src, n);
+            }
+
+            template <typename value_t>
+            inline sum_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n, std::false_type) { return scalar::dot(a, b, n); }
+            template <typename value_t>
+            inline sum_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n, std::true_type) {
+                return n < threshold ? scalar::dot(a, b, n) : kernels<value_t>().dot(a, b, n);
+            }
+
+            template <typename value_t>
+            inline sum_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n, std::false_type) { return scalar::squared_distance(a, b, n); }
+            template <typename value_t>
+            inline sum_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n, std::true_type) {
+                return n < threshold ? scalar::squared_distance(a, b, n) : kernels<value_t>().squared_distance(a, b, n);
+            }
+        };
+
+        // dst[i] += src[i]
+        template <typename value_t>
+        inline void add(value_t *dst, const value_t *src, std::size_t n) { detail::add(dst, src, n, is_dispatchable<value_t>{}); }
+
+        // dst[i] -= src[i]
+        template <typename value_t>
+        inline void sub(value_t *dst, const value_t *src, std::size_t n) { detail::sub(dst, src, n, is_dispatchable<value_t>{}); }
+
+        // dst[i] *= s
+        template <typename value_t>
+        inline void scale(value_t *dst, value_t s, std::size_t n) { detail::scale(dst, s, n, is_dispatchable<value_t>{}); }
+
+        // dst[i] += s * src[i]
+        template <typename value_t>
+        inline void axpy(value_t *dst, value_t s, const value_t *src, std::size_t n) { detail::axpy(dst, s, src, n, is_dispatchable<value_t>{}); }
+
+        // sum of a[i] * b[i], in double for float
+        template <typename value_t>
+        inline sum_t<value_t> dot(const value_t *a, const value_t *b, std::size_t n) { return detail::dot(a, b, n, is_dispatchable<value_t>{}); }
+
+        // sum of (a[i] - b[i])^2, in double for float
+        template <typename value_t>
+        inline sum_t<value_t> squared_distance(const value_t *a, const value_t *b, std::size_t n) { return detail::squared_distance(a, b, n, is_dispatchable<value_t>{}); }
+    };
+};
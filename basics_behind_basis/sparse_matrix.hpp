@@ -0,0 +1,325 @@
+//
+//  sparse_matrix.hpp
+//
+//  compressed sparse row matrix. row i holds the entries
+//  [row_offsets()[i], row_offsets()[i + 1]) of column_indices() / values(),
+//  sorted by column. column indices are 32 bit by default so that SpMV
+//  streams 12 instead of 16 bytes per double entry.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "matrix.hpp"
+#include "dynamic_matrix.hpp"
+#include "thread_pool.hpp"
+
+namespace bbb {
+    template <typename value_t = default_value_t, typename index_t = std::uint32_t>
+    struct sparse_matrix;
+
+    // collects (row, column, value) triplets in any order; duplicates are summed by build().
+    template <typename value_t = default_value_t, typename index_t = std::uint32_t>
+    struct sparse_matrix_builder {
+        struct triplet {
+            std::size_t row;
+            index_t column;
+            value_t value;
+        };
+
+        sparse_matrix_builder(std::size_t rows, std::size_t cols)
+        : rows(rows), cols(cols) { assert(cols <= std::numeric_limits<index_t>::max()); }
+
+        void reserve(std::size_t size) { triplets.reserve(size); }
+
+        sparse_matrix_builder &add(std::size_t row, std::size_t col, value_t value) {
+            assert(row < rows && col < cols);
+            triplets.push_back({row, static_cast<index_t>(col), value});
+            return *this;
+        }
+
+        sparse_matrix<value_t, index_t> build() const {
+            std::vector<triplet> sorted(triplets);
+            std::sort(sorted.begin(), sorted.end(), [](const triplet &a, const triplet &b) {
+                return a.row < b.row || (a.row == b.row && a.column < b.column);
+            });
+            sparse_matrix<value_t, index_t> m(rows, cols);
+            m.columns.reserve(sorted.size());
+            m.entries.reserve(sorted.size());
+            std::size_t row = 0;
+            for(std::size_t k = 0; k < sorted.size(); k++) {
+                const triplet &t = sorted[k];
+                if(k && t.row == sorted[k - 1].row && t.column == sorted[k - 1].column) {
+                    m.entries.back() += t.value;
+                    continue;
+                }
+                while(row < t.row) m.offsets[++row] = m.entries.size();
+                m.columns.push_back(t.column);
+                m.entries.push_back(t.value);
+            }
+            while(row < rows) m.offsets[++row] = m.entries.size();
+            return m;
+        }
+
+    private:
+        std::size_t rows, cols;
+        std::vector<triplet> triplets;
+    };
+
+    template <typename value_t, typename index_t>
+    struct sparse_matrix {
+        using value_type = value_t;
+        using index_type = index_t;
+        using builder = sparse_matrix_builder<value_t, index_t>;
+
+        sparse_matrix()
+        : rows(0), cols(0), offsets(1, 0) {}
+
+        // every column index has to fit in index_t; the dense and transposing
+        // paths all come through here.
+        sparse_matrix(std::size_t rows, std::size_t cols)
+        : rows(rows), cols(cols), offsets(rows + 1, 0) { assert(cols <= std::numeric_limits<index_t>::max()); }
+
+        // keeps the entries that are not exactly zero
+        template <std::size_t row_num, std::size_t col_num>
+        explicit sparse_matrix(const matrix<row_num, col_num, value_t> &m)
+        : sparse_matrix(row_num, col_num) { compress(m); }
+
+        template <typename allocator>
+        explicit sparse_matrix(const dynamic_matrix<value_t, allocator> &m)
+        : sparse_matrix(m.row_size(), m.column_size()) { compress(m); }
+
+        std::size_t row_size() const { return rows; }
+        std::size_t column_size() const { return cols; }
+        std::size_t non_zero_size() const { return entries.size(); }
+
+        const std::vector<std::size_t> &row_offsets() const { return offsets; }
+        const std::vector<index_t> &column_indices() const { return columns; }
+        const std::vector<value_t> &values() const { return entries; }
+        std::vector<value_t> &values() { return entries; }
+
+        // zero for entries that are not stored
+        value_t operator()(std::size_t i, std::size_t j) const {
+            const index_t *begin = columns.data() + offsets[i], *end = columns.data() + offsets[i + 1];
+            const index_t *found = std::lower_bound(begin, end, static_cast<index_t>(j));
+            return (found != end && *found == j) ? entries[found - columns.data()] : value_t(0);
+        }
+
+        dynamic_matrix<value_t> to_dense() const {
+            dynamic_matrix<value_t> d(rows, cols);
+            for(std::size_t i = 0; i < rows; i++) {
+                for(std::size_t k = offsets[i]; k < offsets[i + 1]; k++) d[i][columns[k]] = entries[k];
+            }
+            return d;
+        }
+
+        sparse_matrix transpose() const {
+            sparse_matrix t(cols, rows);
+            t.columns.resize(entries.size());
+            t.entries.resize(entries.size());
+            for(index_t c : columns) t.offsets[c + 1]++;
+            for(std::size_t j = 0; j < cols; j++) t.offsets[j + 1] += t.offsets[j];
+            std::vector<std::size_t> next(t.offsets.begin(), t.offsets.end() - 1);
+            for(std::size_t i = 0; i < rows; i++) {
+                for(std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+                    const std::size_t to = next[columns[k]]++;
+                    t.columns[to] = static_cast<index_t>(i);
+                    t.entries[to] = entries[k];
+                }
+            }
+            return t;
+        }
+
+        // y = A x; x has column_size(), y row_size() elements.
+        template <typename policy>
+        auto multiply(const policy &p, const value_t *x, value_t *y) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+        {
+            thread_pool *pool = execution::pool_of(p);
+            if(!pool || pool->size() == 1 || entries.size() < 2 * block_entries) {
+                multiply_rows(x, y, 0, rows);
+                return;
+            }
+            const std::vector<std::size_t> blocks = row_blocks(4 * pool->size());
+            pool->parallel_for(blocks.size() - 1, [&](std::size_t b) {
+                multiply_rows(x, y, blocks[b], blocks[b + 1]);
+            });
+        }
+
+        void multiply(const value_t *x, value_t *y) const { multiply(execution::seq, x, y); }
+
+        template <typename policy, typename allocator>
+        auto multiply(const policy &p, const std::vector<value_t, allocator> &x, std::vector<value_t, allocator> &y) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+        {
+            assert(x.size() == cols);
+            y.resize(rows);
+            multiply(p, x.data(), y.data());
+        }
+
+        template <typename allocator>
+        void multiply(const std::vector<value_t, allocator> &x, std::vector<value_t, allocator> &y) const { multiply(execution::seq, x, y); }
+
+        template <typename policy, std::size_t n, std::size_t m>
+        auto multiply(const policy &p, const column_vector<n, value_t> &x, column_vector<m, value_t> &y) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+        {
+            assert(n == cols && m == rows);
+            multiply(p, x.raw_data(), y.raw_data());
+        }
+
+        template <std::size_t n, std::size_t m>
+        void multiply(const column_vector<n, value_t> &x, column_vector<m, value_t> &y) const { multiply(execution::seq, x, y); }
+
+        template <typename allocator>
+        std::vector<value_t, allocator> operator*(const std::vector<value_t, allocator> &x) const {
+            std::vector<value_t, allocator> y(x.get_allocator());
+            multiply(x, y);
+            return y;
+        }
+
+        // y = A^T x; x has row_size(), y column_size() elements.
+        void multiply_transposed(const value_t *x, value_t *y) const {
+            std::fill(y, y + cols, value_t(0));
+            for(std::size_t i = 0; i < rows; i++) {
+                const value_t x_i = x[i];
+                for(std::size_t k = offsets[i]; k < offsets[i + 1]; k++) y[columns[k]] += entries[k] * x_i;
+            }
+        }
+
+        template <typename allocator>
+        void multiply_transposed(const std::vector<value_t, allocator> &x, std::vector<value_t, allocator> &y) const {
+            assert(x.size() == rows);
+            y.resize(cols);
+            multiply_transposed(x.data(), y.data());
+        }
+
+        template <std::size_t n, std::size_t m>
+        void multiply_transposed(const column_vector<n, value_t> &x, column_vector<m, value_t> &y) const {
+            assert(n == rows && m == cols);
+            multiply_transposed(x.raw_data(), y.raw_data());
+        }
+
+        // C = A B for a dense B with column_size() rows.
+        template <typename policy, typename allocator>
+        auto multiply(const policy &p, const dynamic_matrix<value_t, allocator> &b) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, dynamic_matrix<value_t, allocator>>::type
+        {
+            dynamic_matrix<value_t, allocator> c(b.get_allocator());
+            multiply_dense(p, detail::make_dense_operand(b), c);
+            return c;
+        }
+
+        template <typename policy, std::size_t row_num, std::size_t col_num>
+        auto multiply(const policy &p, const matrix<row_num, col_num, value_t> &b) const
+        -> typename std::enable_if<execution::is_execution_policy<policy>::value, dynamic_matrix<value_t>>::type
+        {
+            dynamic_matrix<value_t> c;
+            multiply_dense(p, detail::make_dense_operand(b), c);
+            return c;
+        }
+
+        template <typename allocator>
+        dynamic_matrix<value_t, allocator> operator*(const dynamic_matrix<value_t, allocator> &b) const { return multiply(execution::seq, b); }
+
+        template <std::size_t row_num, std::size_t col_num>
+        dynamic_matrix<value_t> operator*(const matrix<row_num, col_num, value_t> &b) const { return multiply(execution::seq, b); }
+
+    private:
+        template <typename, typename>
+        friend struct sparse_matrix_builder;
+
+        // entries per task when SpMV is split over threads
+        static constexpr std::size_t block_entries = 16 * 1024;
+
+        template <typename dense_t>
+        void compress(const dense_t &m) {
+            for(std::size_t i = 0; i < rows; i++) {
+                for(std::size_t j = 0; j < cols; j++) {
+                    if(m(i, j) == value_t(0)) continue;
+                    columns.push_back(static_cast<index_t>(j));
+                    entries.push_back(m(i, j));
+                }
+                offsets[i + 1] = entries.size();
+            }
+        }
+
+        // four independent partial sums per row, so long rows do not serialize on one add.
+        void multiply_rows(const value_t *x, value_t *y, std::size_t begin, std::size_t end) const {
+            const index_t *col = columns.data();
+            const value_t *val = entries.data();
+            for(std::size_t i = begin; i < end; i++) {
+                std::size_t k = offsets[i];
+                const std::size_t last = offsets[i + 1];
+                value_t acc[4] = {};
+                for(; k + 4 <= last; k += 4) {
+                    acc[0] += val[k + 0] * x[col[k + 0]];
+                    acc[1] += val[k + 1] * x[col[k + 1]];
+                    acc[2] += val[k + 2] * x[col[k + 2]];
+                    acc[3] += val[k + 3] * x[col[k + 3]];
+                }
+                for(; k < last; k++) acc[0] += val[k] * x[col[k]];
+                y[i] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+            }
+        }
+
+        // row ranges holding about the same number of entries; boundaries, front 0, back rows.
+        std::vector<std::size_t> row_blocks(std::size_t count) const {
+            const std::size_t min_entries = block_entries;
+            const std::size_t per_block = std::max(min_entries, (entries.size() + count - 1) / count);
+            std::vector<std::size_t> blocks(1, 0);
+            while(blocks.back() < rows) {
+                const std::size_t target = offsets[blocks.back()] + per_block;
+                std::size_t next = std::lower_bound(offsets.begin() + blocks.back() + 1, offsets.end(), target) - offsets.begin();
+                blocks.push_back(std::min(next, rows));
+            }
+            return blocks;
+        }
+
+        template <typename policy, typename allocator>
+        void multiply_dense(const policy &p, const detail::dense_operand<value_t> &b, dynamic_matrix<value_t, allocator> &c) const {
+            assert(b.rows == cols && b.cs == 1);
+            c.resize(rows, b.cols);
+            c.fill(value_t(0));
+            const auto rows_of = [&](std::size_t begin, std::size_t end) {
+                for(std::size_t i = begin; i < end; i++) {
+                    value_t *c_i = c.row(i);
+                    for(std::size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+                        const value_t a_ik = entries[k];
+                        const value_t *b_k = b.data + columns[k] * b.ld;
+                        for(std::size_t j = 0; j < b.cols; j++) c_i[j] += a_ik * b_k[j];
+                    }
+                }
+            };
+            thread_pool *pool = execution::pool_of(p);
+            if(!pool || pool->size() == 1 || entries.size() * b.cols < 2 * block_entries) {
+                rows_of(0, rows);
+                return;
+            }
+            const std::vector<std::size_t> blocks = row_blocks(4 * pool->size());
+            pool->parallel_for(blocks.size() - 1, [&](std::size_t k) { rows_of(blocks[k], blocks[k + 1]); });
+        }
+
+        std::size_t rows, cols;
+        std::vector<std::size_t> offsets;
+        std::vector<index_t> columns;
+        std::vector<value_t> entries;
+    };
+};
+
+template <typename value_t, typename index_t>
+std::ostream &operator<<(std::ostream &os, const bbb::sparse_matrix<value_t, index_t> &mat) {
+    for(std::size_t i = 0; i < mat.row_size(); i++) {
+        for(std::size_t k = mat.row_offsets()[i]; k < mat.row_offsets()[i + 1]; k++) {
+            os << "(" << i << ", " << mat.column_indices()[k] << ") " << mat.values()[k] << std::endl;
+        }
+    }
+    return os;
+}
@@ -0,0 +1,178 @@
+//
+//  strided_view.hpp
+//
+//  non-owning window on the elements of a matrix: entry (i, j) is
+//  data[i * row_stride + j * column_stride]. blocks, single rows and
+//  columns and the transpose of a matrix are all views of this one type,
+//  so they nest (a.t().block<2, 2>(0, 1)) and take part in expressions and
+//  products without copying. extents given as template arguments are
+//  checked at compile time; dynamic_extent leaves them to run time.
+//
+//  strided_view<const value_t, ...> is read only. assigning to a mutable
+//  view writes through to the viewed matrix. a source that reads the same
+//  storage in another layout (a = a.t(), a.t() = a) is evaluated into a
+//  temporary first. a view does not keep the matrix alive.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <cassert>
+
+#include "expression.hpp"
+
+namespace bbb {
+    template <typename value_t, std::size_t row_num = dynamic_extent, std::size_t col_num = dynamic_extent>
+    struct strided_view : matrix_expression_tag {
+        using value_type = typename std::remove_const<value_t>::type;
+        using element_type = value_t;
+
+        static constexpr std::size_t row_extent = row_num;
+        static constexpr std::size_t column_extent = col_num;
+
+        strided_view(value_t *data, std::size_t rows, std::size_t cols, std::ptrdiff_t row_stride, std::ptrdiff_t column_stride)
+        : ptr(data), rows(rows), cols(cols), rs(row_stride), cs(column_stride)
+        {
+            assert(detail::extent_matches(row_num, rows) && detail::extent_matches(col_num, cols));
+        }
+
+        strided_view(const strided_view &) = default;
+
+        // views convert to read only ones and to run time extents.
+        template <typename other_t, std::size_t other_rows, std::size_t other_cols, typename std::enable_if<
+            std::is_same<const other_t, const value_t>::value && (std::is_const<value_t>::value || !std::is_const<other_t>::value)
+            && !(std::is_same<other_t, value_t>::value && other_rows == row_num && other_cols == col_num)
+            && (row_num == dynamic_extent || row_num == other_rows) && (col_num == dynamic_extent || col_num == other_cols)
+        >::type * = nullptr>
+        strided_view(const strided_view<other_t, other_rows, other_cols> &v)
+        : strided_view(v.data(), v.row_size(), v.column_size(), v.row_stride(), v.column_stride()) {}
+
+        std::size_t row_size() const { return rows; }
+        std::size_t column_size() const { return cols; }
+        std::ptrdiff_t row_stride() const { return rs; }
+        std::ptrdiff_t column_stride() const { return cs; }
+        value_t *data() const { return ptr; }
+
+        inline value_t &operator()(std::size_t i, std::size_t j) const { return ptr[offset(i, j)]; }
+
+        inline typename detail::evaluated_matrix<row_num, col_num, value_type>::type eval() const { return *this; }
+
+        // element wise copy, not a rebind.
+        strided_view &operator=(const strided_view &rhs) { return assign(rhs); }
+
+        template <typename expression>
+        auto operator=(const expression &e)
+        -> typename std::enable_if<is_matrix_expression<expression>::value && !std::is_same<expression, strided_view>::value, strided_view &>::type
+        { return assign(e); }
+
+        template <typename expression>
+        auto operator+=(const expression &rhs)
+        -> typename std::enable_if<is_matrix_expression<expression>::value, strided_view &>::type
+        {
+            check_extents(rhs);
+            if(detail::aliases(rhs, span())) return *this += evaluated_type(rhs);
+            const detail::operand_t<const expression &> e = rhs;
+            for_each([&e](value_t &x, std::size_t i, std::size_t j) { x += e(i, j); });
+            return *this;
+        }
+
+        template <typename expression>
+        auto operator-=(const expression &rhs)
+        -> typename std::enable_if<is_matrix_expression<expression>::value, strided_view &>::type
+        {
+            check_extents(rhs);
+            if(detail::aliases(rhs, span())) return *this -= evaluated_type(rhs);
+            const detail::operand_t<const expression &> e = rhs;
+            for_each([&e](value_t &x, std::size_t i, std::size_t j) { x -= e(i, j); });
+            return *this;
+        }
+
+        strided_view &operator*=(value_type scale) {
+            for_each([scale](value_t &x, std::size_t, std::size_t) { x *= scale; });
+            return *this;
+        }
+
+        // by the reciprocal, as matrix and dynamic_matrix do, so both agree bit for bit
+        strided_view &operator/=(value_type scale) {
+            return *this *= (1.0 / scale);
+        }
+
+        template <std::size_t block_rows, std::size_t block_cols>
+        strided_view<value_t, block_rows, block_cols> block(std::size_t i, std::size_t j) const {
+            static_assert(row_num == dynamic_extent || block_rows <= row_num, "required: block fits in rows");
+            static_assert(col_num == dynamic_extent || block_cols <= col_num, "required: block fits in columns");
+            assert(i + block_rows <= rows && j + block_cols <= cols);
+            return {ptr + offset(i, j), block_rows, block_cols, rs, cs};
+        }
+
+        strided_view<value_t> block(std::size_t i, std::size_t j, std::size_t block_rows, std::size_t block_cols) const {
+            assert(i + block_rows <= rows && j + block_cols <= cols);
+            return {ptr + offset(i, j), block_rows, block_cols, rs, cs};
+        }
+
+        strided_view<value_t, 1, col_num> row_view(std::size_t i) const {
+            assert(i < rows);
+            return {ptr + offset(i, 0), 1, cols, rs, cs};
+        }
+
+        strided_view<value_t, row_num, 1> column_view(std::size_t j) const {
+            assert(j < cols);
+            return {ptr + offset(0, j), rows, 1, rs, cs};
+        }
+
+        strided_view<value_t, col_num, row_num> t() const {
+            return {ptr, cols, rows, cs, rs};
+        }
+
+    private:
+        using evaluated_type = typename detail::evaluated_matrix<row_num, col_num, value_type>::type;
+
+        detail::storage_span span() const { return detail::span_of(ptr, rows, cols, rs, cs); }
+
+        std::ptrdiff_t offset(std::size_t i, std::size_t j) const {
+            return static_cast<std::ptrdiff_t>(i) * rs + static_cast<std::ptrdiff_t>(j) * cs;
+        }
+
+        template <typename expression>
+        void check_extents(const expression &e) const {
+            static_assert(detail::extent_matches(expression::row_extent, row_num) && detail::extent_matches(expression::column_extent, col_num), "required: operands have same dimensions");
+            assert(e.row_size() == rows && e.column_size() == cols);
+            (void)e;
+        }
+
+        template <typename function>
+        void for_each(function f) const {
+            for(std::size_t i = 0; i < rows; i++) {
+                for(std::size_t j = 0; j < cols; j++) f(ptr[offset(i, j)], i, j);
+            }
+        }
+
+        template <typename expression>
+        strided_view &assign(const expression &rhs) {
+            check_extents(rhs);
+            if(detail::aliases(rhs, span())) return assign(evaluated_type(rhs));
+            const detail::operand_t<const expression &> e = rhs;
+            for_each([&e](value_t &x, std::size_t i, std::size_t j) { x = e(i, j); });
+            return *this;
+        }
+
+        value_t *ptr;
+        std::size_t rows, cols;
+        std::ptrdiff_t rs, cs;
+    };
+
+    namespace detail {
+        template <typename value_t, std::size_t row_num, std::size_t col_num>
+        struct aliasing<strided_view<value_t, row_num, col_num>> {
+            static bool reads(const strided_view<value_t, row_num, col_num> &v, const storage_span &destination) {
+                return conflicts(span_of(v.data(), v.row_size(), v.column_size(), v.row_stride(), v.column_stride()), destination);
+            }
+        };
+    };
+
+    template <typename type>
+    struct is_strided_view : std::false_type {};
+    template <typename value_t, std::size_t row_num, std::size_t col_num>
+    struct is_strided_view<strided_view<value_t, row_num, col_num>> : std::true_type {};
+};
@@ -0,0 +1,210 @@
+//
+//  thread_pool.hpp
+//
+//  work-stealing thread pool and execution policies.
+//  every worker owns a deque: it pops its own tasks LIFO and steals from
+//  the others FIFO when it runs dry. a thread waiting for a parallel_for
+//  runs tasks too, so nested parallel loops cannot deadlock.
+//  tasks must not throw.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <type_traits>
+
+namespace bbb {
+    struct thread_pool {
+        // thread_num counts the calling thread: thread_num - 1 workers are started.
+        explicit thread_pool(std::size_t thread_num = default_thread_num())
+        : queues(thread_num ? thread_num : 1)
+        {
+            for(std::size_t i = 1; i < queues.size(); i++) {
+                workers.emplace_back([this, i] { work(i); });
+            }
+        }
+
+        thread_pool(const thread_pool &) = delete;
+        thread_pool &operator=(const thread_pool &) = delete;
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for(auto &worker : workers) worker.join();
+        }
+
+        std::size_t size() const { return queues.size(); }
+
+        // calls f(i) for every i in [0, count) and returns when all calls are done.
+        template <typename function_t>
+        void parallel_for(std::size_t count, const function_t &f) {
+            if(count == 0) return;
+            if(count == 1 || size() == 1) {
+                for(std::size_t i = 0; i < count; i++) f(i);
+                return;
+            }
+            std::atomic<std::size_t> remaining{count};
+            for(std::size_t i = 1; i < count; i++) {
+                push([&f, &remaining, i] {
+                    f(i);
+                    remaining.fetch_sub(1, std::memory_order_release);
+                });
+            }
+            f(0);
+            remaining.fetch_sub(1, std::memory_order_release);
+            while(remaining.load(std::memory_order_acquire) != 0) {
+                if(!run_one(current_index())) std::this_thread::yield();
+            }
+        }
+
+        // pool used by execution::par; created on first use.
+        static thread_pool &shared() {
+            std::lock_guard<std::mutex> lock(shared_mutex());
+            std::unique_ptr<thread_pool> &pool = shared_pool();
+            if(!pool) pool.reset(new thread_pool(shared_thread_num()));
+            return *pool;
+        }
+
+        // 0 restores one thread per hardware thread. must not be called while
+        // the shared pool is running work.
+        static void set_thread_num(std::size_t thread_num) {
+            std::lock_guard<std::mutex> lock(shared_mutex());
+            shared_thread_num() = thread_num ? thread_num : default_thread_num();
+            shared_pool().reset();
+        }
+
+        static std::size_t default_thread_num() {
+            const std::size_t n = std::thread::hardware_concurrency();
+            return n ? n : 1;
+        }
+
+    private:
+        using task = std::function<void()>;
+
+        struct task_queue {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        // index of the calling thread's queue; 0 for threads outside the pool.
+        std::size_t current_index() const {
+            return owner() == this ? owner_index() : 0;
+        }
+
+        void push(task t) {
+            const std::size_t self = current_index();
+            const std::size_t index = self ? self : next_queue++ % size();
+            {
+                std::lock_guard<std::mutex> lock(queues[index].mutex);
+                queues[index].tasks.push_back(std::move(t));
+            }
+            pending.fetch_add(1, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            wake.notify_one();
+        }
+
+        bool run_one(std::size_t self) {
+            task t;
+            if(!pop(self, t) && !steal(self, t)) return false;
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            t();
+            return true;
+        }
+
+        bool pop(std::size_t index, task &t) {
+            std::lock_guard<std::mutex> lock(queues[index].mutex);
+            if(queues[index].tasks.empty()) return false;
+            t = std::move(queues[index].tasks.back());
+            queues[index].tasks.pop_back();
+            return true;
+        }
+
+        bool steal(std::size_t self, task &t) {
+            for(std::size_t k = 1; k < size(); k++) {
+                task_queue &victim = queues[(self + k) % size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if(victim.tasks.empty()) continue;
+                t = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        void work(std::size_t index) {
+            owner() = this;
+            owner_index() = index;
+            while(true) {
+                if(run_one(index)) continue;
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [this] { return stopping || pending.load(std::memory_order_acquire) != 0; });
+                if(stopping) return;
+            }
+        }
+
+        static const thread_pool *&owner() {
+            static thread_local const thread_pool *pool = nullptr;
+            return pool;
+        }
+        static std::size_t &owner_index() {
+            static thread_local std::size_t index = 0;
+            return index;
+        }
+
+        static std::mutex &shared_mutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+        static std::unique_ptr<thread_pool> &shared_pool() {
+            static std::unique_ptr<thread_pool> pool;
+            return pool;
+        }
+        static std::size_t &shared_thread_num() {
+            static std::size_t thread_num = default_thread_num();
+            return thread_num;
+        }
+
+        std::vector<task_queue> queues;
+        std::vector<std::thread> workers;
+        std::atomic<std::size_t> pending{0};
+        std::atomic<std::size_t> next_queue{0};
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        bool stopping{false};
+    };
+
+    namespace execution {
+        struct sequenced_policy {};
+
+        struct parallel_policy {
+            // nullptr runs on thread_pool::shared().
+            thread_pool *pool;
+            parallel_policy on(thread_pool &p) const { return {&p}; }
+        };
+
+        constexpr sequenced_policy seq{};
+        constexpr parallel_policy par{nullptr};
+
+        template <typename policy>
+        struct is_execution_policy : std::false_type {};
+        template <>
+        struct is_execution_policy<sequenced_policy> : std::true_type {};
+        template <>
+        struct is_execution_policy<parallel_policy> : std::true_type {};
+
+        // pool to run on, nullptr for sequential execution.
+        inline thread_pool *pool_of(const sequenced_policy &) { return nullptr; }
+        inline thread_pool *pool_of(const parallel_policy &p) { return p.pool ? p.pool : &thread_pool::shared(); }
+    };
+};
@@ -0,0 +1,182 @@
+//
+//  transform.hpp
+//
+//  applies one matrix to many vectors: out[i] = m * in[i] (column vector
+//  convention). the matrix is copied into locals once per batch and the
+//  loop over points is unrolled over the components, so the compiler keeps
+//  the coefficients in registers and vectorizes across points.
+//
+//  m is s x s: linear map of vec<s>.
+//  m is (s + 1) x (s + 1): affine map of vec<s> with implied w = 1;
+//  transform_homogeneous also divides by the resulting w.
+//
+//  in == out is allowed. vec<s> arrays are read as packed s-tuples, vec_array
+//  component by component.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include "matrix.hpp"
+#include "vec.hpp"
+#include "vec_array.hpp"
+#include "thread_pool.hpp"
+
+namespace bbb {
+    namespace detail {
+        namespace transform {
+            // points handed to one task when the batch is split over threads.
+            constexpr std::size_t chunk = 16 * 1024;
+
+            // in_dim input components, out_dim output components; affine adds the last
+            // column as translation, divide scales by 1 / (row out_dim . (x, 1)).
+            template <std::size_t out_dim, std::size_t in_dim, bool affine, bool divide, typename value_t>
+            struct kernel {
+                static constexpr std::size_t rows = out_dim + (divide ? 1 : 0);
+                static constexpr std::size_t cols = in_dim + (affine ? 1 : 0);
+                value_t m[rows][cols];
+
+                template <std::size_t n>
+                explicit kernel(const matrix<n, n, value_t> &mat) {
+                    static_assert(rows <= n && cols <= n, "required: matrix covers the transform");
+                    for(std::size_t r = 0; r < rows; r++) {
+                        for(std::size_t c = 0; c < cols; c++) m[r][c] = mat(r, c);
+                    }
+                }
+
+                // component k of point i is in[k][i * stride].
+                template <std::size_t stride>
+                void operator()(const value_t * const *in, value_t * const *out, std::size_t begin, std::size_t end) const {
+                    for(std::size_t i = begin; i < end; i++) {
+                        value_t x[in_dim];
+                        for(std::size_t k = 0; k < in_dim; k++) x[k] = in[k][i * stride];
+                        value_t y[rows];
+                        for(std::size_t r = 0; r < rows; r++) {
+                            y[r] = affine ? m[r][in_dim] : value_t(0);
+                            for(std::size_t k = 0; k < in_dim; k++) y[r] += m[r][k] * x[k];
+                        }
+                        if(divide) {
+                            const value_t inv = value_t(1) / y[rows - 1];
+                            for(std::size_t r = 0; r < out_dim; r++) y[r] *= inv;
+                        }
+                        for(std::size_t r = 0; r < out_dim; r++) out[r][i * stride] = y[r];
+                    }
+                }
+            };
+
+            template <std::size_t stride, typename kernel_t, typename value_t>
+            void run(thread_pool *pool, const kernel_t &k, const value_t * const *in, value_t * const *out, std::size_t n) {
+                if(!pool || pool->size() == 1 || n < 2 * chunk) {
+                    k.template operator()<stride>(in, out, 0, n);
+                    return;
+                }
+                pool->parallel_for((n + chunk - 1) / chunk, [&](std::size_t c) {
+                    k.template operator()<stride>(in, out, c * chunk, std::min(n, (c + 1) * chunk));
+                });
+            }
+
+            template <std::size_t s, typename kernel_t, typename value_t>
+            void run(thread_pool *pool, const kernel_t &k, const vec<s, value_t> *in, vec<s, value_t> *out, std::size_t n) {
+                if(n == 0) return;
+                const value_t *in_base = &in[0][0];
+                value_t *out_base = &out[0][0];
+                const value_t *in_components[s];
+                value_t *out_components[s];
+                for(std::size_t c = 0; c < s; c++) {
+                    in_components[c] = in_base + c;
+                    out_components[c] = out_base + c;
+                }
+                run<s>(pool, k, in_components, out_components, n);
+            }
+
+            template <std::size_t s, typename kernel_t, typename value_t>
+            void run(thread_pool *pool, const kernel_t &k, const vec_array<s, value_t> &in, vec_array<s, value_t> &out) {
+                if(&in != &out) out.resize(in.size());
+                const value_t *in_components[s];
+                value_t *out_components[s];
+                for(std::size_t c = 0; c < s; c++) {
+                    in_components[c] = in.component(c);
+                    out_components[c] = out.component(c);
+                }
+                run<1>(pool, k, in_components, out_components, in.size());
+            }
+
+            template <std::size_t n, std::size_t s>
+            struct is_affine : std::integral_constant<bool, n == s + 1> {};
+        };
+    };
+
+    // out[i] = m * in[i]; m is s x s, or (s + 1) x (s + 1) applied with w = 1.
+    template <typename policy, std::size_t n, std::size_t s, typename value_t>
+    auto transform(const policy &p, const matrix<n, n, value_t> &m, const vec<s, value_t> *in, vec<s, value_t> *out, std::size_t count)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+    {
+        static_assert(n == s || n == s + 1, "required: s x s or (s + 1) x (s + 1) matrix");
+        const detail::transform::kernel<s, s, detail::transform::is_affine<n, s>::value, false, value_t> k(m);
+        detail::transform::run(execution::pool_of(p), k, in, out, count);
+    }
+
+    template <std::size_t n, std::size_t s, typename value_t>
+    void transform(const matrix<n, n, value_t> &m, const vec<s, value_t> *in, vec<s, value_t> *out, std::size_t count) {
+        transform(execution::seq, m, in, out, count);
+    }
+
+    // in place
+    template <std::size_t n, std::size_t s, typename value_t>
+    void transform(const matrix<n, n, value_t> &m, vec<s, value_t> *points, std::size_t count) {
+        transform(execution::seq, m, points, points, count);
+    }
+
+    template <typename policy, std::size_t n, std::size_t s, typename value_t>
+    auto transform(const policy &p, const matrix<n, n, value_t> &m, const vec_array<s, value_t> &in, vec_array<s, value_t> &out)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+    {
+        static_assert(n == s || n == s + 1, "required: s x s or (s + 1) x (s + 1) matrix");
+        const detail::transform::kernel<s, s, detail::transform::is_affine<n, s>::value, false, value_t> k(m);
+        detail::transform::run(execution::pool_of(p), k, in, out);
+    }
+
+    // out may be in; it is resized to in.size().
+    template <std::size_t n, std::size_t s, typename value_t>
+    void transform(const matrix<n, n, value_t> &m, const vec_array<s, value_t> &in, vec_array<s, value_t> &out) {
+        transform(execution::seq, m, in, out);
+    }
+
+    // out[i] = (m * (in[i], 1)).xyz / w for a (s + 1) x (s + 1) projective m.
+    template <typename policy, std::size_t n, std::size_t s, typename value_t>
+    auto transform_homogeneous(const policy &p, const matrix<n, n, value_t> &m, const vec<s, value_t> *in, vec<s, value_t> *out, std::size_t count)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+    {
+        static_assert(n == s + 1, "required: (s + 1) x (s + 1) matrix");
+        const detail::transform::kernel<s, s, true, true, value_t> k(m);
+        detail::transform::run(execution::pool_of(p), k, in, out, count);
+    }
+
+    template <std::size_t n, std::size_t s, typename value_t>
+    void transform_homogeneous(const matrix<n, n, value_t> &m, const vec<s, value_t> *in, vec<s, value_t> *out, std::size_t count) {
+        transform_homogeneous(execution::seq, m, in, out, count);
+    }
+
+    template <std::size_t n, std::size_t s, typename value_t>
+    void transform_homogeneous(const matrix<n, n, value_t> &m, vec<s, value_t> *points, std::size_t count) {
+        transform_homogeneous(execution::seq, m, points, points, count);
+    }
+
+    template <typename policy, std::size_t n, std::size_t s, typename value_t>
+    auto transform_homogeneous(const policy &p, const matrix<n, n, value_t> &m, const vec_array<s, value_t> &in, vec_array<s, value_t> &out)
+    -> typename std::enable_if<execution::is_execution_policy<policy>::value>::type
+    {
+        static_assert(n == s + 1, "required: (s + 1) x (s + 1) matrix");
+        const detail::transform::kernel<s, s, true, true, value_t> k(m);
+        detail::transform::run(execution::pool_of(p), k, in, out);
+    }
+
+    template <std::size_t n, std::size_t s, typename value_t>
+    void transform_homogeneous(const matrix<n, n, value_t> &m, const vec_array<s, value_t> &in, vec_array<s, value_t> &out) {
+        transform_homogeneous(execution::seq, m, in, out);
+    }
+};
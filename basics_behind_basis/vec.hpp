@@ -19,27 +19,35 @@
 #include <array>
 #include <cmath>
 
+#include "expression.hpp"
+#include "simd.hpp"
+#include "numeric.hpp"
+#include "reduction.hpp"
+
 namespace bbb {
     template <std::size_t s, typename value_t = double>
-    struct base_vec {
-        static_assert(std::is_arithmetic<value_t>::value, "required: value_t is arithmetic type");
+    struct base_vec : vec_expression_tag {
+        static_assert(is_numeric<value_t>::value, "required: value_t is arithmetic type, half or bfloat16");
         using value_type = value_t;
+        static constexpr std::size_t extent = s;
         
-        base_vec()
-        : data() {}
+        base_vec() { data.fill(value_t()); }
         
-        base_vec(const base_vec &v)
-        : data(v.data) {}
+        base_vec(const base_vec &v) = default;
         
-        template <typename argument, typename ... arguments, typename std::enable_if<std::is_arithmetic<argument>::value>::type *_ = nullptr>
-        base_vec(argument arg, arguments ... args)
-        : data({static_cast<value_t>(arg), static_cast<value_t>(args) ...}) {}
+        template <typename argument, typename ... arguments, typename std::enable_if<is_numeric<argument>::value>::type *_ = nullptr>
+        base_vec(argument arg, arguments ... args) {
+            data = {{static_cast<value_t>(arg), static_cast<value_t>(args) ...}};
+        }
         
         template <std::size_t s_, typename value_t_>
         base_vec(const base_vec<s_, value_t_> &v) {
             for(std::size_t i = 0, end = std::min(s, s_); i < end; i++) data[i] = v[i];
         }
         
+        template <typename expression, typename std::enable_if<is_vec_expression<expression>::value && !std::is_base_of<base_vec, expression>::value>::type * = nullptr>
+        base_vec(const expression &e) { assign(e); }
+        
         constexpr std::size_t size() const { return s; }
         
         value_t &operator[](std::size_t index) { return data[index]; }
@@ -48,50 +56,49 @@ namespace bbb {
         value_t &at(std::size_t index) { return data.at(index); }
         constexpr const value_t &at(std::size_t index) const { return data.at(index); }
         
-        base_vec &operator=(const base_vec &v) { data = v.data; }
-        base_vec &operator=(const std::array<value_t, s> &v) { data = v; }
+        base_vec &operator=(const base_vec &v) = default;
+        base_vec &operator=(const std::array<value_t, s> &v) { data = v; return *this; }
         base_vec &operator=(value_type x) {
             for(std::size_t i = 0; i < size(); i++) data[i] = x;
+            return *this;
         }
         template <std::size_t s_, typename value_t_>
         base_vec &operator=(const base_vec<s_, value_t_> &v) {
-            for(std::size_t i = 0, end = std::min(s, s_); i < end; i++) data[i] = v.data[i];
+            for(std::size_t i = 0, end = std::min(s, s_); i < end; i++) data[i] = v[i];
             return *this;
         }
+        template <typename expression>
+        auto operator=(const expression &e)
+        -> typename std::enable_if<is_vec_expression<expression>::value && !std::is_base_of<base_vec, expression>::value, base_vec &>::type
+        { return assign(e); }
         
         constexpr const base_vec &operator+() const { return *this; }
         
-        constexpr_14 base_vec operator-() const {
-            base_vec v0;
-            for(std::size_t i = 0; i < size(); i++) v0 = -data[i];
-            return v0;
-        }
-        
-        constexpr_14 base_vec operator+(const base_vec &v) const { return base_vec{*this} += v; }
-        base_vec &operator+=(const base_vec &v) {
-            for(std::size_t i = 0; i < size(); i++) data[i] += v[i];
-            return *this;
+        template <typename expression>
+        auto operator+=(const expression &v)
+        -> typename std::enable_if<is_vec_expression<expression>::value, base_vec &>::type
+        {
+            static_assert(expression::extent == s, "required: operands have same size");
+            return add_assign(v, std::is_base_of<base_vec, expression>{});
         }
         
-        constexpr_14 base_vec operator-(const base_vec &v) const { return base_vec{*this} -= v; }
-        base_vec &operator-=(const base_vec &v) {
-            for(std::size_t i = 0; i < size(); i++) data[i] -= v[i];
-            return *this;
+        template <typename expression>
+        auto operator-=(const expression &v)
+        -> typename std::enable_if<is_vec_expression<expression>::value, base_vec &>::type
+        {
+            static_assert(expression::extent == s, "required: operands have same size");
+            return sub_assign(v, std::is_base_of<base_vec, expression>{});
         }
         
-        constexpr_14 value_t dot(const base_vec &v) const {
-            value_t sum{0.0};
-            for(std::size_t i = 0; i < size(); i++) sum += data[i] * v[i];
-            return sum;
+        compute_t<value_t> dot(const base_vec &v) const {
+            return reduction::dot(data.data(), v.data.data(), s);
         }
         
-        constexpr_14 base_vec operator*(value_t scale) const { return base_vec{*this} *= scale; }
         base_vec &operator*=(value_t scale) {
-            for(std::size_t i = 0; i < size(); i++) data[i] *= scale;
+            simd::scale(data.data(), scale, s);
             return *this;
         }
         
-        constexpr_14 base_vec operator/(value_t scale) const { return base_vec{*this} /= scale; }
         base_vec &operator/=(value_t scale) {
             for(std::size_t i = 0; i < size(); i++) data[i] *= 1.0 / scale;
             return *this;
@@ -108,9 +115,30 @@ namespace bbb {
         constexpr bool operator>=(const base_vec &v) const { return data >= v.data; }
         void swap(base_vec &v) { std::swap(data, v.data); }
         
-        constexpr_14 double distance(const base_vec &rhs) const {
-            auto v = *this - rhs;
-            return sqrt(v.dot(v));
+        double norm() const {
+            return reduction::p_norm<2>(data.data(), s);
+        }
+        
+        double distance(const base_vec &rhs) const {
+            return std::sqrt(reduction::squared_distance(data.data(), rhs.data.data(), s));
+        }
+        
+        compute_t<value_t> squared_norm() const {
+            return reduction::power_sum<2>(data.data(), s);
+        }
+        
+        compute_t<value_t> squared_distance(const base_vec &rhs) const {
+            return reduction::squared_distance(data.data(), rhs.data.data(), s);
+        }
+        
+        template <std::size_t p>
+        double p_norm() const {
+            return reduction::p_norm<p>(data.data(), s);
+        }
+        
+        template <std::size_t p>
+        double p_distance(const base_vec &rhs) const {
+            return reduction::p_distance<p>(data.data(), rhs.data.data(), s);
         }
         
         using iterator = typename std::array<value_t, s>::iterator;
@@ -132,16 +160,38 @@ namespace bbb {
         const_reverse_iterator crbegin() const { return data.crbegin(); }
         const_reverse_iterator crend()   const { return data.crend(); }
         
-        friend base_vec operator*(value_t scale, const base_vec &v);
     protected:
         std::array<value_t, s> data;
+        
+    private:
+        template <typename expression>
+        base_vec &add_assign(const expression &v, std::false_type) {
+            for(std::size_t i = 0; i < size(); i++) data[i] += v[i];
+            return *this;
+        }
+        base_vec &add_assign(const base_vec &v, std::true_type) {
+            simd::add(data.data(), v.data.data(), s);
+            return *this;
+        }
+        
+        template <typename expression>
+        base_vec &sub_assign(const expression &v, std::false_type) {
+            for(std::size_t i = 0; i < size(); i++) data[i] -= v[i];
+            return *this;
+        }
+        base_vec &sub_assign(const base_vec &v, std::true_type) {
+            simd::sub(data.data(), v.data.data(), s);
+            return *this;
+        }
+        
+        template <typename expression>
+        base_vec &assign(const expression &e) {
+            static_assert(expression::extent == s, "required: operands have same size");
+            for(std::size_t i = 0; i < size(); i++) data[i] = e[i];
+            return *this;
+        }
     };
     
-    template <std::size_t s, typename value_t = double>
-    base_vec<s, value_t> operator*(value_t scale, const base_vec<s, value_t> &v) {
-        return v * s;
-    }
-    
     template <std::size_t s, typename value_t = double>
     struct vec : base_vec<s, value_t> {
         vec() : base_vec<s, value_t>() {};
@@ -151,80 +201,92 @@ namespace bbb {
     
     template <typename value_t>
     struct vec<2, value_t> : base_vec<2, value_t> {
-        value_t &x, &y;
+        // named components read and write through data, so there is one
+        // active member and no type punning.
+        value_t &x() { return this->data[0]; }
+        constexpr const value_t &x() const { return this->data[0]; }
+        value_t &y() { return this->data[1]; }
+        constexpr const value_t &y() const { return this->data[1]; }
         
         vec(const base_vec<2, value_t> &mom)
-        : base_vec<2, value_t>(mom)
-        , x(data[0])
-        , y(data[1]) {};
+        : base_vec<2, value_t>(mom) {};
         
         vec(value_t x = 0, value_t y = 0)
-        : base_vec<2, value_t>(x, y)
-        , x(data[0])
-        , y(data[1]) {};
+        : base_vec<2, value_t>(x, y) {};
+        
+        template <typename expression, typename std::enable_if<is_vec_expression<expression>::value && !std::is_base_of<base_vec<2, value_t>, expression>::value>::type * = nullptr>
+        vec(const expression &e)
+        : base_vec<2, value_t>(e) {};
         
         template <std::size_t s_, typename value_t_>
         vec(const vec<s_, value_t_> &v)
-        : base_vec<2, value_t>(static_cast<base_vec<s_, value_t>>(v))
-        , x(data[0])
-        , y(data[1]) {};
-        
-        inline vec &operator=(const vec &v) { data = v.data; };
-        
-    private:
-        using base_vec<2, value_t>::data;
+        : base_vec<2, value_t>(static_cast<base_vec<s_, value_t>>(v)) {};
     };
     
     template <typename value_t>
     struct vec<3, value_t> : base_vec<3, value_t> {
-        value_t &x, &y, &z;
+        value_t &x() { return this->data[0]; }
+        constexpr const value_t &x() const { return this->data[0]; }
+        value_t &y() { return this->data[1]; }
+        constexpr const value_t &y() const { return this->data[1]; }
+        value_t &z() { return this->data[2]; }
+        constexpr const value_t &z() const { return this->data[2]; }
+        
+        vec(const base_vec<3, value_t> &mom)
+        : base_vec<3, value_t>(mom) {};
         
         vec(value_t x = 0, value_t y = 0, value_t z = 0)
-        : base_vec<3, value_t>(x, y, z)
-        , x(data[0])
-        , y(data[1])
-        , z(data[2]) {}
+        : base_vec<3, value_t>(x, y, z) {}
         
-        operator base_vec<3, value_t> &() { return *this; }
-        operator const base_vec<3, value_t> &() const { return *this; }
+        template <typename expression, typename std::enable_if<is_vec_expression<expression>::value && !std::is_base_of<base_vec<3, value_t>, expression>::value>::type * = nullptr>
+        vec(const expression &e)
+        : base_vec<3, value_t>(e) {};
         
         template <std::size_t s_, typename value_t_>
         vec(const vec<s_, value_t_> &v)
-        : base_vec<3, value_t>(static_cast<base_vec<s_, value_t>>(v))
-        , x(data[0])
-        , y(data[1])
-        , z(data[2]) {};
-        
-        inline vec &operator=(const vec &v) { data = v.data; };
-        
-    private:
-        using base_vec<3, value_t>::data;
+        : base_vec<3, value_t>(static_cast<base_vec<s_, value_t>>(v)) {};
     };
     
     template <typename value_t>
     struct vec<4, value_t> : base_vec<4, value_t> {
-        value_t &x, &y, &z, &w;
+        value_t &x() { return this->data[0]; }
+        constexpr const value_t &x() const { return this->data[0]; }
+        value_t &y() { return this->data[1]; }
+        constexpr const value_t &y() const { return this->data[1]; }
+        value_t &z() { return this->data[2]; }
+        constexpr const value_t &z() const { return this->data[2]; }
+        value_t &w() { return this->data[3]; }
+        constexpr const value_t &w() const { return this->data[3]; }
+        
+        vec(const base_vec<4, value_t> &mom)
+        : base_vec<4, value_t>(mom) {};
         
         vec(value_t x = 0, value_t y = 0, value_t z = 0, value_t w = 0)
-        : base_vec<4, value_t>(x, y, z, w)
-        , x(data[0])
-        , y(data[1])
-        , z(data[2])
-        , w(data[3]) {}
+        : base_vec<4, value_t>(x, y, z, w) {}
+        
+        template <typename expression, typename std::enable_if<is_vec_expression<expression>::value && !std::is_base_of<base_vec<4, value_t>, expression>::value>::type * = nullptr>
+        vec(const expression &e)
+        : base_vec<4, value_t>(e) {};
         
         template <std::size_t s_, typename value_t_>
         vec(const vec<s_, value_t_> &v)
-        : base_vec<4, value_t>(static_cast<base_vec<s_, value_t>>(v))
-        , x(data[0])
-        , y(data[1])
-        , z(data[2])
-        , w(data[3]) {};
-        
-        inline vec &operator=(const vec &v) { data = v.data; };
-        
-    private:
-        using base_vec<4, value_t>::data;
+        : base_vec<4, value_t>(static_cast<base_vec<s_, value_t>>(v)) {};
     };
+    
+    // named components must not cost anything: vec<N, T> is exactly N packed T,
+    // so arrays of them can be memcpy'd, SIMD-loaded or uploaded as they are.
+#define BBB_VEC_LAYOUT_ASSERT(n, value_t) \
+    static_assert(sizeof(vec<n, value_t>) == n * sizeof(value_t), "required: vec<" #n ", " #value_t "> has no padding"); \
+    static_assert(std::is_standard_layout<vec<n, value_t>>::value, "required: vec<" #n ", " #value_t "> is standard layout"); \
+    static_assert(std::is_trivially_copyable<vec<n, value_t>>::value, "required: vec<" #n ", " #value_t "> is trivially copyable");
+    
+    BBB_VEC_LAYOUT_ASSERT(2, float)
+    BBB_VEC_LAYOUT_ASSERT(3, float)
+    BBB_VEC_LAYOUT_ASSERT(4, float)
+    BBB_VEC_LAYOUT_ASSERT(2, double)
+    BBB_VEC_LAYOUT_ASSERT(3, double)
+    BBB_VEC_LAYOUT_ASSERT(4, double)
+#undef BBB_VEC_LAYOUT_ASSERT
 };
 
 #include <iostream>
@@ -0,0 +1,258 @@
+//
+//  vec_array.hpp
+//
+//  structure-of-arrays container of vec<s>. every component lives in its
+//  own cache line aligned array, so batched kernels run over contiguous
+//  lanes and vectorize instead of striding through vec<s> structs.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include "vec.hpp"
+#include "aligned_allocator.hpp"
+
+namespace bbb {
+    template <std::size_t s, typename value_t = double>
+    struct vec_array;
+
+    // proxy returned by vec_array::operator[]; reads and writes like vec<s>
+    // and takes part in vec expressions, so vec<s> v = points[i] + offset; works.
+    template <std::size_t s, typename value_t>
+    struct vec_array_reference : vec_expression_tag {
+        using value_type = value_t;
+        static constexpr std::size_t extent = s;
+
+        vec_array_reference(const std::array<value_t *, s> &elements)
+        : elements(elements) {}
+
+        vec_array_reference(const vec_array_reference &) = default;
+
+        constexpr std::size_t size() const { return s; }
+
+        value_t &operator[](std::size_t index) const { return *elements[index]; }
+
+        // named components, like vec<2>, vec<3>, vec<4>.
+        value_t &x() const { static_assert(s <= 4, "required: s <= 4"); return *elements[0]; }
+        value_t &y() const { static_assert(2 <= s && s <= 4, "required: 2 <= s <= 4"); return *elements[1]; }
+        value_t &z() const { static_assert(3 <= s && s <= 4, "required: 3 <= s <= 4"); return *elements[2]; }
+        value_t &w() const { static_assert(s == 4, "required: s == 4"); return *elements[3]; }
+
+        vec<s, value_t> eval() const { return *this; }
+
+        const vec_array_reference &operator=(const base_vec<s, value_t> &v) const {
+            for(std::size_t k = 0; k < s; k++) *elements[k] = v[k];
+            return *this;
+        }
+        const vec_array_reference &operator=(const vec_array_reference &v) const {
+            for(std::size_t k = 0; k < s; k++) *elements[k] = v[k];
+            return *this;
+        }
+        const vec_array_reference &operator+=(const base_vec<s, value_t> &v) const {
+            for(std::size_t k = 0; k < s; k++) *elements[k] += v[k];
+            return *this;
+        }
+        const vec_array_reference &operator-=(const base_vec<s, value_t> &v) const {
+            for(std::size_t k = 0; k < s; k++) *elements[k] -= v[k];
+            return *this;
+        }
+        const vec_array_reference &operator*=(value_t scale) const {
+            for(std::size_t k = 0; k < s; k++) *elements[k] *= scale;
+            return *this;
+        }
+
+    private:
+        std::array<value_t *, s> elements;
+    };
+
+    template <std::size_t s, typename value_t>
+    struct vec_array {
+        using value_type = vec<s, value_t>;
+        using component_type = value_t;
+        using component_container = std::vector<value_t, aligned_allocator<value_t>>;
+        using reference = vec_array_reference<s, value_t>;
+        using const_reference = vec<s, value_t>;
+
+        vec_array() = default;
+        explicit vec_array(std::size_t size, const base_vec<s, value_t> &v = base_vec<s, value_t>()) {
+            for(std::size_t k = 0; k < s; k++) components[k].assign(size, v[k]);
+        }
+        template <typename vec_t, typename allocator>
+        explicit vec_array(const std::vector<vec_t, allocator> &vs) {
+            reserve(vs.size());
+            for(const auto &v : vs) push_back(v);
+        }
+
+        constexpr std::size_t dimension() const { return s; }
+        std::size_t size() const { return components[0].size(); }
+        bool empty() const { return components[0].empty(); }
+
+        void reserve(std::size_t size) { for(auto &c : components) c.reserve(size); }
+        void resize(std::size_t size) { for(auto &c : components) c.resize(size); }
+        void clear() { for(auto &c : components) c.clear(); }
+
+        void push_back(const base_vec<s, value_t> &v) {
+            for(std::size_t k = 0; k < s; k++) components[k].push_back(v[k]);
+        }
+
+        reference operator[](std::size_t index) {
+            std::array<value_t *, s> elements;
+            for(std::size_t k = 0; k < s; k++) elements[k] = components[k].data() + index;
+            return reference(elements);
+        }
+        const_reference operator[](std::size_t index) const {
+            const_reference v;
+            for(std::size_t k = 0; k < s; k++) v[k] = components[k][index];
+            return v;
+        }
+
+        value_t *component(std::size_t k) { return components[k].data(); }
+        const value_t *component(std::size_t k) const { return components[k].data(); }
+
+        std::vector<vec<s, value_t>> to_vector() const {
+            std::vector<vec<s, value_t>> vs(size());
+            for(std::size_t k = 0; k < s; k++) {
+                const value_t *c = component(k);
+                for(std::size_t i = 0; i < vs.size(); i++) vs[i][k] = c[i];
+            }
+            return vs;
+        }
+
+        // out[i] = (*this)[i] . rhs[i]
+        void dot(const vec_array &rhs, value_t *out) const {
+            const std::size_t n = size();
+            std::fill(out, out + n, value_t(0));
+            for(std::size_t k = 0; k < s; k++) {
+                const value_t *a = component(k), *b = rhs.component(k);
+                for(std::size_t i = 0; i < n; i++) out[i] += a[i] * b[i];
+            }
+        }
+
+        // out[i] = (*this)[i] . v
+        void dot(const base_vec<s, value_t> &v, value_t *out) const {
+            const std::size_t n = size();
+            std::fill(out, out + n, value_t(0));
+            for(std::size_t k = 0; k < s; k++) {
+                const value_t *a = component(k);
+                const value_t b = v[k];
+                for(std::size_t i = 0; i < n; i++) out[i] += a[i] * b;
+            }
+        }
+
+        // out[i] = |(*this)[i]|^2
+        void squared_norm(value_t *out) const {
+            const std::size_t n = size();
+            std::fill(out, out + n, value_t(0));
+            for(std::size_t k = 0; k < s; k++) {
+                const value_t *a = component(k);
+                for(std::size_t i = 0; i < n; i++) out[i] += a[i] * a[i];
+            }
+        }
+
+        // out[i] = |(*this)[i]|
+        void norm(value_t *out) const {
+            squared_norm(out);
+            for(std::size_t i = 0, n = size(); i < n; i++) out[i] = std::sqrt(out[i]);
+        }
+
+        // out[i] = |(*this)[i] - query|^2
+        void squared_distance(const base_vec<s, value_t> &query, value_t *out) const {
+            const std::size_t n = size();
+            std::fill(out, out + n, value_t(0));
+            for(std::size_t k = 0; k < s; k++) {
+                const value_t *a = component(k);
+                const value_t q = query[k];
+                for(std::size_t i = 0; i < n; i++) {
+                    const value_t d = a[i] - q;
+                    out[i] += d * d;
+                }
+            }
+        }
+
+        // out[i] = |(*this)[i] - query|
+        void distance(const base_vec<s, value_t> &query, value_t *out) const {
+            squared_distance(query, out);
+            for(std::size_t i = 0, n = size(); i < n; i++) out[i] = std::sqrt(out[i]);
+        }
+
+        // (*this)[i] += alpha * x[i]
+        vec_array &axpy(value_t alpha, const vec_array &x) {
+            const std::size_t n = size();
+            for(std::size_t k = 0; k < s; k++) {
+                value_t *y = component(k);
+                const value_t *b = x.component(k);
+                for(std::size_t i = 0; i < n; i++) y[i] += alpha * b[i];
+            }
+            return *this;
+        }
+
+        // (*this)[i] *= scale
+        vec_array &scale(value_t scale) {
+            for(std::size_t k = 0; k < s; k++) simd::scale(component(k), scale, size());
+            return *this;
+        }
+
+        // (*this)[i] += offset
+        vec_array &translate(const base_vec<s, value_t> &offset) {
+            const std::size_t n = size();
+            for(std::size_t k = 0; k < s; k++) {
+                value_t *a = component(k);
+                const value_t o = offset[k];
+                for(std::size_t i = 0; i < n; i++) a[i] += o;
+            }
+            return *this;
+        }
+
+        vec<s, value_t> sum() const {
+            vec<s, value_t> res;
+            for(std::size_t k = 0; k < s; k++) res[k] = reduce(component(k), value_t(0), [](value_t a, value_t b) { return a + b; });
+            return res;
+        }
+
+        // component-wise minimum, i.e. the lower corner of the bounding box
+        vec<s, value_t> min() const {
+            vec<s, value_t> res;
+            for(std::size_t k = 0; k < s; k++) res[k] = reduce(component(k), std::numeric_limits<value_t>::max(), [](value_t a, value_t b) { return b < a ? b : a; });
+            return res;
+        }
+
+        // component-wise maximum, i.e. the upper corner of the bounding box
+        vec<s, value_t> max() const {
+            vec<s, value_t> res;
+            for(std::size_t k = 0; k < s; k++) res[k] = reduce(component(k), std::numeric_limits<value_t>::lowest(), [](value_t a, value_t b) { return a < b ? b : a; });
+            return res;
+        }
+
+        // index of the element closest to query, or size() if empty
+        std::size_t nearest(const base_vec<s, value_t> &query) const {
+            std::vector<value_t, aligned_allocator<value_t>> d(size());
+            squared_distance(query, d.data());
+            return std::min_element(d.begin(), d.end()) - d.begin();
+        }
+
+    private:
+        // four independent lanes so the reduction does not serialize on one register.
+        template <typename op_t>
+        value_t reduce(const value_t *a, value_t init, op_t op) const {
+            value_t acc[4] = {init, init, init, init};
+            const std::size_t n = size();
+            std::size_t i = 0;
+            for(; i + 4 <= n; i += 4) {
+                acc[0] = op(acc[0], a[i + 0]);
+                acc[1] = op(acc[1], a[i + 1]);
+                acc[2] = op(acc[2], a[i + 2]);
+                acc[3] = op(acc[3], a[i + 3]);
+            }
+            for(; i < n; i++) acc[0] = op(acc[0], a[i]);
+            return op(op(acc[0], acc[1]), op(acc[2], acc[3]));
+        }
+
+        std::array<component_container, s> components;
+    };
+};
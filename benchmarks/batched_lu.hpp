@@ -0,0 +1,55 @@
+//
+// batched_lu.hpp
+//
+// factor + solve of many independent small systems: one lu_factorization
+// per system against the interleaved batched_lu.
+//
+
+#pragma once
+
+#include "./harness.hpp"
+
+#include <batched_lu.hpp>
+#include <lu_factorization.hpp>
+#include <vector>
+
+namespace bbb_benchmark {
+    namespace batched_lu {
+        template <std::size_t n, typename value_t>
+        void run(harness &h) {
+            const char *type = type_name<value_t>();
+            const std::size_t count = 4096;
+            std::vector<bbb::matrix<n, n, value_t>> systems(count);
+            std::vector<bbb::column_vector<n, value_t>> rhs(count);
+            bbb::matrix_batch<n, value_t> a(count);
+            bbb::vec_batch<n, value_t> b(count);
+            for(std::size_t s = 0; s < count; s++) {
+                for(std::size_t i = 0; i < n; i++) {
+                    for(std::size_t j = 0; j < n; j++) systems[s](i, j) = value_t((s + i * 7 + j * 3) % 11) + (i == j ? value_t(n) : value_t(0));
+                    rhs[s][i] = value_t(i + 1);
+                    b(s, i) = rhs[s][i];
+                }
+                a.set(s, systems[s]);
+            }
+            const double flops = count * (2.0 / 3.0 * n * n * n + 2.0 * n * n);
+            const double bytes = count * (n * n + 2.0 * n) * sizeof(value_t);
+
+            bbb::lu_factorization<bbb::matrix<n, n, value_t>> single;
+            h.run("batched_lu::per_system", type, n, flops, bytes, [&] {
+                for(std::size_t s = 0; s < count; s++) do_not_optimize(single.factorize(systems[s]).solve(rhs[s]));
+            });
+            bbb::batched_lu<n, value_t> batched;
+            h.run("batched_lu::interleaved", type, n, flops, bytes, [&] {
+                do_not_optimize(batched.factorize(a).solve(b));
+            });
+        }
+
+        void run(harness &h) {
+            run<3, double>(h);
+            run<4, double>(h);
+            run<8, double>(h);
+            run<4, float>(h);
+            run<8, float>(h);
+        }
+    };
+}
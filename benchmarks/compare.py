@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""compare two JSON files written by `benchmarks --json` and flag regressions.
+
+usage: compare.py baseline.json current.json [--threshold 0.05] [--metric ns_per_op]
+
+a case regresses when it got slower by more than threshold (relative):
+ns_per_op grew, or gflops / bytes_per_second dropped.
+exit status is 1 if any case regressed, 0 otherwise.
+"""
+
+import argparse
+import json
+import sys
+
+# metrics where a larger value is better; for these a drop is a slowdown.
+higher_is_better = {"gflops", "bytes_per_second"}
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {(b["name"], b["type"], b["size"]): b for b in data["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compare two benchmark runs")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="relative slowdown reported as a regression (default 0.05)")
+    parser.add_argument("--metric", default="ns_per_op", choices=["ns_per_op", "gflops", "bytes_per_second"],
+                        help="field compared between the runs (default ns_per_op)")
+    parser.add_argument("--all", action="store_true", help="print unchanged cases too")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    sign = -1.0 if args.metric in higher_is_better else 1.0
+    print("%-36s %-7s %8s %14s %14s %9s" % ("benchmark", "type", "size", "base", "new", "slowdown"))
+    for key in sorted(baseline.keys() & current.keys()):
+        before = baseline[key][args.metric]
+        after = current[key][args.metric]
+        change = sign * (after - before) / before if before > 0 else 0.0
+        if change > args.threshold:
+            mark = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            mark = "improved"
+        else:
+            mark = ""
+        if mark or args.all:
+            print("%-36s %-7s %8d %14.2f %14.2f %+8.1f%% %s" % (key[0], key[1], key[2], before, after, change * 100.0, mark))
+
+    for key in sorted(baseline.keys() - current.keys()):
+        print("missing in current: %s %s %d" % key)
+    for key in sorted(current.keys() - baseline.keys()):
+        print("new in current: %s %s %d" % key)
+
+    print("%d regression(s) over %.0f%% in %s" % (regressions, args.threshold * 100.0, args.metric))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,152 @@
+//
+// harness.hpp
+//
+// timing loop and result collection for the benchmarks. each case is
+// calibrated until one batch runs for at least min_time seconds; the best
+// of several batches is kept. results are printed as a table and can be
+// written as JSON for benchmarks/compare.py.
+//
+
+#pragma once
+
+#include <simd.hpp>
+#include <thread_pool.hpp>
+
+#include <cstddef>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace bbb_benchmark {
+    struct result {
+        std::string name;
+        std::string type;
+        std::size_t size;
+        std::size_t iterations;
+        double ns_per_op;
+        double gflops;
+        double bytes_per_second;
+    };
+
+    struct options {
+        double min_time = 0.02;
+        std::size_t repetitions = 5;
+        std::string filter;
+        std::string json;
+    };
+
+    template <std::size_t ... sizes>
+    struct size_list {};
+
+    template <typename value_t> inline const char *type_name();
+    template <> inline const char *type_name<float>() { return "float"; }
+    template <> inline const char *type_name<double>() { return "double"; }
+
+    // keeps the compiler from dropping a computation whose result is unused.
+    template <typename value_t>
+    inline void do_not_optimize(const value_t &value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    struct harness {
+        explicit harness(const options &opt)
+        : opt(opt) {}
+
+        // f runs one operation; flops and bytes are counted per operation.
+        template <typename function>
+        void run(const std::string &name, const char *type, std::size_t size, double flops, double bytes, function f) {
+            if(!opt.filter.empty() && name.find(opt.filter) == std::string::npos) return;
+            f();
+            std::size_t iterations = 1;
+            while(true) {
+                const double seconds = time(f, iterations);
+                if(opt.min_time <= seconds) break;
+                const double grow = seconds <= 0.0 ? 10.0 : std::min(10.0, 1.2 * opt.min_time / seconds);
+                iterations = std::max(iterations + 1, static_cast<std::size_t>(iterations * grow));
+            }
+            double best = time(f, iterations);
+            for(std::size_t r = 1; r < opt.repetitions; r++) best = std::min(best, time(f, iterations));
+
+            const double per_op = best / iterations;
+            result res{name, type, size, iterations, per_op * 1e9, flops / per_op * 1e-9, bytes / per_op};
+            report(res);
+            results.push_back(res);
+        }
+
+        // writes every result collected so far; returns false if the file cannot be opened.
+        bool write_json(const std::string &path) const {
+            std::ofstream os(path);
+            if(!os) return false;
+            os << "{\n";
+            os << "  \"version\": 1,\n";
+            os << "  \"context\": {\"isa\": \"" << isa_name() << "\", \"threads\": " << bbb::thread_pool::default_thread_num()
+               << ", \"compiler\": \"" << compiler() << "\"},\n";
+            os << "  \"benchmarks\": [\n";
+            os << std::setprecision(6);
+            for(std::size_t i = 0; i < results.size(); i++) {
+                const result &r = results[i];
+                os << "    {\"name\": \"" << r.name << "\", \"type\": \"" << r.type << "\", \"size\": " << r.size
+                   << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+                   << ", \"gflops\": " << r.gflops << ", \"bytes_per_second\": " << r.bytes_per_second << "}"
+                   << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            os << "  ]\n}\n";
+            return static_cast<bool>(os);
+        }
+
+        static void header() {
+            std::cout << std::left << std::setw(36) << "benchmark" << std::setw(8) << "type"
+                      << std::right << std::setw(8) << "size" << std::setw(14) << "ns/op"
+                      << std::setw(10) << "GFLOP/s" << std::setw(12) << "GB/s" << std::endl;
+        }
+
+    private:
+        template <typename function>
+        static double time(function &f, std::size_t iterations) {
+            const auto start = std::chrono::steady_clock::now();
+            for(std::size_t i = 0; i < iterations; i++) f();
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double>(end - start).count();
+        }
+
+        static void report(const result &r) {
+            std::cout << std::left << std::setw(36) << r.name << std::setw(8) << r.type
+                      << std::right << std::setw(8) << r.size
+                      << std::fixed << std::setw(14) << std::setprecision(2) << r.ns_per_op
+                      << std::setw(10) << std::setprecision(3) << r.gflops
+                      << std::setw(12) << std::setprecision(3) << r.bytes_per_second * 1e-9
+                      << std::defaultfloat << std::endl;
+        }
+
+        static const char *isa_name() {
+            switch(bbb::simd::detected()) {
+                case bbb::simd::instruction_set::avx512: return "avx512";
+                case bbb::simd::instruction_set::avx2: return "avx2";
+                case bbb::simd::instruction_set::sse2: return "sse2";
+                default: return "scalar";
+            }
+        }
+
+        static const char *compiler() {
+#if defined(__clang__)
+            return "clang " __clang_version__;
+#elif defined(__GNUC__)
+            return "gcc " __VERSION__;
+#else
+            return "unknown";
+#endif
+        }
+
+        options opt;
+        std::vector<result> results;
+    };
+}
@@ -0,0 +1,37 @@
+#include "./harness.hpp"
+#include "./matrix.hpp"
+#include "./vec.hpp"
+#include "./vec_layout.hpp"
+#include "./batched_lu.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+// benchmarks [--json path] [--filter substring] [--min-time seconds] [--repetitions n]
+int main(int argc, char *argv[]) {
+    bbb_benchmark::options opt;
+    for(int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if(!std::strcmp(argv[i], "--json") && has_value) opt.json = argv[++i];
+        else if(!std::strcmp(argv[i], "--filter") && has_value) opt.filter = argv[++i];
+        else if(!std::strcmp(argv[i], "--min-time") && has_value) opt.min_time = std::atof(argv[++i]);
+        else if(!std::strcmp(argv[i], "--repetitions") && has_value) opt.repetitions = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "usage: " << argv[0] << " [--json path] [--filter substring] [--min-time seconds] [--repetitions n]" << std::endl;
+            return 1;
+        }
+    }
+
+    bbb_benchmark::harness h(opt);
+    bbb_benchmark::harness::header();
+    bbb_benchmark::matrix::run(h);
+    bbb_benchmark::vec::run(h);
+    bbb_benchmark::vec_layout::run(h);
+    bbb_benchmark::batched_lu::run(h);
+
+    if(!opt.json.empty() && !h.write_json(opt.json)) {
+        std::cerr << "cannot write " << opt.json << std::endl;
+        return 1;
+    }
+    return 0;
+}
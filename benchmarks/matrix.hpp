@@ -0,0 +1,140 @@
+//
+// matrix.hpp
+//
+// fixed size matrix products, a product chain ending in a vector left to
+// right and in the chosen order, transpose and LU against size and value type,
+// and the run time sized product for the sizes that do not fit on the stack,
+// with A^T B through a transposed copy and through a strided view, next to
+// LU, Cholesky and QR of a symmetric positive definite matrix of that size.
+//
+
+#pragma once
+
+#include "./harness.hpp"
+
+#include <matrix.hpp>
+#include <dynamic_matrix.hpp>
+#include <lu_factorization.hpp>
+#include <cholesky_factorization.hpp>
+#include <qr_factorization.hpp>
+#include <memory>
+
+namespace bbb_benchmark {
+    namespace matrix {
+        template <std::size_t n, typename value_t>
+        void fill(bbb::matrix<n, n, value_t> &m) {
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) m[i][j] = value_t((i * 7 + j * 3) % 11) + (i == j ? value_t(n) : value_t(0));
+            }
+        }
+
+        template <std::size_t n, typename value_t>
+        void run(harness &h) {
+            using matrix_t = bbb::matrix<n, n, value_t>;
+            const char *type = type_name<value_t>();
+            const double element = sizeof(value_t);
+            std::unique_ptr<matrix_t> a(new matrix_t), b(new matrix_t), l(new matrix_t), u(new matrix_t);
+            fill(*a);
+            fill(*b);
+
+            h.run("matrix::operator*", type, n, 2.0 * n * n * n, 3.0 * n * n * element, [&] {
+                do_not_optimize(*a);
+                do_not_optimize(((*a) * (*b)).eval());
+            });
+            std::unique_ptr<bbb::matrix<n, 1, value_t>> x(new bbb::matrix<n, 1, value_t>);
+            for(std::size_t i = 0; i < n; i++) (*x)[i][0] = value_t(i % 5);
+            h.run("matrix::chain left to right", type, n, 4.0 * n * n * n + 2.0 * n * n, 3.0 * n * n * element, [&] {
+                do_not_optimize(*a);
+                do_not_optimize(((((*a) * (*b)).eval() * (*a)).eval() * (*x)).eval());
+            });
+            h.run("matrix::chain a * b * a * x", type, n, 6.0 * n * n, 2.0 * n * n * element, [&] {
+                do_not_optimize(*a);
+                do_not_optimize(((*a) * (*b) * (*a) * (*x)).eval());
+            });
+            h.run("matrix::transpose", type, n, 0.0, 2.0 * n * n * element, [&] {
+                do_not_optimize(*a);
+                do_not_optimize(a->transpose());
+            });
+            h.run("matrix::lu_decomposition", type, n, 2.0 / 3.0 * n * n * n, 3.0 * n * n * element, [&] {
+                do_not_optimize(*a);
+                a->lu_decomposition(*l, *u);
+                do_not_optimize(*u);
+            });
+            bbb::lu_factorization<matrix_t> lu;
+            h.run("lu_factorization::factorize", type, n, 2.0 / 3.0 * n * n * n, 2.0 * n * n * element, [&] {
+                do_not_optimize(*a);
+                lu.factorize(*a);
+                do_not_optimize(lu);
+            });
+        }
+
+        template <typename value_t>
+        void run_dynamic(harness &h, std::size_t n) {
+            const char *type = type_name<value_t>();
+            const double element = sizeof(value_t);
+            bbb::dynamic_matrix<value_t> a(n, n), b(n, n);
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) a[i][j] = b[j][i] = value_t((i * 7 + j * 3) % 11);
+            }
+            h.run("dynamic_matrix::operator*", type, n, 2.0 * n * n * n, 3.0 * n * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(a * b);
+            });
+            h.run("dynamic_matrix::multiply(par)", type, n, 2.0 * n * n * n, 3.0 * n * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(bbb::multiply(bbb::execution::par, a, b));
+            });
+            h.run("dynamic_matrix::transpose()*", type, n, 2.0 * n * n * n, 5.0 * n * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(a.transpose() * b);
+            });
+            h.run("dynamic_matrix::t()*", type, n, 2.0 * n * n * n, 3.0 * n * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(a.t() * b);
+            });
+
+            bbb::dynamic_matrix<value_t> spd(n, n);
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) spd[i][j] = value_t((i * 7 + j * 7) % 11) + (i == j ? value_t(11 * n) : value_t(0));
+            }
+            bbb::lu_factorization<bbb::dynamic_matrix<value_t>> lu;
+            h.run("dynamic lu_factorization::factorize", type, n, 2.0 / 3.0 * n * n * n, 2.0 * n * n * element, [&] {
+                do_not_optimize(spd);
+                lu.factorize(spd);
+                do_not_optimize(lu);
+            });
+            bbb::cholesky_factorization<bbb::dynamic_matrix<value_t>> cholesky;
+            h.run("cholesky_factorization::factorize", type, n, 1.0 / 3.0 * n * n * n, 2.0 * n * n * element, [&] {
+                do_not_optimize(spd);
+                cholesky.factorize(spd);
+                do_not_optimize(cholesky);
+            });
+            h.run("cholesky_factorization::factorize(par)", type, n, 1.0 / 3.0 * n * n * n, 2.0 * n * n * element, [&] {
+                do_not_optimize(spd);
+                cholesky.factorize(bbb::execution::par, spd);
+                do_not_optimize(cholesky);
+            });
+            bbb::qr_factorization<bbb::dynamic_matrix<value_t>> qr;
+            h.run("qr_factorization::factorize", type, n, 4.0 / 3.0 * n * n * n, 2.0 * n * n * element, [&] {
+                do_not_optimize(spd);
+                qr.factorize(spd);
+                do_not_optimize(qr);
+            });
+        }
+
+        template <typename value_t, std::size_t ... sizes>
+        void run_all(harness &h, size_list<sizes ...>) {
+            using expand = int[];
+            (void)expand{0, (run<sizes, value_t>(h), 0) ...};
+        }
+
+        void run(harness &h) {
+            run_all<float>(h, size_list<2, 3, 4, 8, 16, 32, 64, 128>{});
+            run_all<double>(h, size_list<2, 3, 4, 8, 16, 32, 64, 128>{});
+            for(std::size_t n : {256, 512}) {
+                run_dynamic<float>(h, n);
+                run_dynamic<double>(h, n);
+            }
+        }
+    };
+}
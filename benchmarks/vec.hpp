@@ -0,0 +1,71 @@
+//
+// vec.hpp
+//
+// base_vec dot / norm / distance and the p_norm of row_vector / column_vector.
+//
+
+#pragma once
+
+#include "./harness.hpp"
+
+#include <vec.hpp>
+#include <matrix.hpp>
+
+namespace bbb_benchmark {
+    namespace vec {
+        template <std::size_t n, typename value_t>
+        void run(harness &h) {
+            const char *type = type_name<value_t>();
+            const double element = sizeof(value_t);
+            bbb::vec<n, value_t> a, b;
+            for(std::size_t i = 0; i < n; i++) {
+                a[i] = value_t(i + 1);
+                b[i] = value_t(n - i);
+            }
+
+            h.run("base_vec::dot", type, n, 2.0 * n, 2.0 * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(a.dot(b));
+            });
+            h.run("base_vec::norm", type, n, 2.0 * n, 1.0 * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(a.norm());
+            });
+            h.run("base_vec::distance", type, n, 3.0 * n, 2.0 * n * element, [&] {
+                do_not_optimize(a);
+                do_not_optimize(a.distance(b));
+            });
+
+            bbb::row_vector<n, value_t> r;
+            bbb::column_vector<n, value_t> c;
+            for(std::size_t i = 0; i < n; i++) r[i] = c[i] = value_t(i + 1);
+            h.run("row_vector::p_norm(3)", type, n, 3.0 * n, 1.0 * n * element, [&] {
+                do_not_optimize(r);
+                do_not_optimize(r.p_norm(3));
+            });
+            h.run("column_vector::p_norm(3)", type, n, 3.0 * n, 1.0 * n * element, [&] {
+                do_not_optimize(c);
+                do_not_optimize(c.p_norm(3));
+            });
+            h.run("column_vector::p_norm<3>", type, n, 3.0 * n, 1.0 * n * element, [&] {
+                do_not_optimize(c);
+                do_not_optimize(c.template p_norm<3>());
+            });
+            h.run("column_vector::p_distance(3)", type, n, 4.0 * n, 2.0 * n * element, [&] {
+                do_not_optimize(c);
+                do_not_optimize(c.p_distance(c, 3));
+            });
+        }
+
+        template <typename value_t, std::size_t ... sizes>
+        void run_all(harness &h, size_list<sizes ...>) {
+            using expand = int[];
+            (void)expand{0, (run<sizes, value_t>(h), 0) ...};
+        }
+
+        void run(harness &h) {
+            run_all<float>(h, size_list<2, 3, 4, 8, 16, 64, 256>{});
+            run_all<double>(h, size_list<2, 3, 4, 8, 16, 64, 256>{});
+        }
+    };
+}
@@ -0,0 +1,72 @@
+//
+// vec_layout.hpp
+//
+// bulk copy / transform throughput of std::vector<vec<3>> against the
+// former layout, which kept x, y, z as reference members next to the array.
+//
+
+#pragma once
+
+#include "./harness.hpp"
+
+#include <vec.hpp>
+#include <array>
+#include <vector>
+
+namespace bbb_benchmark {
+    namespace vec_layout {
+        template <typename value_t>
+        struct reference_vec3 {
+            std::array<value_t, 3> data;
+            value_t &x, &y, &z;
+
+            reference_vec3(value_t x = 0, value_t y = 0, value_t z = 0)
+            : data({{x, y, z}}), x(data[0]), y(data[1]), z(data[2]) {}
+            reference_vec3(const reference_vec3 &v)
+            : data(v.data), x(data[0]), y(data[1]), z(data[2]) {}
+            reference_vec3 &operator=(const reference_vec3 &v) { data = v.data; return *this; }
+        };
+
+        template <typename value_t>
+        void run(harness &h, std::size_t size) {
+            const char *type = type_name<value_t>();
+            std::vector<reference_vec3<value_t>> ref_src(size), ref_dst(size);
+            std::vector<bbb::vec<3, value_t>> src(size), dst(size);
+            for(std::size_t i = 0; i < size; i++) {
+                ref_src[i] = reference_vec3<value_t>(i, i * 2, i * 3);
+                src[i] = bbb::vec<3, value_t>(i, i * 2, i * 3);
+            }
+            const double payload = size * 3.0 * sizeof(value_t) * 2.0;
+
+            h.run("vec_layout::copy(reference)", type, size, 0.0, payload, [&] {
+                ref_dst = ref_src;
+                do_not_optimize(ref_dst.data());
+            });
+            h.run("vec_layout::copy(packed)", type, size, 0.0, payload, [&] {
+                dst = src;
+                do_not_optimize(dst.data());
+            });
+            h.run("vec_layout::transform(reference)", type, size, 6.0 * size, payload, [&] {
+                for(std::size_t i = 0; i < size; i++) {
+                    ref_dst[i].x = ref_src[i].x * value_t(2) + value_t(1);
+                    ref_dst[i].y = ref_src[i].y * value_t(2) + value_t(1);
+                    ref_dst[i].z = ref_src[i].z * value_t(2) + value_t(1);
+                }
+                do_not_optimize(ref_dst.data());
+            });
+            h.run("vec_layout::transform(packed)", type, size, 6.0 * size, payload, [&] {
+                for(std::size_t i = 0; i < size; i++) {
+                    dst[i].x() = src[i].x() * value_t(2) + value_t(1);
+                    dst[i].y() = src[i].y() * value_t(2) + value_t(1);
+                    dst[i].z() = src[i].z() * value_t(2) + value_t(1);
+                }
+                do_not_optimize(dst.data());
+            });
+        }
+
+        void run(harness &h) {
+            run<float>(h, 1 << 20);
+            run<double>(h, 1 << 20);
+        }
+    };
+}
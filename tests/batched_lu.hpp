@@ -0,0 +1,71 @@
+//
+// batched_lu.hpp
+//
+
+#pragma once
+
+#include <batched_lu.hpp>
+#include <lu_factorization.hpp>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+namespace bbb_test {
+    namespace batched_lu {
+        template <std::size_t n, typename value_t>
+        void check(std::size_t count, value_t tolerance) {
+            std::uint32_t state = 7;
+            const auto next = [&state] {
+                state = state * 1664525u + 1013904223u;
+                return value_t(state >> 8) / value_t(1 << 24) - value_t(0.5);
+            };
+            bbb::matrix_batch<n, value_t> a(count);
+            bbb::vec_batch<n, value_t> b(count);
+            for(std::size_t s = 0; s < count; s++) {
+                for(std::size_t i = 0; i < n; i++) {
+                    for(std::size_t j = 0; j < n; j++) a(s, i, j) = next();
+                    b(s, i) = next();
+                }
+                a(s, 0, 0) = value_t(0); // forces a row exchange
+            }
+            // rank one system: two equal rows
+            for(std::size_t j = 0; j < n; j++) a(1, 1, j) = a(1, 0, j);
+
+            bbb::batched_lu<n, value_t> lu(a);
+            assert(lu.size() == count && lu.is_singular(1) && lu.singular_count() == 1);
+            const bbb::vec_batch<n, value_t> x = lu.solve(b);
+            for(std::size_t s = 0; s < count; s++) {
+                if(s == 1) continue;
+                for(std::size_t i = 0; i < n; i++) {
+                    value_t sum = 0;
+                    for(std::size_t j = 0; j < n; j++) sum += a(s, i, j) * x(s, j);
+                    assert(std::abs(sum - b(s, i)) < tolerance);
+                }
+            }
+
+            // same factors as the single system path
+            bbb::lu_factorization<bbb::matrix<n, n, value_t>> single(a.get(5));
+            const bbb::matrix<n, n, value_t> packed = lu.packed().get(5);
+            for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) assert(std::abs(packed(i, j) - single.packed()(i, j)) < tolerance);
+
+            bbb::thread_pool pool(4);
+            bbb::batched_lu<n, value_t> par(bbb::execution::par.on(pool), a);
+            bbb::vec_batch<n, value_t> y = b;
+            par.solve_in_place(bbb::execution::par.on(pool), y);
+            for(std::size_t s = 0; s < count; s++) if(s != 1) assert(y.get(s) == x.get(s));
+        }
+
+        void test() {
+            check<3, double>(1003, 1e-9);
+            check<8, double>(517, 1e-8);
+            check<4, float>(10000, 2e-2f);
+
+            bbb::vec_batch<3> v(2);
+            v.set(1, bbb::vec<3>(1.0, 2.0, 3.0));
+            assert(v.get(1) == bbb::vec<3>(1.0, 2.0, 3.0) && v.block_count() == 1);
+            bbb::matrix_batch<2> m(3);
+            assert(m(2, 0, 0) == 1.0 && m(2, 0, 1) == 0.0);
+            std::cout << "batched_lu: " << bbb::matrix_batch<3>::lanes << " double / " << bbb::matrix_batch<3, float>::lanes << " float lanes per block" << std::endl;
+        }
+    };
+};
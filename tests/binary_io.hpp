@@ -0,0 +1,90 @@
+//
+// binary_io.hpp
+//
+
+#pragma once
+
+#include <binary_io.hpp>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace bbb_test {
+    namespace binary_io {
+        void test() {
+            const std::string path = "bbb_binary_io_test.bin";
+
+            bbb::matrix<2, 3> f{{{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}}};
+            assert(bbb::write(path, f) == bbb::io_status::ok);
+            {
+                bbb::mapped_matrix<double> mapped;
+                assert(mapped.open(path) == bbb::io_status::ok);
+                const bbb::matrix_view<double> &v = mapped.view();
+                assert(v.row_size() == 2 && v.column_size() == 3 && v(1, 2) == 6.0);
+                assert(reinterpret_cast<std::uintptr_t>(v.data()) % bbb::cache_line_size == 0);
+                bbb::matrix<2, 3> g = v;
+                assert(g == f);
+                bbb::matrix<3, 2> t = f.transpose();
+                assert(v * bbb::dynamic_matrix<>(t) == bbb::dynamic_matrix<>(f * t));
+
+                bbb::mapped_matrix<float> wrong_type;
+                assert(wrong_type.open(path) == bbb::io_status::type_mismatch);
+                bbb::mapped_vec_array<3, double> wrong_kind;
+                assert(wrong_kind.open(path) == bbb::io_status::kind_mismatch);
+            }
+            bbb::matrix<2, 3> h;
+            assert(bbb::read(path, h) == bbb::io_status::ok && h == f);
+            bbb::matrix<3, 3> k;
+            assert(bbb::read(path, k) == bbb::io_status::size_mismatch);
+
+            bbb::dynamic_matrix<float> d(5, 7);
+            for(std::size_t i = 0; i < 5; i++) for(std::size_t j = 0; j < 7; j++) d[i][j] = float(i * 10 + j);
+            assert(bbb::write(path, d) == bbb::io_status::ok);
+            {
+                bbb::mapped_matrix<float> mapped;
+                assert(mapped.open(path) == bbb::io_status::ok);
+                assert(bbb::dynamic_matrix<float>(mapped.view()) == d);
+            }
+
+            bbb::vec_array<3> points;
+            for(std::size_t i = 0; i < 10; i++) points.push_back(bbb::vec<3>(double(i), double(i) * 2.0, -double(i)));
+            assert(bbb::write(path, points) == bbb::io_status::ok);
+            {
+                bbb::mapped_vec_array<3, double> mapped;
+                assert(mapped.open(path) == bbb::io_status::ok);
+                const bbb::vec_array_view<3, double> &v = mapped.view();
+                assert(v.size() == 10 && v[4] == bbb::vec<3>(4.0, 8.0, -4.0));
+                for(std::size_t c = 0; c < 3; c++) assert(reinterpret_cast<std::uintptr_t>(v.component(c)) % bbb::cache_line_size == 0);
+                assert(v.to_vec_array().to_vector() == points.to_vector());
+                bbb::mapped_vec_array<2, double> wrong_size;
+                assert(wrong_size.open(path) == bbb::io_status::size_mismatch);
+            }
+
+            // forged headers: extents whose byte count wraps, and payloads off the layout.
+            const auto forged = [&](std::uint64_t rows, std::uint64_t cols, std::uint64_t ld, std::uint64_t offset) {
+                bbb::binary::header fake = bbb::binary::make_header<double>(bbb::binary::kind::matrix, rows, cols, ld);
+                fake.payload_offset = offset;
+                {
+                    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+                    os.write(reinterpret_cast<const char *>(&fake), sizeof(fake));
+                }
+                bbb::mapped_matrix<double> mapped;
+                const bbb::io_status status = mapped.open(path);
+                assert(status == bbb::io_status::ok || mapped.view().empty());
+                return status;
+            };
+            assert(forged(std::uint64_t(1) << 61, 1, 1, 64) == bbb::io_status::truncated);
+            assert(forged(3, std::uint64_t(1) << 62, std::uint64_t(1) << 62, 64) == bbb::io_status::truncated);
+            assert(forged(1, 1, 1, 1024) == bbb::io_status::truncated);
+            assert(forged(1, 1, 1, 96) == bbb::io_status::bad_layout);
+            assert(forged(1, 4, 2, 64) == bbb::io_status::bad_layout);
+            assert(forged(0, 4, 4, 64) == bbb::io_status::ok);
+
+            bbb::mapped_matrix<double> missing;
+            assert(missing.open("bbb_binary_io_missing.bin") == bbb::io_status::open_failed);
+            std::remove(path.c_str());
+        }
+    };
+};
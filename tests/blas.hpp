@@ -0,0 +1,120 @@
+//
+// blas.hpp
+//
+
+#pragma once
+
+#include <blas.hpp>
+#include <matrix.hpp>
+#include <dynamic_matrix.hpp>
+#include <vec.hpp>
+#include <thread_pool.hpp>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "./helpers.hpp"
+
+namespace bbb_test {
+    namespace blas {
+        void test_axpy_gemv() {
+            std::vector<double> x{1.0, 2.0, 3.0}, y{10.0, 20.0, 30.0};
+            bbb::blas::axpy(2.0, x, y);
+            assert(y[0] == 12.0 && y[2] == 36.0);
+
+            bbb::vec<3> v(1.0, -1.0, 0.5);
+            bbb::blas::axpy(-1.0, v, y);
+            assert(y[0] == 11.0 && y[1] == 25.0 && y[2] == 35.5);
+
+            // strided destination: a column of a matrix.
+            bbb::matrix<3, 2> m;
+            for(std::size_t i = 0; i < 3; i++) for(std::size_t j = 0; j < 2; j++) m[i][j] = double(i * 2 + j);
+            bbb::blas::axpy(1.0, x, m.column_view(1));
+            assert(m[0][1] == 2.0 && m[2][1] == 8.0 && m[2][0] == 4.0);
+
+            bbb::matrix<3, 4> a;
+            for(std::size_t i = 0; i < 3; i++) for(std::size_t j = 0; j < 4; j++) a[i][j] = double(i + 1) - 0.5 * double(j);
+            const std::vector<double> x4{1.0, -2.0, 0.5, 4.0};
+            std::vector<double> out(3, 1.0), expected(3);
+            for(std::size_t i = 0; i < 3; i++) {
+                double sum = 0.0;
+                for(std::size_t j = 0; j < 4; j++) sum += a[i][j] * x4[j];
+                expected[i] = 2.0 * sum + 3.0;
+            }
+            bbb::blas::gemv(2.0, a, x4, 3.0, out);
+            for(std::size_t i = 0; i < 3; i++) assert(std::abs(out[i] - expected[i]) < 1e-12);
+
+            // transposed A, and strided x / y taken from matrices.
+            bbb::row_vector<4> t_out;
+            for(std::size_t j = 0; j < 4; j++) t_out[j] = std::numeric_limits<double>::quiet_NaN();
+            bbb::blas::gemv(bbb::blas::op::transpose, 1.0, a, m.column_view(0), 0.0, t_out);
+            for(std::size_t j = 0; j < 4; j++) {
+                double sum = 0.0;
+                for(std::size_t i = 0; i < 3; i++) sum += a[i][j] * m[i][0];
+                assert(std::abs(t_out[j] - sum) < 1e-12); // beta == 0 ignores the nans
+            }
+            bbb::matrix<4, 2> xs;
+            for(std::size_t i = 0; i < 4; i++) xs[i][0] = x4[i];
+            std::vector<double> strided(3, 1.0);
+            bbb::blas::gemv(2.0, a, xs.column_view(0), 3.0, strided);
+            for(std::size_t i = 0; i < 3; i++) assert(std::abs(strided[i] - expected[i]) < 1e-12);
+
+            bbb::vec<3, float> fy(1.0f, 1.0f, 1.0f);
+            const bbb::matrix<3, 3, float> fa = bbb::matrix<3, 3, float>({{1, 0, 0}, {0, 2, 0}, {0, 0, 3}});
+            bbb::blas::gemv(1.0f, fa, bbb::vec<3, float>(1.0f, 1.0f, 1.0f), 1.0f, fy);
+            assert(fy[0] == 2.0f && fy[1] == 3.0f && fy[2] == 4.0f);
+        }
+
+        template <typename value_t>
+        void test_gemm(std::size_t m, std::size_t n, std::size_t k, double tolerance, bbb::thread_pool &pool) {
+            bbb::dynamic_matrix<value_t> a(m, k), at(k, m), b(k, n), bt(n, k), c(m, n);
+            for(std::size_t i = 0; i < m; i++) for(std::size_t p = 0; p < k; p++) at[p][i] = a[i][p] = value_t(double((i * 5 + p * 3) % 13) * 0.25 - 1.0);
+            for(std::size_t p = 0; p < k; p++) for(std::size_t j = 0; j < n; j++) bt[j][p] = b[p][j] = value_t(double((p + j * 7) % 11) * 0.5 - 2.0);
+            for(std::size_t i = 0; i < m; i++) for(std::size_t j = 0; j < n; j++) c[i][j] = value_t(double(i) - double(j));
+
+            const bbb::dynamic_matrix<value_t> ab = a * b;
+            bbb::dynamic_matrix<value_t> expected(m, n);
+            for(std::size_t i = 0; i < m; i++) for(std::size_t j = 0; j < n; j++) expected[i][j] = value_t(1.5) * ab[i][j] - value_t(0.5) * c[i][j];
+
+            const bbb::blas::op none = bbb::blas::op::none, trans = bbb::blas::op::transpose;
+            bbb::dynamic_matrix<value_t> out = c;
+            bbb::blas::gemm(value_t(1.5), a, b, value_t(-0.5), out);
+            assert(max_difference(out, expected) < tolerance);
+            out = c;
+            bbb::blas::gemm(trans, none, value_t(1.5), at, b, value_t(-0.5), out);
+            assert(max_difference(out, expected) < tolerance);
+            out = c;
+            bbb::blas::gemm(none, trans, value_t(1.5), a, bt, value_t(-0.5), out);
+            assert(max_difference(out, expected) < tolerance);
+            out = c;
+            bbb::blas::gemm(bbb::execution::par.on(pool), trans, trans, value_t(1.5), at, bt, value_t(-0.5), out);
+            assert(max_difference(out, expected) < tolerance);
+
+            // C^T = B^T A^T written through a transposed view of the output.
+            bbb::dynamic_matrix<value_t> out_t = c.transpose();
+            bbb::blas::gemm(trans, trans, value_t(1.5), b, a, value_t(-0.5), out_t.t().t());
+            assert(max_difference(out_t.t(), expected.t().t()) < tolerance);
+        }
+
+        void test() {
+            test_axpy_gemv();
+            bbb::thread_pool pool(3);
+            test_gemm<double>(5, 7, 3, 1e-12, pool);
+            test_gemm<double>(67, 45, 130, 1e-9, pool);
+            test_gemm<float>(140, 150, 160, 1e-2, pool);
+
+            // C += A B into a block of a bigger matrix, alpha and beta of 1.
+            bbb::matrix<6, 6> big;
+            for(std::size_t i = 0; i < 6; i++) for(std::size_t j = 0; j < 6; j++) big[i][j] = 1.0;
+            const bbb::matrix<2, 3> l({{1, 2, 3}, {4, 5, 6}});
+            const bbb::matrix<3, 2> r({{1, 0}, {0, 1}, {1, 1}});
+            bbb::blas::gemm(1.0, l, r, 1.0, big.block<2, 2>(3, 1));
+            assert(big[3][1] == 5.0 && big[3][2] == 6.0 && big[4][1] == 11.0 && big[4][2] == 12.0);
+            assert(big[3][0] == 1.0 && big[5][1] == 1.0);
+
+            std::cout << "blas: axpy / gemv / gemm with transposes into caller buffers" << std::endl;
+        }
+    };
+};
@@ -0,0 +1,72 @@
+//
+// cholesky_factorization.hpp
+//
+
+#pragma once
+
+#include <cholesky_factorization.hpp>
+#include <thread_pool.hpp>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace bbb_test {
+    namespace cholesky_factorization {
+        void test() {
+            // only the lower triangle is read: the upper one holds garbage.
+            bbb::square_matrix<3> a(bbb::matrix<3, 3>{{{4.0, 99.0, 99.0}, {2.0, 5.0, 99.0}, {-2.0, 1.0, 11.0}}});
+            bbb::cholesky_factorization<bbb::square_matrix<3>> chol(a);
+            assert(chol.is_positive_definite());
+            const bbb::square_matrix<3> &l = chol.factor();
+            assert(l(0, 0) == 2.0 && l(1, 0) == 1.0 && l(1, 1) == 2.0 && l(2, 0) == -1.0 && l(2, 1) == 1.0 && l(2, 2) == 3.0);
+            assert(l(0, 1) == 0.0 && l(0, 2) == 0.0 && l(1, 2) == 0.0);
+            assert(std::abs(chol.determinant() - 144.0) < 1e-12 && std::abs(chol.log_determinant() - std::log(144.0)) < 1e-12);
+
+            const bbb::square_matrix<3> s(bbb::matrix<3, 3>{{{4.0, 2.0, -2.0}, {2.0, 5.0, 1.0}, {-2.0, 1.0, 11.0}}});
+            bbb::row_vector<3> b;
+            b(0, 0) = 2.0; b(1, 0) = 7.0; b(2, 0) = 10.0;
+            const bbb::row_vector<3> x = chol.solve(b);
+            const bbb::matrix<3, 1> sx = s * x;
+            for(std::size_t i = 0; i < 3; i++) assert(std::abs(sx(i, 0) - b(i, 0)) < 1e-12);
+            const bbb::matrix<3, 3> identity = s * chol.inverse();
+            for(std::size_t i = 0; i < 3; i++) for(std::size_t j = 0; j < 3; j++) assert(std::abs(identity(i, j) - double(i == j)) < 1e-12);
+
+            bbb::square_matrix<2> indefinite(bbb::matrix<2, 2>{{{1.0, 0.0}, {2.0, 1.0}}});
+            assert(!bbb::make_cholesky_factorization(indefinite).is_positive_definite());
+
+            // blocked path, sequential and on a pool: a covariance like matrix.
+            const std::size_t n = 300;
+            bbb::dynamic_matrix<> c(n, n);
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) c[i][j] = std::exp(-std::abs(double(i) - double(j)) / 10.0) + (i == j ? 0.5 : 0.0);
+            }
+            bbb::thread_pool pool(3);
+            bbb::cholesky_factorization<bbb::dynamic_matrix<>> seq(c), par(bbb::execution::par.on(pool), c);
+            assert(seq.is_positive_definite() && par.is_positive_definite());
+            double worst = 0.0;
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j <= i; j++) {
+                    double sum = 0.0;
+                    for(std::size_t k = 0; k <= j; k++) sum += seq.factor()[i][k] * seq.factor()[j][k];
+                    worst = std::max(worst, std::abs(sum - c[i][j]));
+                    assert(std::abs(seq.factor()[i][j] - par.factor()[i][j]) < 1e-12);
+                }
+                for(std::size_t j = i + 1; j < n; j++) assert(seq.factor()[i][j] == 0.0);
+            }
+            assert(worst < 1e-12);
+
+            std::vector<double> v(n), exact(n);
+            for(std::size_t i = 0; i < n; i++) exact[i] = std::cos(double(i));
+            for(std::size_t i = 0; i < n; i++) {
+                v[i] = 0.0;
+                for(std::size_t j = 0; j < n; j++) v[i] += c[i][j] * exact[j];
+            }
+            const std::vector<double> y = par.solve(v);
+            for(std::size_t i = 0; i < n; i++) assert(std::abs(y[i] - exact[i]) < 1e-10);
+
+            bbb::lu_factorization<bbb::dynamic_matrix<>> lu(c);
+            assert(std::abs(seq.log_determinant() - std::log(lu.determinant())) < 1e-9);
+            std::cout << "cholesky: 300 x 300 log det " << seq.log_determinant() << std::endl;
+        }
+    };
+};
@@ -0,0 +1,72 @@
+//
+// dynamic_matrix.hpp
+//
+
+#pragma once
+
+#include <dynamic_matrix.hpp>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
+
+namespace bbb_test {
+    namespace dynamic_matrix {
+        void test() {
+            bbb::matrix<3, 2> f{{{1.0, 2.0}, {3.0, 4.0}, {5.0, 6.0}}};
+            bbb::dynamic_matrix<> a(f), b(3, 2, 0.5);
+            assert(a.row_size() == 3 && a.column_size() == 2);
+            assert(a.leading_dimension() % (bbb::cache_line_size / sizeof(double)) == 0);
+            for(std::size_t i = 0; i < a.row_size(); i++) assert(reinterpret_cast<std::uintptr_t>(a.row(i)) % bbb::cache_line_size == 0);
+
+            bbb::dynamic_matrix<> c = a + b * 2.0 - f;
+            assert(c == bbb::dynamic_matrix<>(3, 2, 1.0));
+            bbb::matrix<3, 2> g = c + f;
+            assert(g == (f + bbb::matrix<3, 2>(c)).eval());
+
+            bbb::matrix<2, 3> h = f.transpose();
+            bbb::dynamic_matrix<> ah = a * h, fh = f * bbb::dynamic_matrix<>(h), hf = bbb::dynamic_matrix<>(f) * h;
+            assert(ah == bbb::dynamic_matrix<>(f * h));
+            assert(ah == fh && ah == hf);
+            std::cout << "a * h" << std::endl << ah;
+
+            const double *buffer = ah.data();
+            bbb::dynamic_matrix<> moved = std::move(ah);
+            assert(moved.data() == buffer && ah.empty());
+
+            bbb::dynamic_matrix<> big_a(70, 50), big_b(50, 90);
+            for(std::size_t i = 0; i < 70; i++) for(std::size_t j = 0; j < 50; j++) big_a[i][j] = double((i + 2 * j) % 7) - 3;
+            for(std::size_t i = 0; i < 50; i++) for(std::size_t j = 0; j < 90; j++) big_b[i][j] = double((3 * i + j) % 5) * 0.5;
+            bbb::dynamic_matrix<> big_c = big_a * big_b;
+            for(std::size_t i = 0; i < 70; i += 7) {
+                for(std::size_t j = 0; j < 90; j += 9) {
+                    double sum = 0.0;
+                    for(std::size_t k = 0; k < 50; k++) sum += big_a[i][k] * big_b[k][j];
+                    assert(sum == big_c[i][j]);
+                }
+            }
+
+            bbb::memory_pool pool;
+            bbb::pool_allocator<double> alloc(pool);
+            std::size_t warmed_up = 0;
+            for(std::size_t iteration = 0; iteration < 10; iteration++) {
+                bbb::pooled_matrix<double> x(40, 40, 1.0, alloc), y(40, 40, 2.0, alloc);
+                bbb::pooled_matrix<double> z = x * y;
+                z += x;
+                assert(z[3][5] == 81.0);
+                if(iteration == 0) warmed_up = pool.block_count();
+                assert(pool.block_count() == warmed_up);
+            }
+            std::cout << "pool blocks after warm-up: " << warmed_up << std::endl;
+
+            // requests whose padded size does not fit in std::size_t are refused, not wrapped.
+            const std::size_t huge = std::numeric_limits<std::size_t>::max();
+            std::size_t refused = 0;
+            try { pool.allocate(huge); } catch(const std::bad_alloc &) { refused++; }
+            try { alloc.allocate(huge / 4); } catch(const std::bad_alloc &) { refused++; }
+            try { bbb::aligned_allocator<unsigned char>().allocate(huge - 68); } catch(const std::bad_alloc &) { refused++; }
+            assert(refused == 3 && pool.block_count() == warmed_up);
+        }
+    };
+}
@@ -0,0 +1,41 @@
+//
+// gemm.hpp
+//
+
+#pragma once
+
+#include <matrix.hpp>
+#include <cassert>
+#include <cmath>
+
+namespace bbb_test {
+    namespace gemm {
+        template <std::size_t m, std::size_t n, std::size_t k, typename value_t>
+        void test_size(value_t tolerance) {
+            static bbb::matrix<m, k, value_t> a;
+            static bbb::matrix<k, n, value_t> b;
+            for(std::size_t i = 0; i < m; i++) for(std::size_t p = 0; p < k; p++) a[i][p] = value_t((i * 7 + p * 3) % 11) - 5;
+            for(std::size_t p = 0; p < k; p++) for(std::size_t j = 0; j < n; j++) b[p][j] = value_t((p * 5 + j * 2) % 13) / 4;
+
+            static bbb::matrix<m, n, value_t> c;
+            c = a * b;
+            value_t error{0};
+            for(std::size_t i = 0; i < m; i++) {
+                for(std::size_t j = 0; j < n; j++) {
+                    value_t sum{0};
+                    for(std::size_t p = 0; p < k; p++) sum += a[i][p] * b[p][j];
+                    error = std::max(error, std::fabs(sum - c[i][j]));
+                }
+            }
+            std::cout << "gemm " << m << "x" << k << " * " << k << "x" << n << " max error: " << error << std::endl;
+            assert(error <= tolerance);
+        }
+
+        void test() {
+            test_size<4, 4, 4, double>(0.0);
+            test_size<48, 56, 40, double>(1e-9);
+            test_size<130, 67, 301, double>(1e-9);
+            test_size<33, 70, 35, float>(1e-3f);
+        }
+    };
+}
@@ -0,0 +1,23 @@
+//
+// helpers.hpp
+//
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+namespace bbb_test {
+    // largest elementwise |lhs - rhs| of two matrix-like operands of the same shape
+    template <typename lhs_t, typename rhs_t>
+    double max_difference(const lhs_t &lhs, const rhs_t &rhs) {
+        assert(lhs.row_size() == rhs.row_size() && lhs.column_size() == rhs.column_size());
+        double diff = 0.0;
+        for(std::size_t i = 0; i < lhs.row_size(); i++) {
+            for(std::size_t j = 0; j < lhs.column_size(); j++) diff = std::max(diff, std::abs(double(lhs(i, j)) - double(rhs(i, j))));
+        }
+        return diff;
+    }
+};
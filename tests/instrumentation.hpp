@@ -0,0 +1,129 @@
+//
+// instrumentation.hpp
+//
+
+#pragma once
+
+#include <instrumentation.hpp>
+#include <matrix.hpp>
+#include <dynamic_matrix.hpp>
+#include <lu_factorization.hpp>
+#include <thread_pool.hpp>
+#include <vec.hpp>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace bbb_test {
+    namespace instrumentation {
+        namespace ins = bbb::instrumentation;
+
+        struct recording_tracer : ins::tracer {
+            std::mutex mutex;
+            std::size_t begun{0}, ended{0};
+            std::vector<ins::operation> ops;
+
+            void begin(const ins::span &) override {
+                std::lock_guard<std::mutex> lock(mutex);
+                begun++;
+            }
+            void end(const ins::span &s, std::uint64_t) override {
+                std::lock_guard<std::mutex> lock(mutex);
+                ended++;
+                ops.push_back(s.op);
+            }
+        };
+
+        const ins::record *find(const std::vector<ins::record> &records, ins::operation op, const char *site, std::size_t rows, std::size_t cols, std::size_t inner) {
+            for(const ins::record &r : records) {
+                if(r.op == op && r.site == site && r.rows == rows && r.cols == cols && r.inner == inner) return &r;
+            }
+            return nullptr;
+        }
+
+        void run_workload(bbb::thread_pool &pool) {
+            bbb::dynamic_matrix<> a(40, 30), b(30, 20);
+            for(std::size_t i = 0; i < 40; i++) for(std::size_t j = 0; j < 30; j++) a[i][j] = double(i + j % 7);
+            for(std::size_t i = 0; i < 30; i++) for(std::size_t j = 0; j < 20; j++) b[i][j] = double(i % 5) - double(j);
+            {
+                BBB_INSTRUMENT_SITE("product");
+                for(int r = 0; r < 3; r++) (void)(a * b);
+            }
+            (void)a.transpose();
+
+            bbb::square_matrix<8> m;
+            for(std::size_t i = 0; i < 8; i++) for(std::size_t j = 0; j < 8; j++) m[i][j] = i == j ? 4.0 : 1.0 / double(1 + i + j);
+            bbb::lu_factorization<bbb::square_matrix<8>> lu(m);
+            bbb::row_vector<8> rhs;
+            for(std::size_t i = 0; i < 8; i++) rhs[i] = double(i);
+            (void)lu.solve(rhs);
+            (void)rhs.norm();
+            (void)rhs.dot(rhs);
+
+            // work on pool threads is counted in their own tables.
+            pool.parallel_for(4, [&](std::size_t) {
+                BBB_INSTRUMENT_SITE("worker");
+                bbb::vec<16> v;
+                for(std::size_t i = 0; i < 16; i++) v[i] = double(i);
+                (void)v.norm();
+            });
+        }
+
+        void test() {
+            bbb::thread_pool pool(2);
+            ins::reset();
+            recording_tracer tracer;
+            ins::tracer *previous = ins::set_tracer(&tracer);
+            run_workload(pool);
+            assert(ins::set_tracer(previous) == &tracer);
+
+            const std::vector<ins::record> records = ins::snapshot();
+            if(!ins::enabled) {
+                assert(records.empty());
+                assert(tracer.begun == 0 && tracer.ended == 0);
+                std::cout << "instrumentation: disabled" << std::endl;
+                return;
+            }
+
+            const ins::record *product = find(records, ins::operation::multiply, "product", 40, 20, 30);
+            assert(product && product->total.calls == 3);
+            assert(product->total.flops == 3 * 2 * 40 * 20 * 30);
+            assert(product->total.bytes == 3 * (40 * 30 + 30 * 20 + 40 * 20) * sizeof(double));
+
+            const ins::record *transpose = find(records, ins::operation::transpose, "", 30, 40, 0);
+            assert(transpose && transpose->total.calls == 1 && transpose->total.nanoseconds == 0);
+
+            assert(find(records, ins::operation::lu_decomposition, "", 8, 8, 0)->total.calls == 1);
+            assert(find(records, ins::operation::lu_solve, "", 8, 8, 1)->total.flops == 2 * 8 * 8);
+            assert(find(records, ins::operation::norm, "", 8, 1, 0)->total.calls == 1);
+            assert(find(records, ins::operation::dot, "", 8, 1, 0)->total.calls == 1);
+            assert(find(records, ins::operation::norm, "worker", 16, 1, 0)->total.calls == 4);
+            assert(ins::total(records, ins::operation::multiply).calls == 3);
+
+            // only the timed operations reach the tracer, each begun and ended once.
+            assert(tracer.begun == 5 && tracer.ended == 5);
+            for(ins::operation op : tracer.ops) assert(op == ins::operation::multiply || op == ins::operation::lu_decomposition || op == ins::operation::lu_solve);
+            for(std::size_t i = 1; i < records.size(); i++) assert(records[i].total.nanoseconds <= records[i - 1].total.nanoseconds);
+
+            // tables of exited threads are kept.
+            {
+                bbb::thread_pool scratch(2);
+                scratch.parallel_for(8, [](std::size_t) {
+                    bbb::vec<4> v;
+                    for(std::size_t i = 0; i < 4; i++) v[i] = 1.0;
+                    (void)v.squared_norm();
+                });
+            }
+            assert(ins::total(ins::snapshot(), ins::operation::norm).calls == 1 + 4 + 8);
+
+            ins::reset();
+            assert(ins::snapshot().empty());
+
+            std::cout << "instrumentation: " << records.size() << " records, top " << ins::name_of(records[0].op)
+                      << " " << records[0].rows << "x" << records[0].cols << "x" << records[0].inner
+                      << " " << records[0].total.nanoseconds << "ns" << std::endl;
+        }
+    };
+};
@@ -0,0 +1,104 @@
+//
+// kd_tree.hpp
+//
+
+#pragma once
+
+#include <kd_tree.hpp>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace bbb_test {
+    namespace kd_tree {
+        inline double uniform(std::uint64_t &state) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            return double(state >> 11) / double(1ull << 53);
+        }
+
+        template <std::size_t s>
+        std::vector<typename bbb::kd_tree<s>::neighbor> brute_force(const std::vector<bbb::vec<s>> &points, const bbb::vec<s> &q) {
+            std::vector<typename bbb::kd_tree<s>::neighbor> all(points.size());
+            for(std::size_t i = 0; i < points.size(); i++) all[i] = {i, points[i].squared_distance(q)};
+            std::sort(all.begin(), all.end());
+            return all;
+        }
+
+        template <std::size_t s>
+        void check(std::size_t n, std::size_t leaf_size) {
+            std::uint64_t state = 42;
+            std::vector<bbb::vec<s>> points(n), queries(64);
+            for(auto &p : points) for(std::size_t k = 0; k < s; k++) p[k] = uniform(state);
+            for(auto &q : queries) for(std::size_t k = 0; k < s; k++) q[k] = 1.2 * uniform(state) - 0.1;
+            // duplicates must all be reported
+            for(std::size_t i = 0; i < n / 10; i++) points[n - 1 - i] = points[i];
+
+            bbb::kd_tree<s> tree(points, leaf_size);
+            assert(tree.size() == n);
+            std::cout << "kd_tree<" << s << ">: " << n << " points, " << tree.node_count() << " nodes" << std::endl;
+            using neighbor = typename bbb::kd_tree<s>::neighbor;
+            std::vector<neighbor> found;
+            for(const auto &q : queries) {
+                const auto expected = brute_force(points, q);
+                const auto nearest = tree.knn(q, 7);
+                assert(nearest.size() == std::min<std::size_t>(7, n));
+                for(std::size_t i = 0; i < nearest.size(); i++) {
+                    assert(nearest[i].index == expected[i].index && nearest[i].squared_distance == expected[i].squared_distance);
+                }
+                assert(tree.nearest(q).index == expected[0].index);
+
+                const double r = 0.15;
+                tree.radius(q, r, found);
+                std::sort(found.begin(), found.end());
+                std::size_t within = 0;
+                while(within < expected.size() && expected[within].squared_distance <= r * r) within++;
+                assert(found.size() == within);
+                for(std::size_t i = 0; i < within; i++) assert(found[i].index == expected[i].index);
+            }
+
+            const std::size_t k = 5;
+            std::vector<neighbor> seq(queries.size() * k), par(queries.size() * k);
+            const std::size_t total = tree.knn(bbb::execution::seq, queries.data(), queries.size(), k, seq.data());
+            bbb::thread_pool pool(4);
+            assert(tree.knn(bbb::execution::par.on(pool), queries.data(), queries.size(), k, par.data()) == total);
+            for(std::size_t i = 0; i < seq.size(); i++) assert(seq[i].index == par[i].index);
+            std::vector<std::vector<neighbor>> balls;
+            tree.radius(bbb::execution::par.on(pool), queries.data(), queries.size(), 0.1, balls);
+            assert(balls.size() == queries.size() && balls[3].size() == tree.radius(queries[3], 0.1).size());
+        }
+
+        void test() {
+            check<2>(2000, 8);
+            check<3>(3000, 16);
+            check<3>(5, 16);
+
+            bbb::kd_tree<2> empty;
+            bbb::kd_tree<2>::neighbor slots[3];
+            assert(empty.knn(bbb::vec<2>(0.0, 0.0), 3, slots) == 0 && slots[2].index == bbb::kd_tree<2>::npos);
+            assert(empty.nearest(bbb::vec<2>(0.0, 0.0)).index == bbb::kd_tree<2>::npos);
+
+            std::vector<bbb::vec<2, float>> same(100, bbb::vec<2, float>(1.0f, 2.0f));
+            bbb::kd_tree<2, float> flat(same, 4);
+            assert(flat.node_count() == 1 && flat.radius(bbb::vec<2, float>(1.0f, 2.0f), 0.0f).size() == 100);
+
+            bbb::vec_array<3> soa(4);
+            for(std::size_t i = 0; i < 4; i++) soa[i] = bbb::vec<3>(double(i), 0.0, 0.0);
+            bbb::kd_tree<3> from_soa(soa, 1);
+            assert(from_soa.nearest(bbb::vec<3>(2.2, 0.0, 0.0)).index == 2);
+
+            // integer points: squared distances in double, no overflow at the ends of the range.
+            const std::vector<bbb::vec<2, int>> grid{bbb::vec<2, int>(0, 0), bbb::vec<2, int>(10, 10), bbb::vec<2, int>(20, 20)};
+            bbb::kd_tree<2, int> lattice(grid, 1);
+            assert(lattice.nearest(bbb::vec<2, int>(1, 1)).index == 0 && lattice.nearest(bbb::vec<2, int>(1, 1)).squared_distance == 2.0);
+            const auto pair = lattice.knn(bbb::vec<2, int>(9, 9), 2);
+            assert(pair.size() == 2 && pair[0].index == 1 && pair[1].index == 0);
+            const int far = std::numeric_limits<int>::max();
+            const std::vector<bbb::vec<2, int>> corners{bbb::vec<2, int>(-far, -far), bbb::vec<2, int>(far, far), bbb::vec<2, int>(far, -far)};
+            bbb::kd_tree<2, int> wide(corners, 1);
+            assert(wide.nearest(bbb::vec<2, int>(far - 1, far)).index == 1);
+            assert(wide.knn(bbb::vec<2, int>(-far, far), 3).size() == 3);
+        }
+    };
+};
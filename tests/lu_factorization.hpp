@@ -0,0 +1,93 @@
+//
+// lu_factorization.hpp
+//
+
+#pragma once
+
+#include <lu_factorization.hpp>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace bbb_test {
+    namespace lu_factorization {
+        template <typename lhs_t, typename rhs_t>
+        bool close(const lhs_t &lhs, const rhs_t &rhs, std::size_t rows, std::size_t cols) {
+            for(std::size_t i = 0; i < rows; i++) for(std::size_t j = 0; j < cols; j++) {
+                if(1e-9 < std::abs(lhs(i, j) - rhs(i, j))) return false;
+            }
+            return true;
+        }
+
+        void test() {
+            // zero leading pivot: needs a row exchange
+            bbb::square_matrix<3> a(bbb::matrix<3, 3>{{{0.0, 2.0, 1.0}, {1.0, 1.0, 0.0}, {2.0, 1.0, 3.0}}});
+            bbb::lu_factorization<bbb::square_matrix<3>> lu(a);
+            assert(!lu.is_singular());
+            assert(std::abs(lu.determinant() - (-7.0)) < 1e-12);
+            std::cout << "packed lu" << std::endl << lu.packed();
+
+            bbb::row_vector<3> b;
+            b(0, 0) = 3.0; b(1, 0) = 2.0; b(2, 0) = 6.0;
+            bbb::row_vector<3> x = lu.solve(b);
+            assert(close(a * x, b, 3, 1));
+
+            bbb::matrix<3, 2> rhs{{{1.0, 0.0}, {2.0, 1.0}, {3.0, -1.0}}};
+            bbb::matrix<3, 2> xs = lu.solve(rhs);
+            assert(close(a * xs, rhs, 3, 2));
+
+            bbb::square_matrix<3> identity(bbb::matrix<3, 3>{{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}});
+            bbb::square_matrix<3> product = a * lu.inverse();
+            assert(close(product, identity, 3, 3));
+
+            bbb::square_matrix<3> singular(bbb::matrix<3, 3>{{{1.0, 2.0, 3.0}, {2.0, 4.0, 6.0}, {1.0, 0.0, 1.0}}});
+            assert(lu.factorize(singular).is_singular());
+            assert(lu.determinant() == 0.0);
+
+            const std::size_t n = 40;
+            bbb::dynamic_matrix<> d(n, n);
+            for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) d[i][j] = double((i * 7 + j * 3) % 11) - 5.0 + (i == j ? 20.0 : 0.0);
+            bbb::lu_factorization<bbb::dynamic_matrix<>> dlu(d);
+            assert(!dlu.is_singular() && dlu.size() == n);
+
+            std::vector<double> v(n);
+            for(std::size_t i = 0; i < n; i++) v[i] = double(i % 5);
+            std::vector<double> y = dlu.solve(v);
+            for(std::size_t i = 0; i < n; i++) {
+                double sum = 0.0;
+                for(std::size_t j = 0; j < n; j++) sum += d[i][j] * y[j];
+                assert(std::abs(sum - v[i]) < 1e-9);
+            }
+
+            bbb::dynamic_matrix<> ident = d * dlu.inverse();
+            assert(close(ident, bbb::dynamic_matrix<>::identity(n), n, n));
+
+            // float / half factorization refined to double accuracy
+            const std::size_t m = 150;
+            bbb::dynamic_matrix<> h(m, m);
+            for(std::size_t i = 0; i < m; i++) for(std::size_t j = 0; j < m; j++) h[i][j] = 1.0 / double(i + j + 1) + (i == j ? 4.0 : 0.0);
+            std::vector<double> w(m), exact(m);
+            for(std::size_t i = 0; i < m; i++) exact[i] = std::sin(double(i));
+            for(std::size_t i = 0; i < m; i++) {
+                w[i] = 0.0;
+                for(std::size_t j = 0; j < m; j++) w[i] += h[i][j] * exact[j];
+            }
+            bbb::refined_lu_factorization<bbb::dynamic_matrix<>> rlu(h);
+            std::vector<double> z = w;
+            bbb::refinement_status status = rlu.solve_in_place(z);
+            std::cout << "float lu refinement: " << status.iterations << " iterations, backward error " << status.residual << std::endl;
+            assert(status.converged && 0 < status.iterations);
+            for(std::size_t i = 0; i < m; i++) assert(std::abs(z[i] - exact[i]) < 1e-12);
+
+            bbb::refined_lu_factorization<bbb::dynamic_matrix<>, bbb::half> hlu(h);
+            status = hlu.solve_in_place(z = w);
+            std::cout << "half lu refinement: " << status.iterations << " iterations, backward error " << status.residual << std::endl;
+            assert(status.converged);
+            for(std::size_t i = 0; i < m; i++) assert(std::abs(z[i] - exact[i]) < 1e-12);
+
+            bbb::refined_lu_factorization<bbb::square_matrix<3>, bbb::bfloat16> blu(a);
+            bbb::row_vector<3> bx = blu.solve(b);
+            assert(close(a * bx, b, 3, 1));
+        }
+    };
+};
@@ -1,8 +1,44 @@
 #include "./matrix.hpp"
 #include "./vec.hpp"
+#include "./gemm.hpp"
+#include "./simd.hpp"
+#include "./vec_array.hpp"
+#include "./dynamic_matrix.hpp"
+#include "./lu_factorization.hpp"
+#include "./thread_pool.hpp"
+#include "./transform.hpp"
+#include "./sparse_matrix.hpp"
+#include "./binary_io.hpp"
+#include "./numeric.hpp"
+#include "./kd_tree.hpp"
+#include "./batched_lu.hpp"
+#include "./instrumentation.hpp"
+#include "./strided_view.hpp"
+#include "./blas.hpp"
+#include "./matrix_product.hpp"
+#include "./cholesky_factorization.hpp"
+#include "./qr_factorization.hpp"
 
 int main() {
     bbb_test::matrix::test();
     bbb_test::vec::test();
+    bbb_test::gemm::test();
+    bbb_test::simd::test();
+    bbb_test::vec_array::test();
+    bbb_test::dynamic_matrix::test();
+    bbb_test::lu_factorization::test();
+    bbb_test::thread_pool::test();
+    bbb_test::transform::test();
+    bbb_test::sparse_matrix::test();
+    bbb_test::binary_io::test();
+    bbb_test::numeric::test();
+    bbb_test::kd_tree::test();
+    bbb_test::batched_lu::test();
+    bbb_test::instrumentation::test();
+    bbb_test::strided_view::test();
+    bbb_test::blas::test();
+    bbb_test::matrix_product::test();
+    bbb_test::cholesky_factorization::test();
+    bbb_test::qr_factorization::test();
     return 0;
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <matrix.hpp>
+#include <cassert>
+#include <cmath>
 
 namespace bbb_test {
     namespace matrix {
@@ -26,6 +28,54 @@ namespace bbb_test {
             c = l * u;
             std::cout << "c" << std::endl << c;
             std::cout << (c == a * b ? "c == a * b" : "c != a * b") << std::endl;
+
+            bbb::matrix<2, 2> d = a + b * 2.0 - a / 2.0, e = -(a - b);
+            d += a - b;
+            std::cout << "a + b * 2.0 - a / 2.0 + (a - b)" << std::endl << d;
+            std::cout << "-(a - b)" << std::endl << e;
+
+            bbb::matrix<3, 3> r{{{2.0, 0.0, 1.0}, {1.0, 3.0, 2.0}, {1.0, 1.0, 2.0}}};
+            bbb::matrix<4, 4> t{{{1.0, 0.0, 2.0, 0.0}, {0.0, 3.0, 0.0, 1.0}, {1.0, 0.0, 1.0, 0.0}, {0.0, 2.0, 1.0, 4.0}}};
+            std::cout << "det(a) = " << a.determinant() << ", det(r) = " << r.determinant() << ", det(t) = " << t.determinant() << std::endl;
+            assert(std::abs(a.determinant() - 3.8) < 1e-12 && r.determinant() == 6.0 && t.determinant() == -10.0);
+            bbb::matrix<3, 3> ri = r * r.inverse();
+            bbb::matrix<4, 4> ti = t.inverse() * t;
+            for(std::size_t i = 0; i < 4; i++) for(std::size_t j = 0; j < 4; j++) {
+                if(i < 3 && j < 3) assert(std::abs(ri[i][j] - (i == j)) < 1e-12);
+                assert(std::abs(ti[i][j] - (i == j)) < 1e-12);
+            }
+            bbb::matrix<3, 4> rt{{{1.0, 2.0, 3.0, 4.0}, {0.5, 0.0, -1.0, 2.0}, {3.0, 1.0, 0.0, 1.0}}}, p = r * rt;
+            for(std::size_t i = 0; i < 3; i++) for(std::size_t j = 0; j < 4; j++) {
+                double sum = 0.0;
+                for(std::size_t k = 0; k < 3; k++) sum += r[i][k] * rt[k][j];
+                assert(p[i][j] == sum && rt.transpose()[j][i] == rt[i][j]);
+            }
+            assert(t.trace() == 9.0 && r.trace() == 7.0);
+
+            bbb::column_vector<6> x, y;
+            bbb::row_vector<6> xr, yr;
+            for(std::size_t i = 0; i < 6; i++) {
+                x[i] = xr[i] = i % 2 ? -double(i) : double(i);
+                y[i] = yr[i] = 1.0;
+            }
+            for(std::size_t q = 1; q <= 5; q++) {
+                double sum = 0.0;
+                for(std::size_t i = 0; i < 6; i++) sum += std::pow(std::abs(x[i] - y[i]), double(q));
+                assert(std::abs(x.p_distance(y, q) - std::pow(sum, 1.0 / q)) < 1e-9);
+                assert(std::abs(xr.p_distance(yr, q) - x.p_distance(y, q)) < 1e-12);
+            }
+            assert(x.p_norm<1>() == 15.0 && x.p_norm(1) == 15.0 && xr.p_norm<1>() == 15.0);
+            assert(std::abs(x.distance(y) - x.p_distance<2>(y)) < 1e-12 && std::abs(xr.distance(yr) - std::sqrt(67.0)) < 1e-12);
+            assert(std::abs(x.p_norm<3>() - x.p_norm(3)) < 1e-12 && std::abs(x.norm() - std::sqrt(55.0)) < 1e-12);
+            assert(x.inf_norm() == 5.0 && x.inf_distance(y) == 6.0 && xr.inf_distance(yr) == 6.0);
+
+#if 201402L <= __cplusplus
+            constexpr bbb::matrix<2, 2> f{{{2.0, 1.0}, {1.0, 1.0}}};
+            constexpr bbb::matrix<2, 2> g = f * f.inverse();
+            static_assert(g(0, 0) == 1.0 && g(0, 1) == 0.0 && g(1, 1) == 1.0, "folded at compile time");
+            constexpr bbb::matrix<2, 2> ft = f.transpose();
+            static_assert(f.determinant() == 1.0 && f.trace() == 3.0 && ft(0, 1) == 1.0, "folded at compile time");
+#endif
         }
     };
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+//
+// matrix_product.hpp
+//
+
+#pragma once
+
+#include <matrix_product.hpp>
+#include <matrix.hpp>
+#include <dynamic_matrix.hpp>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+
+#include "./helpers.hpp"
+
+namespace bbb_test {
+    namespace matrix_product {
+        template <std::size_t row_num, std::size_t col_num>
+        void fill(bbb::matrix<row_num, col_num> &m, std::size_t seed) {
+            for(std::size_t i = 0; i < row_num; i++) {
+                for(std::size_t j = 0; j < col_num; j++) m[i][j] = double((i * 7 + j * 3 + seed) % 11) / 8.0 - 0.5;
+            }
+        }
+
+        void test_order() {
+            bbb::matrix<60, 60> a, b;
+            bbb::matrix<60, 1> x;
+            fill(a, 1);
+            fill(b, 2);
+            fill(x, 3);
+
+            // a * b * x is taken as a * (b * x): two matrix-vector products instead of a matrix-matrix one.
+            const auto abx = a * b * x;
+            static_assert(std::is_same<decltype(abx.eval()), bbb::matrix<60, 1>>::value, "fixed result");
+            static_assert(decltype(abx)::factor_count == 3, "flattened chain");
+            static_assert(decltype(abx)::split() == 0 && decltype(abx)::multiply_adds() == 2 * 60 * 60, "vector first");
+            static_assert(std::is_same<decltype(a * b * x), decltype(bbb::chain(a, b, x))>::value, "chain() is the same product");
+
+            const bbb::matrix<60, 60> ab = (a * b).eval();
+            const bbb::matrix<60, 1> left_to_right = (ab * x).eval();
+            const bbb::matrix<60, 1> y = abx;
+            assert(max_difference(y, left_to_right) < 1e-10);
+            assert(max_difference(abx, left_to_right) < 1e-10);
+
+            // equal costs keep the written order.
+            static_assert(decltype(a * b * a)::split() == 1, "left to right on ties");
+
+            // 10 x 30, 30 x 5, 5 x 60: (p q) r costs 1500 + 3000, p (q r) 9000 + 18000.
+            bbb::matrix<10, 30> p;
+            bbb::matrix<30, 5> q;
+            bbb::matrix<5, 60> r;
+            fill(p, 4);
+            fill(q, 5);
+            fill(r, 6);
+            static_assert(decltype(p * q * r)::multiply_adds() == 4500 && decltype(p * (q * r))::multiply_adds() == 4500, "parentheses do not matter");
+
+            // six factors of mixed extents against the left to right product.
+            bbb::matrix<5, 40> c;
+            bbb::matrix<40, 3> d;
+            bbb::matrix<3, 40> e;
+            bbb::matrix<40, 40> f;
+            bbb::matrix<40, 2> g;
+            bbb::matrix<2, 1> h;
+            fill(c, 7);
+            fill(d, 8);
+            fill(e, 9);
+            fill(f, 10);
+            fill(g, 11);
+            fill(h, 12);
+            const bbb::matrix<5, 1> chain = c * d * e * f * g * h;
+            const bbb::matrix<5, 1> reference = ((((((c * d).eval() * e).eval() * f).eval() * g).eval() * h).eval());
+            assert(max_difference(chain, reference) < 1e-10);
+            assert(max_difference(bbb::chain(c, d, e, f, g, h), reference) < 1e-10);
+            static_assert(decltype(c * d * e * f * g * h)::multiply_adds() < 5 * 40 * 3 + 5 * 3 * 40 + 5 * 40 * 40 + 5 * 40 * 2 + 5 * 2, "cheaper than left to right");
+        }
+
+        bbb::matrix<3, 3> rotation() {
+            return bbb::matrix<3, 3>({{0.0, -1.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 1.0}});
+        }
+
+        void test_use() {
+            bbb::matrix<3, 3> a = rotation(), s({{2.0, 0.0, 0.0}, {0.0, 3.0, 0.0}, {0.0, 0.0, 4.0}});
+            const bbb::matrix<3, 1> x({{1.0}, {2.0}, {3.0}});
+
+            // temporaries are held by value.
+            const auto p = rotation() * s * rotation() * x;
+            const bbb::matrix<3, 1> px = p;
+            assert(px[0][0] == -3.0 && px[1][0] == -4.0 && px[2][0] == 12.0);
+
+            // element-wise expressions take the product once.
+            bbb::matrix<3, 1> y = a * s * x + x * 2.0;
+            assert(y[0][0] == -4.0 && y[1][0] == 6.0 && y[2][0] == 18.0);
+            y -= s * x;
+            assert(y[0][0] == -6.0 && y[2][0] == 6.0);
+
+            // the old value of a is read before it is overwritten.
+            a = a * a;
+            assert(a[0][0] == -1.0 && a[1][1] == -1.0 && a[2][2] == 1.0);
+            bbb::square_matrix<3> r = rotation();
+            r *= rotation();
+            assert(r == a);
+
+            bbb::matrix<4, 4> big;
+            for(std::size_t i = 0; i < 4; i++) for(std::size_t j = 0; j < 4; j++) big[i][j] = 0.0;
+            big.block<3, 3>(1, 0) = s * s;
+            assert(big[1][0] == 4.0 && big[3][2] == 16.0 && big[0][0] == 0.0);
+
+            const bbb::dynamic_matrix<> dy = s * x;
+            assert(dy.row_size() == 3 && dy[2][0] == 12.0);
+        }
+
+        bbb::matrix<2, 2> squared(const bbb::matrix<2, 2> &m) {
+            return m * m;
+        }
+
+        // members of matrix that read the whole result work on a product directly.
+        void test_members() {
+            bbb::matrix<2, 2> x{{{1.0, 0.0}, {0.0, 1.0}}}, y{{{1.0, 2.0}, {3.0, 4.0}}};
+            const bbb::matrix<2, 2> c = x * y;
+            const auto lazy = x * y;
+            x[0][0] = 100.0;
+            assert(c[0][0] == 1.0 && lazy[0][0] == 100.0 && lazy(1, 1) == 4.0);
+            assert((x * y).transpose()[1][0] == 200.0 && (x * y)[0][1] == 200.0);
+            assert((y * y).determinant() == 4.0 && (y * y).trace() == 29.0);
+            assert(max_difference((y * y).inverse() * y * y, bbb::matrix<2, 2>{{{1.0, 0.0}, {0.0, 1.0}}}) < 1e-12);
+            assert(squared(y)[1][1] == 22.0);
+            bbb::square_matrix<2> z = y;
+            z *= y;
+            assert(z == squared(y));
+        }
+
+        void test() {
+            test_order();
+            test_use();
+            test_members();
+
+            constexpr bbb::matrix<2, 2> f{{{2.0, 1.0}, {1.0, 1.0}}};
+            constexpr bbb::matrix<2, 2> g = f * f * f;
+            static_assert(g(0, 0) == 13.0 && g(1, 1) == 5.0, "folded at compile time");
+            constexpr bbb::matrix<2, 2> h = bbb::chain(f, f, f);
+            static_assert(h(0, 0) == 13.0 && h(1, 1) == 5.0, "chains fold too");
+
+            std::cout << "matrix_product: chains evaluated in the cheapest order" << std::endl;
+        }
+    };
+};
@@ -0,0 +1,55 @@
+//
+// numeric.hpp
+//
+
+#pragma once
+
+#include <numeric.hpp>
+#include <vec.hpp>
+#include <matrix.hpp>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace bbb_test {
+    namespace numeric {
+        void test() {
+            // exactly representable values round trip
+            const float exact[] = {0.0f, 1.0f, -2.5f, 0.099975586f, 65504.0f, 6.1035156e-05f, 5.9604645e-08f};
+            for(float x : exact) assert(float(bbb::half(x)) == x);
+            assert(bbb::half(1.0f).bits == 0x3C00 && bbb::half(-2.0f).bits == 0xC000);
+            assert(std::isinf(float(bbb::half(65520.0f))) && float(bbb::half(65519.0f)) == 65504.0f);
+            assert(std::isnan(float(bbb::half(std::numeric_limits<float>::quiet_NaN()))));
+            // ties go to even
+            assert(float(bbb::half(1.0f + 1.0f / 2048.0f)) == 1.0f && float(bbb::half(1.0f + 3.0f / 2048.0f)) == 1.0f + 2.0f / 1024.0f);
+            assert(float(bbb::half(2.0e-8f)) == 0.0f && float(bbb::half(4.0e-8f)) == 5.9604645e-08f);
+
+            assert(bbb::bfloat16(1.0f).bits == 0x3F80 && float(bbb::bfloat16(3.0e38f)) == 3.0040553e38f);
+            assert(float(bbb::bfloat16(1.0f + 1.0f / 256.0f)) == 1.0f && float(bbb::bfloat16(1.0f + 3.0f / 256.0f)) == 1.0f + 2.0f / 128.0f);
+
+            bbb::half h = 1.5f;
+            h += 2.0f;
+            h *= -2.0f;
+            assert(float(h) == -7.0f && float(-h) == 7.0f && std::abs(h) == 7.0f);
+
+            // 4096 ones: a half accumulator would stop at 2048
+            bbb::vec<4096, bbb::half> ones;
+            for(std::size_t i = 0; i < ones.size(); i++) ones[i] = 1.0f;
+            assert(ones.dot(ones) == 4096.0f && ones.norm() == 64.0);
+            bbb::vec<3, bbb::bfloat16> a{1.0f, 2.0f, 2.0f}, b{0.0f, 0.0f, 0.0f};
+            assert(a.norm() == 3.0 && a.distance(b) == 3.0 && a.p_norm<1>() == 5.0);
+
+            bbb::matrix<2, 2, bbb::half> m{{{bbb::half(1.0f), bbb::half(2.0f)}, {bbb::half(3.0f), bbb::half(4.0f)}}};
+            bbb::matrix<2, 2, bbb::half> mm = m * m;
+            assert(float(mm(0, 0)) == 7.0f && float(mm(1, 1)) == 22.0f);
+
+            double in[3] = {1.0, 1.0 / 3.0, 1e6}, back[3];
+            bbb::half stored[3];
+            bbb::convert(in, stored, 3);
+            bbb::convert(stored, back, 3);
+            assert(back[0] == 1.0 && std::abs(back[1] - 1.0 / 3.0) < 1e-3 && std::isinf(back[2]));
+            static_assert(std::is_same<bbb::accumulator_t<float>, double>::value && std::is_same<bbb::compute_t<bbb::half>, float>::value, "");
+            std::cout << "half(1/3): " << float(stored[1]) << ", sizeof(vec<3, half>): " << sizeof(bbb::vec<3, bbb::half>) << std::endl;
+        }
+    };
+};
@@ -0,0 +1,103 @@
+//
+// qr_factorization.hpp
+//
+
+#pragma once
+
+#include <qr_factorization.hpp>
+#include <thread_pool.hpp>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace bbb_test {
+    namespace qr_factorization {
+        // Q R == A, Q^T Q == I and R upper triangular for the m x n factorization of a.
+        template <typename matrix_type>
+        double check(const bbb::qr_factorization<matrix_type> &qr, const matrix_type &a) {
+            const std::size_t m = a.row_size(), n = a.column_size();
+            const matrix_type q = qr.thin_q();
+            double worst = 0.0;
+            for(std::size_t i = 0; i < m; i++) {
+                for(std::size_t j = 0; j < n; j++) {
+                    double sum = 0.0;
+                    for(std::size_t k = 0; k <= j; k++) sum += q(i, k) * qr.packed()(k, j);
+                    worst = std::max(worst, std::abs(sum - a(i, j)));
+                }
+            }
+            for(std::size_t i = 0; i < n; i++) {
+                for(std::size_t j = 0; j < n; j++) {
+                    double sum = 0.0;
+                    for(std::size_t k = 0; k < m; k++) sum += q(k, i) * q(k, j);
+                    worst = std::max(worst, std::abs(sum - double(i == j)));
+                }
+            }
+            return worst;
+        }
+
+        void test() {
+            // fit y = 1 + 2 t to exact data: the least squares solution is exact.
+            bbb::matrix<4, 2> a{{{1.0, 0.0}, {1.0, 1.0}, {1.0, 2.0}, {1.0, 3.0}}};
+            bbb::qr_factorization<bbb::matrix<4, 2>> qr(a);
+            assert(qr.is_full_rank());
+            assert(check(qr, a) < 1e-12);
+            bbb::row_vector<4> y;
+            for(std::size_t i = 0; i < 4; i++) y[i] = 1.0 + 2.0 * double(i);
+            const bbb::matrix<2, 1> coefficients = qr.solve(y);
+            assert(std::abs(coefficients(0, 0) - 1.0) < 1e-12 && std::abs(coefficients(1, 0) - 2.0) < 1e-12);
+
+            // noisy data: the residual is orthogonal to the columns of A.
+            y[0] += 0.5;
+            y[3] -= 0.25;
+            const bbb::matrix<2, 1> fit = qr.solve(y);
+            const bbb::matrix<4, 1> residual = a * fit - y;
+            const bbb::matrix<2, 1> normal = a.transpose() * residual;
+            assert(std::abs(normal(0, 0)) < 1e-12 && std::abs(normal(1, 0)) < 1e-12);
+
+            bbb::matrix<3, 2> dependent{{{1.0, 0.0}, {2.0, 0.0}, {3.0, 0.0}}};
+            assert(!bbb::make_qr_factorization(dependent).is_full_rank());
+
+            // blocked path on a tall system, with several right hand sides.
+            const std::size_t m = 260, n = 150;
+            bbb::dynamic_matrix<> big(m, n);
+            for(std::size_t i = 0; i < m; i++) {
+                for(std::size_t j = 0; j < n; j++) big[i][j] = std::sin(double(i * n + j)) + (i == j ? 2.0 : 0.0);
+            }
+            bbb::thread_pool pool(3);
+            bbb::qr_factorization<bbb::dynamic_matrix<>> seq(big), par(bbb::execution::par.on(pool), big);
+            assert(seq.is_full_rank() && check(seq, big) < 1e-11);
+            for(std::size_t i = 0; i < n; i++) assert(std::abs(seq.packed()[i][i] - par.packed()[i][i]) < 1e-10);
+
+            bbb::dynamic_matrix<> exact(n, 2), rhs(m, 2, 0.0);
+            for(std::size_t i = 0; i < n; i++) exact[i][0] = double(i % 7), exact[i][1] = std::cos(double(i));
+            for(std::size_t i = 0; i < m; i++) {
+                for(std::size_t k = 0; k < n; k++) rhs[i][0] += big[i][k] * exact[k][0], rhs[i][1] += big[i][k] * exact[k][1];
+            }
+            const bbb::dynamic_matrix<> x = par.solve(rhs);
+            assert(x.row_size() == n && x.column_size() == 2);
+            for(std::size_t i = 0; i < n; i++) assert(std::abs(x[i][0] - exact[i][0]) < 1e-9 && std::abs(x[i][1] - exact[i][1]) < 1e-9);
+
+            std::vector<double> column(m);
+            for(std::size_t i = 0; i < m; i++) column[i] = rhs[i][1];
+            const std::vector<double> xv = seq.solve(column);
+            assert(xv.size() == n);
+            for(std::size_t i = 0; i < n; i++) assert(std::abs(xv[i] - exact[i][1]) < 1e-9);
+
+            // factorizations on the pool from inside a parallel loop, large enough for the
+            // trailing updates to split over the pool: waiting threads run the other ones.
+            const std::size_t rows = 600, cols = 300;
+            std::vector<bbb::dynamic_matrix<>> inputs;
+            for(std::size_t c = 0; c < 8; c++) {
+                inputs.emplace_back(rows, cols);
+                for(std::size_t i = 0; i < rows; i++) for(std::size_t j = 0; j < cols; j++) inputs[c][i][j] = std::sin(double(i * cols + j + c));
+            }
+            std::vector<bbb::qr_factorization<bbb::dynamic_matrix<>>> nested(inputs.size());
+            pool.parallel_for(inputs.size(), [&](std::size_t c) { nested[c].factorize(bbb::execution::par.on(pool), inputs[c]); });
+            for(std::size_t c = 0; c < inputs.size(); c++) {
+                const bbb::qr_factorization<bbb::dynamic_matrix<>> reference(inputs[c]);
+                for(std::size_t i = 0; i < rows; i++) for(std::size_t j = 0; j < cols; j++) assert(std::abs(nested[c].packed()[i][j] - reference.packed()[i][j]) < 1e-10);
+            }
+            std::cout << "qr: 260 x 150 least squares, |QR - A| " << check(seq, big) << std::endl;
+        }
+    };
+};
@@ -0,0 +1,107 @@
+//
+// simd.hpp
+//
+
+#pragma once
+
+#include <simd.hpp>
+#include <vec.hpp>
+#include <matrix.hpp>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <random>
+
+namespace bbb_test {
+    namespace simd {
+        inline const char *name(bbb::simd::instruction_set isa) {
+            switch(isa) {
+                case bbb::simd::instruction_set::avx512: return "avx512";
+                case bbb::simd::instruction_set::avx2: return "avx2";
+                case bbb::simd::instruction_set::sse2: return "sse2";
+                default: return "scalar";
+            }
+        }
+
+        template <typename value_t>
+        bool near(value_t a, value_t b, value_t tolerance) {
+            return std::fabs(a - b) <= tolerance * std::max(value_t(1), std::max(std::fabs(a), std::fabs(b)));
+        }
+
+        template <typename value_t>
+        void test_kernels(bbb::simd::instruction_set isa, value_t tolerance) {
+            namespace scalar = bbb::simd::scalar;
+            const bbb::simd::kernel_table<value_t> kernels = bbb::simd::kernels_for<value_t>(isa);
+            std::mt19937 engine(2016);
+            std::uniform_real_distribution<value_t> dist(-10, 10);
+            for(std::size_t n = 0; n < 100; n += (n < 40 ? 1 : 13)) {
+                std::vector<value_t> a(n), b(n);
+                for(auto &x : a) x = dist(engine);
+                for(auto &x : b) x = dist(engine);
+
+                assert(near<double>(kernels.dot(a.data(), b.data(), n), scalar::dot(a.data(), b.data(), n), tolerance));
+                assert(near<double>(kernels.squared_distance(a.data(), b.data(), n), scalar::squared_distance(a.data(), b.data(), n), tolerance));
+
+                std::vector<value_t> expected(a), actual(a);
+                scalar::add(expected.data(), b.data(), n);
+                kernels.add(actual.data(), b.data(), n);
+                for(std::size_t i = 0; i < n; i++) assert(near(expected[i], actual[i], tolerance));
+
+                expected = actual = a;
+                scalar::sub(expected.data(), b.data(), n);
+                kernels.sub(actual.data(), b.data(), n);
+                for(std::size_t i = 0; i < n; i++) assert(near(expected[i], actual[i], tolerance));
+
+                expected = actual = a;
+                scalar::scale(expected.data(), value_t(0.75), n);
+                kernels.scale(actual.data(), value_t(0.75), n);
+                for(std::size_t i = 0; i < n; i++) assert(near(expected[i], actual[i], tolerance));
+
+                expected = actual = a;
+                scalar::axpy(expected.data(), value_t(-1.5), b.data(), n);
+                kernels.axpy(actual.data(), value_t(-1.5), b.data(), n);
+                for(std::size_t i = 0; i < n; i++) assert(near(expected[i], actual[i], tolerance));
+            }
+
+            // 2^24 + 1 rounds back to 2^24 in float: only a double sum keeps the ones.
+            std::vector<value_t> big(64, value_t(16777216)), ones(1000, value_t(1));
+            big.insert(big.end(), ones.begin(), ones.end());
+            const std::vector<value_t> unit(big.size(), value_t(1)), zero(big.size(), value_t(0));
+            assert(kernels.dot(big.data(), unit.data(), big.size()) == 64.0 * 16777216.0 + 1000.0);
+            assert(kernels.squared_distance(unit.data(), zero.data(), big.size()) == double(big.size()));
+            assert(bbb::simd::dot(big.data(), unit.data(), big.size()) == 64.0 * 16777216.0 + 1000.0);
+            std::cout << "simd " << name(isa) << " " << (std::is_same<value_t, float>::value ? "float" : "double") << ": ok" << std::endl;
+        }
+
+        void test() {
+            std::cout << "detected: " << name(bbb::simd::detected()) << std::endl;
+            const bbb::simd::instruction_set sets[] = {
+                bbb::simd::instruction_set::scalar,
+                bbb::simd::instruction_set::sse2,
+                bbb::simd::instruction_set::avx2,
+                bbb::simd::instruction_set::avx512
+            };
+            for(auto isa : sets) {
+                if(!bbb::simd::supports(isa)) continue;
+                test_kernels<float>(isa, 1e-4f);
+                test_kernels<double>(isa, 1e-12);
+            }
+
+            bbb::vec<32> a, b;
+            for(std::size_t i = 0; i < a.size(); i++) a[i] = i * 0.5, b[i] = 3.0 - i;
+            assert(near(a.dot(b), bbb::simd::scalar::dot(&a[0], &b[0], a.size()), 1e-12));
+            assert(near(a.distance(b), std::sqrt(bbb::simd::scalar::squared_distance(&a[0], &b[0], a.size())), 1e-12));
+            bbb::vec<32> c = a;
+            c += b;
+            c *= 2.0;
+            for(std::size_t i = 0; i < c.size(); i++) assert(near(c[i], (a[i] + b[i]) * 2.0, 1e-12));
+
+            bbb::matrix<8, 8, float> m, n;
+            for(std::size_t i = 0; i < 8; i++) for(std::size_t j = 0; j < 8; j++) m[i][j] = i + j * 0.25f, n[i][j] = i * 0.5f - j;
+            bbb::matrix<8, 8, float> k = m;
+            k -= n;
+            k *= 3.0f;
+            for(std::size_t i = 0; i < 8; i++) for(std::size_t j = 0; j < 8; j++) assert(near(k[i][j], (m[i][j] - n[i][j]) * 3.0f, 1e-5f));
+        }
+    };
+}
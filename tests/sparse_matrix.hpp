@@ -0,0 +1,66 @@
+//
+// sparse_matrix.hpp
+//
+
+#pragma once
+
+#include <sparse_matrix.hpp>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace bbb_test {
+    namespace sparse_matrix {
+        void test() {
+            bbb::sparse_matrix<>::builder builder(3, 4);
+            builder.add(2, 3, 1.0).add(0, 1, 2.0).add(2, 0, -1.0).add(0, 1, 0.5).add(1, 2, 3.0);
+            bbb::sparse_matrix<> a = builder.build();
+            assert(a.non_zero_size() == 4 && a(0, 1) == 2.5 && a(1, 1) == 0.0 && a(2, 3) == 1.0);
+            std::cout << "sparse a" << std::endl << a;
+
+            bbb::matrix<3, 4> dense{{{0.0, 2.5, 0.0, 0.0}, {0.0, 0.0, 3.0, 0.0}, {-1.0, 0.0, 0.0, 1.0}}};
+            bbb::sparse_matrix<> b(dense);
+            assert(b.row_offsets() == a.row_offsets() && b.column_indices() == a.column_indices() && b.values() == a.values());
+            assert(a.to_dense() == bbb::dynamic_matrix<>(dense));
+
+            bbb::column_vector<4> x;
+            bbb::column_vector<3> y;
+            for(std::size_t i = 0; i < 4; i++) x[i] = double(i + 1);
+            a.multiply(x, y);
+            assert(y[0] == 5.0 && y[1] == 9.0 && y[2] == 3.0);
+
+            std::vector<double> z = a * std::vector<double>{1.0, 2.0, 3.0, 4.0}, t;
+            assert(z == (std::vector<double>{5.0, 9.0, 3.0}));
+            a.multiply_transposed(z, t);
+            bbb::sparse_matrix<> at = a.transpose();
+            assert(at.row_size() == 4 && t == at * z);
+            assert(t == (std::vector<double>{-3.0, 12.5, 27.0, 3.0}));
+
+            bbb::matrix<4, 2> d{{{1.0, 0.0}, {0.0, 1.0}, {1.0, 1.0}, {2.0, 0.0}}};
+            assert(a * d == bbb::dynamic_matrix<>(dense * d));
+
+            // 1d laplacian, large enough to be split over the pool
+            const std::size_t n = 50000;
+            bbb::sparse_matrix<>::builder laplacian(n, n);
+            laplacian.reserve(3 * n);
+            for(std::size_t i = 0; i < n; i++) {
+                laplacian.add(i, i, 2.0);
+                if(i) laplacian.add(i, i - 1, -1.0);
+                if(i + 1 < n) laplacian.add(i, i + 1, -1.0);
+            }
+            bbb::sparse_matrix<> l = laplacian.build();
+            std::vector<double> ones(n, 1.0), seq, par;
+            bbb::thread_pool pool(3);
+            l.multiply(ones, seq);
+            l.multiply(bbb::execution::par.on(pool), ones, par);
+            assert(seq == par && seq[0] == 1.0 && seq[n / 2] == 0.0 && seq[n - 1] == 1.0);
+
+            // narrow indices reach up to the largest column index_t holds
+            bbb::sparse_matrix<double, std::uint8_t>::builder narrow(2, 255);
+            narrow.add(0, 0, 1.0).add(1, 254, 2.0);
+            bbb::sparse_matrix<double, std::uint8_t> w = narrow.build();
+            assert(w(1, 254) == 2.0 && w.transpose()(254, 1) == 2.0);
+        }
+    };
+};
@@ -0,0 +1,141 @@
+//
+// strided_view.hpp
+//
+
+#pragma once
+
+#include <strided_view.hpp>
+#include <matrix.hpp>
+#include <dynamic_matrix.hpp>
+#include <thread_pool.hpp>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+
+#include "./helpers.hpp"
+
+namespace bbb_test {
+    namespace strided_view {
+        void test_fixed() {
+            bbb::matrix<4, 5> a;
+            for(std::size_t i = 0; i < 4; i++) for(std::size_t j = 0; j < 5; j++) a[i][j] = double(10 * i + j);
+
+            const auto b = a.block<2, 3>(1, 2);
+            static_assert(std::is_same<decltype(b), const bbb::strided_view<double, 2, 3>>::value, "block of a mutable matrix is mutable");
+            assert(b(0, 0) == 12.0 && b(1, 2) == 24.0);
+            assert(&b(0, 0) == &a[1][2]);
+
+            const auto t = a.t();
+            assert(t.row_size() == 5 && t.column_size() == 4);
+            assert(t(3, 2) == a[2][3]);
+            assert(max_difference(t, a.transpose()) == 0.0);
+            assert(t.t()(2, 3) == a[2][3]);
+
+            // views nest: row 1 of the transpose is column 1 of a.
+            assert(max_difference(a.t().row_view(1), a.column_view(1).t()) == 0.0);
+            assert((a.t().block<2, 2>(3, 1)(1, 0) == a[1][4]));
+
+            // expressions read through views, and assignments write through them.
+            bbb::matrix<2, 3> sum = b + b * 2.0;
+            assert(sum[1][2] == 72.0);
+            a.block<2, 3>(1, 2) = sum;
+            assert(a[2][4] == 72.0 && a[2][1] == 21.0);
+            a.row_view(0) = a.row_view(3);
+            assert(a[0][4] == a[3][4]);
+            a.column_view(0) *= 2.0;
+            assert(a[3][0] == 60.0);
+            a.block(0, 0, 2, 2) -= a.block(2, 0, 2, 2);
+            assert(a[1][1] == 11.0 - 31.0);
+            bbb::matrix<4, 5> scaled = a;
+            scaled /= 3.0;
+            a.view() /= 3.0;
+            assert(a == scaled);
+
+            const bbb::matrix<4, 5> &ca = a;
+            bbb::strided_view<const double, 5, 4> ct = ca.t();
+            bbb::strided_view<const double, 2, 3> cb = a.block<2, 3>(0, 0);
+            assert(ct(0, 0) == ca[0][0] && cb(1, 2) == a[1][2]);
+            bbb::matrix<5, 4> copied = ct.eval();
+            assert(copied == ca.transpose());
+        }
+
+        void test_products() {
+            bbb::matrix<6, 7> a;
+            bbb::matrix<6, 3> b;
+            for(std::size_t i = 0; i < 6; i++) for(std::size_t j = 0; j < 7; j++) a[i][j] = double((i * 7 + j) % 11) - 5.0;
+            for(std::size_t i = 0; i < 6; i++) for(std::size_t j = 0; j < 3; j++) b[i][j] = double(i) - 0.5 * double(j);
+
+            // A^T B without copying A, compared with the copied transpose.
+            const bbb::matrix<7, 3> atb = a.t() * b;
+            assert(max_difference(atb, a.transpose() * b) < 1e-12);
+
+            // block times column.
+            bbb::matrix<3, 1> x;
+            for(std::size_t i = 0; i < 3; i++) x[i][0] = double(i + 1);
+            const bbb::matrix<2, 1> y = a.block<2, 3>(2, 1) * x;
+            for(std::size_t i = 0; i < 2; i++) assert(y[i][0] == a[2 + i][1] + 2.0 * a[2 + i][2] + 3.0 * a[2 + i][3]);
+
+            // dynamic operands and sizes over the gemm threshold go through the strided kernel.
+            const std::size_t m = 90, k = 70, n = 80;
+            bbb::dynamic_matrix<> c(k, m), d(k + 5, n + 3);
+            for(std::size_t i = 0; i < k; i++) for(std::size_t j = 0; j < m; j++) c[i][j] = double((i * 3 + j * 7) % 17) * 0.125;
+            for(std::size_t i = 0; i < k + 5; i++) for(std::size_t j = 0; j < n + 3; j++) d[i][j] = double((i + j * 5) % 13) - 6.0;
+            const bbb::dynamic_matrix<> expected = c.transpose() * bbb::dynamic_matrix<>(d.block(5, 3, k, n));
+            const bbb::dynamic_matrix<> ctd = c.t() * d.block(5, 3, k, n);
+            assert(ctd.row_size() == m && ctd.column_size() == n);
+            assert(max_difference(ctd, expected) < 1e-9);
+            // both operands transposed: (D^T)(C^T)^T
+            const bbb::dynamic_matrix<> tt = d.block(5, 3, k, n).t() * c.t().t();
+            assert(max_difference(tt, expected.transpose()) < 1e-9);
+
+            bbb::thread_pool pool(3);
+            const bbb::dynamic_matrix<> par = bbb::multiply(bbb::execution::par.on(pool), c.t(), d.block(5, 3, k, n));
+            assert(max_difference(par, expected) < 1e-9);
+
+            // the fixed matrix keeps its fixed result.
+            bbb::matrix<3, 4> e;
+            for(std::size_t i = 0; i < 3; i++) for(std::size_t j = 0; j < 4; j++) e[i][j] = double(i + j);
+            static_assert(std::is_same<decltype(e.t() * e), bbb::matrix<4, 4>>::value, "fixed extents give a fixed result");
+            static_assert(std::is_same<decltype(c.t() * e), bbb::dynamic_matrix<>>::value, "dynamic extents give a dynamic result");
+            const bbb::matrix<4, 4> ete = e.t() * e;
+            assert(max_difference(ete, e.transpose() * e) == 0.0);
+        }
+
+        // sources reading the destination in another layout are evaluated first.
+        void test_overlap() {
+            bbb::matrix<3, 3> a{{{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}, {7.0, 8.0, 9.0}}};
+            const bbb::matrix<3, 3> at = a.transpose();
+            a = a.t();
+            assert(a == at);
+            a = at;
+            a += a.t() * 2.0;
+            assert(a(1, 0) == 2.0 + 2.0 * 4.0 && a(0, 1) == 4.0 + 2.0 * 2.0);
+            a = at;
+            a.t() = a;
+            assert(a == at.transpose());
+            a.block<2, 2>(1, 1) = a.block<2, 2>(0, 0);
+            assert(a(1, 1) == 1.0 && a(2, 2) == 5.0 && a(1, 2) == 2.0);
+            a.view() = a.view() + a;
+            assert(a(0, 0) == 2.0 && a(2, 2) == 10.0);
+
+            bbb::dynamic_matrix<> e(3, 3), r(2, 3);
+            for(std::size_t i = 0; i < 3; i++) for(std::size_t j = 0; j < 3; j++) e[i][j] = double(3 * i + j);
+            for(std::size_t i = 0; i < 2; i++) for(std::size_t j = 0; j < 3; j++) r[i][j] = double(3 * i + j);
+            const bbb::dynamic_matrix<> et = e.transpose(), rt = r.transpose();
+            e = e.t();
+            assert(e == et);
+            e -= e.t();
+            assert(e[1][0] == -2.0 && e[0][1] == 2.0 && e[2][2] == 0.0);
+            r = r.t();
+            assert(r.row_size() == 3 && r == rt);
+        }
+
+        void test() {
+            test_fixed();
+            test_products();
+            test_overlap();
+            std::cout << "strided_view: A^T B without copies" << std::endl;
+        }
+    };
+};
@@ -0,0 +1,78 @@
+//
+// thread_pool.hpp
+//
+
+#pragma once
+
+#include <thread_pool.hpp>
+#include <dynamic_matrix.hpp>
+#include <lu_factorization.hpp>
+#include <cassert>
+#include <cmath>
+#include <atomic>
+#include <vector>
+
+namespace bbb_test {
+    namespace thread_pool {
+        void test() {
+            bbb::thread_pool pool(4);
+            assert(pool.size() == 4);
+
+            std::vector<int> hits(1000, 0);
+            pool.parallel_for(hits.size(), [&](std::size_t i) { hits[i]++; });
+            for(int h : hits) assert(h == 1);
+
+            std::atomic<std::size_t> nested{0};
+            pool.parallel_for(8, [&](std::size_t) {
+                pool.parallel_for(16, [&](std::size_t) { nested++; });
+            });
+            assert(nested == 8 * 16);
+
+            const std::size_t m = 300, k = 170, n = 260;
+            bbb::dynamic_matrix<> a(m, k), b(k, n);
+            for(std::size_t i = 0; i < m; i++) for(std::size_t j = 0; j < k; j++) a[i][j] = double((i * 3 + j) % 13) - 6.0;
+            for(std::size_t i = 0; i < k; i++) for(std::size_t j = 0; j < n; j++) b[i][j] = double((i + j * 5) % 7) * 0.25;
+            bbb::dynamic_matrix<> seq = bbb::multiply(bbb::execution::seq, a, b);
+            bbb::dynamic_matrix<> par = bbb::multiply(bbb::execution::par.on(pool), a, b);
+            assert(seq == a * b);
+            for(std::size_t i = 0; i < m; i++) for(std::size_t j = 0; j < n; j++) assert(std::abs(seq[i][j] - par[i][j]) < 1e-9);
+
+            const std::size_t size = 300;
+            bbb::dynamic_matrix<> s(size, size);
+            for(std::size_t i = 0; i < size; i++) for(std::size_t j = 0; j < size; j++) s[i][j] = double((i * 7 + j * 11) % 17) - 8.0 + (i == j ? 3.0 : 0.0);
+            bbb::lu_factorization<bbb::dynamic_matrix<>> lu_seq(s), lu_par(bbb::execution::par.on(pool), s);
+            assert(!lu_seq.is_singular() && !lu_par.is_singular());
+            assert(lu_seq.permutation() == lu_par.permutation());
+            assert(std::abs(lu_seq.determinant() / lu_par.determinant() - 1.0) < 1e-9);
+
+            std::vector<double> rhs(size);
+            for(std::size_t i = 0; i < size; i++) rhs[i] = double(i % 9) - 4.0;
+            std::vector<double> x = lu_par.solve(rhs);
+            for(std::size_t i = 0; i < size; i++) {
+                double sum = 0.0;
+                for(std::size_t j = 0; j < size; j++) sum += s[i][j] * x[j];
+                assert(std::abs(sum - rhs[i]) < 1e-8);
+            }
+
+            // factorizations on the pool from inside a parallel loop: a waiting thread picks up
+            // another one while its own gemm tiles still run.
+            const std::size_t count = 24;
+            std::vector<bbb::dynamic_matrix<>> inputs;
+            for(std::size_t c = 0; c < count; c++) {
+                const std::size_t n = 260 + 11 * c;
+                inputs.emplace_back(n, n);
+                for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) inputs[c][i][j] = double((i * 7 + j * 11 + c) % 17) - 8.0 + (i == j ? 3.0 : 0.0);
+            }
+            std::vector<bbb::lu_factorization<bbb::dynamic_matrix<>>> nested_lu(count);
+            pool.parallel_for(count, [&](std::size_t c) { nested_lu[c].factorize(bbb::execution::par.on(pool), inputs[c]); });
+            for(std::size_t c = 0; c < count; c++) {
+                const bbb::lu_factorization<bbb::dynamic_matrix<>> reference(inputs[c]);
+                const std::size_t n = inputs[c].row_size();
+                assert(nested_lu[c].permutation() == reference.permutation());
+                for(std::size_t i = 0; i < n; i++) for(std::size_t j = 0; j < n; j++) assert(std::abs(nested_lu[c].packed()[i][j] - reference.packed()[i][j]) < 1e-9);
+            }
+
+            std::cout << "thread pool of " << pool.size() << " threads ok" << std::endl;
+        }
+    };
+};
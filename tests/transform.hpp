@@ -0,0 +1,44 @@
+//
+// transform.hpp
+//
+
+#pragma once
+
+#include <transform.hpp>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace bbb_test {
+    namespace transform {
+        void test() {
+            // rotation by 90 degrees around z, then translation by (1, 2, 3)
+            bbb::square_matrix<4> m(bbb::matrix<4, 4>{{{0.0, -1.0, 0.0, 1.0}, {1.0, 0.0, 0.0, 2.0}, {0.0, 0.0, 1.0, 3.0}, {0.0, 0.0, 0.0, 1.0}}});
+            std::vector<bbb::vec<3>> points, moved(100);
+            for(std::size_t i = 0; i < 100; i++) points.push_back(bbb::vec<3>(double(i), 1.0, -double(i)));
+
+            bbb::transform(m, points.data(), moved.data(), points.size());
+            for(std::size_t i = 0; i < 100; i++) assert(moved[i] == bbb::vec<3>(0.0, double(i) + 2.0, 3.0 - double(i)));
+
+            bbb::transform(m, points.data(), points.size());
+            assert(points == moved);
+
+            bbb::square_matrix<3> r(bbb::matrix<3, 3>{{{0.0, -1.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 1.0}}});
+            bbb::vec_array<3> soa(moved), rotated;
+            bbb::transform(r, soa, rotated);
+            assert(rotated.size() == 100 && rotated[5].eval() == bbb::vec<3>(-7.0, 0.0, -2.0));
+
+            // perspective: w = -z
+            bbb::square_matrix<4> p(bbb::matrix<4, 4>{{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, -1.0, 0.0}}});
+            std::vector<bbb::vec<3>> view{bbb::vec<3>(2.0, 4.0, -2.0), bbb::vec<3>(3.0, 6.0, -3.0)};
+            bbb::transform_homogeneous(p, view.data(), view.size());
+            assert(view[0] == bbb::vec<3>(1.0, 2.0, -1.0) && view[1] == view[0]);
+
+            bbb::thread_pool pool(3);
+            std::vector<bbb::vec<4>> many(100000, bbb::vec<4>(1.0, 2.0, 3.0, 1.0)), out(many.size());
+            bbb::transform(bbb::execution::par.on(pool), m, many.data(), out.data(), many.size());
+            for(const auto &v : out) assert(v == bbb::vec<4>(-1.0, 3.0, 6.0, 1.0));
+            std::cout << "transform ok" << std::endl;
+        }
+    };
+};
@@ -5,11 +5,38 @@
 #pragma once
 
 #include <vec.hpp>
+#include <cassert>
+#include <cmath>
 
 namespace bbb_test {
     namespace vec {
         void test() {
             bbb::vec<2> v{1, 3};
+            bbb::vec<3> a{1, 2, 3}, b{3, 2, 1};
+            bbb::vec<3> c = a + b * 2.0 - a / 2.0;
+            c += 2.0 * (a - b);
+            std::cout << "v: " << v << std::endl;
+            std::cout << "c: " << c << std::endl;
+            std::cout << "|a - b|: " << a.distance(b) << std::endl;
+
+            bbb::vec<3> d = a;
+            d.x() = 10;
+            d.z() += d.y();
+            const bbb::vec<3> &cd = d;
+            assert(cd.x() == 10.0 && cd.y() == 2.0 && cd.z() == 5.0 && cd[0] == 10.0);
+            std::cout << "a: " << a << ", d: " << d << std::endl;
+            std::cout << "sizeof(vec<3, float>): " << sizeof(bbb::vec<3, float>) << std::endl;
+
+            assert(a.squared_norm() == 14.0 && a.squared_distance(b) == 8.0);
+            assert(a.p_norm<1>() == 6.0 && a.p_distance<1>(b) == 4.0);
+            assert(std::abs(a.p_norm<2>() - a.norm()) < 1e-12 && std::abs(a.p_distance<2>(b) - a.distance(b)) < 1e-12);
+            assert(std::abs(a.p_norm<3>() - std::cbrt(36.0)) < 1e-12 && std::abs(a.p_distance<3>(b) - std::cbrt(16.0)) < 1e-12);
+
+            bbb::vec<7> e{1, -2, 3, -4, 5, -6, 7}, f{};
+            double sum4 = 0.0;
+            for(std::size_t i = 0; i < 7; i++) sum4 += std::pow(e[i], 4.0);
+            assert(std::abs(e.p_norm<4>() - std::pow(sum4, 0.25)) < 1e-12);
+            assert(std::abs(e.p_distance<4>(f) - e.p_norm<4>()) < 1e-12 && e.p_norm<1>() == 28.0);
         }
     };
 }
\ No newline at end of file
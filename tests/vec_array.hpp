@@ -0,0 +1,51 @@
+//
+// vec_array.hpp
+//
+
+#pragma once
+
+#include <vec_array.hpp>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace bbb_test {
+    namespace vec_array {
+        void test() {
+            std::vector<bbb::vec<3>> points;
+            for(std::size_t i = 0; i < 37; i++) points.emplace_back(i * 0.5, 3.0 - i, i % 5);
+            bbb::vec_array<3> soa(points);
+            assert(soa.size() == points.size());
+            for(std::size_t k = 0; k < 3; k++) assert(reinterpret_cast<std::uintptr_t>(soa.component(k)) % bbb::cache_line_size == 0);
+
+            const bbb::vec<3> query{1.0, 2.0, 3.0};
+            std::vector<double> dots(soa.size()), norms(soa.size()), distances(soa.size());
+            soa.dot(query, dots.data());
+            soa.norm(norms.data());
+            soa.distance(query, distances.data());
+            for(std::size_t i = 0; i < points.size(); i++) {
+                assert(std::fabs(dots[i] - points[i].dot(query)) < 1e-12);
+                assert(std::fabs(norms[i] - points[i].norm()) < 1e-12);
+                assert(std::fabs(distances[i] - points[i].distance(query)) < 1e-12);
+            }
+
+            bbb::vec<3> p = soa[5];
+            assert(p == points[5]);
+            soa[5].x() = 100.0;
+            soa[6] = bbb::vec<3>{7.0, 8.0, 9.0};
+            soa[7] += query;
+            assert(soa[5][0] == 100.0 && soa[6].eval() == (bbb::vec<3>{7.0, 8.0, 9.0}));
+            assert(soa[7].eval() == bbb::vec<3>(points[7] + query));
+            bbb::vec<3> q = soa[8] - query;
+            assert(q == bbb::vec<3>(points[8] - query));
+
+            bbb::vec_array<3> ones(soa.size(), bbb::vec<3>{1.0, 1.0, 1.0});
+            soa.axpy(2.0, ones).translate(query).scale(0.5);
+            const bbb::vec<3> lower = soa.min(), upper = soa.max(), sum = soa.sum();
+            std::cout << "vec_array min: " << lower << ", max: " << upper << ", sum: " << sum << std::endl;
+            std::cout << "nearest to " << query << ": " << soa[soa.nearest(query)].eval() << std::endl;
+            assert(soa.nearest(soa[11]) == 11);
+        }
+    };
+}